@@ -0,0 +1,70 @@
+/**
+ * Host Bridge Wire Protocol
+ *
+ * The bridge is a mesh node with a USB vendor-class interface: one bulk
+ * OUT and one bulk IN endpoint. Both carry a plain byte stream of records,
+ * back to back with no padding or alignment:
+ *
+ *   [bridge_hdr_t][len payload bytes][bridge_hdr_t][...]
+ *
+ *   OUT (host -> bridge)   addr = destination node, sent as one mesh packet
+ *   IN  (bridge -> host)   addr = source node of a packet for the bridge
+ *
+ * A record is one mesh packet: len <= BRIDGE_MAX_PAYLOAD and type below
+ * MESH_TYPE_RESERVED. Records flagged BRIDGE_FLAG_LOCAL are for (or from)
+ * the bridge itself, with type one of BRIDGE_OP_*.
+ *
+ * Flow control is USB's own. The bridge stops reading OUT data while the
+ * mesh can't take another packet, so host writes simply stall; nothing is
+ * dropped between the host and the first hop. A header without the magic
+ * byte loses sync: the bridge skips bytes until the next one.
+ *
+ * All fields are little-endian. Shared with host tools, so this header
+ * depends on nothing but <stdint.h>.
+ */
+
+#ifndef BRIDGE_PROTO_H
+#define BRIDGE_PROTO_H
+
+#include <stdint.h>
+
+/** USB IDs (TinyUSB's test VID: use your own before shipping boards) */
+#define BRIDGE_USB_VID      0xcafe
+#define BRIDGE_USB_PID      0x4d42
+
+#define BRIDGE_MAGIC        0xb5
+
+/** Payload limit (PIO_SPI_PACKET_MAX_PAYLOAD of the firmware) */
+#define BRIDGE_MAX_PAYLOAD  1024
+
+#define BRIDGE_FLAG_LOCAL   0x01    // Request to / reply from the bridge itself
+
+/** Local request types */
+#define BRIDGE_OP_STATUS    1       // Reply: bridge_status_t + telemetry entries
+
+typedef struct __attribute__((packed)) {
+    uint8_t magic;              // BRIDGE_MAGIC
+    uint8_t flags;              // BRIDGE_FLAG_*
+    uint8_t type;               // Mesh packet type, or BRIDGE_OP_* if LOCAL
+    uint8_t reserved;           // 0
+    uint16_t addr;              // OUT: destination; IN: source (MESH_ADDR(x, y))
+    uint16_t len;               // Payload bytes that follow
+} bridge_hdr_t;
+
+/**
+ * BRIDGE_OP_STATUS reply payload
+ *
+ * Followed by `entries` pio_spi_dma_telemetry_t records (pio_spi_dma.h
+ * layout, 28 bytes each), one per link direction.
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t addr;              // Bridge's own mesh address
+    uint16_t entries;
+    uint32_t to_mesh;           // Records sent into the mesh
+    uint32_t from_mesh;         // Packets sent up to the host
+    uint32_t resyncs;           // OUT headers that lost sync
+    uint32_t rejected;          // OUT records with a bad length, type or address
+    uint32_t dropped;           // Records the mesh had no route for
+} bridge_status_t;
+
+#endif // BRIDGE_PROTO_H
@@ -0,0 +1,326 @@
+/**
+ * PIO SPI Mesh Host Bridge
+ *
+ * A mesh node whose USB port is a vendor-class bulk pipe into the array
+ * instead of a printf console. The host streams records (bridge_proto.h)
+ * to the bulk OUT endpoint; each becomes one mesh packet, read from the
+ * USB FIFO straight into a pool buffer and sent by the packet layer's
+ * DMA. Every packet addressed to the bridge goes back up the bulk IN
+ * endpoint the same way, tagged with its source.
+ *
+ * Neither direction drops for lack of room. OUT data is only read while
+ * the first hop's queue and the pool have space, so a busy mesh NAKs the
+ * host instead of losing packets; IN packets wait in the mesh's local
+ * queue while the host isn't reading.
+ *
+ * The mesh runs on this core beside tud_task() rather than on core1:
+ * mesh_core1_send() drops when its ring is full, which would undo the
+ * backpressure above. Console (status on 's') is on the UART.
+ *
+ * Wire the bridge into the mesh like any node (mesh_pins.h, same
+ * MESH_ROOT_PIN strap).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/clocks.h"
+#include "tusb.h"
+#include "mesh.h"
+#include "mesh_pins.h"
+#include "bridge_proto.h"
+
+/**
+ * Output queue slots kept free for transit traffic
+ *
+ * Host records only go out a port with more than this many free, so
+ * packets the bridge forwards for its neighbours never find it full.
+ */
+#define BRIDGE_INJECT_RESERVE   (3 * MESH_LINK_WINDOW)
+
+#define TELEMETRY_MAX           NUM_DMA_CHANNELS
+
+static bridge_status_t counters;
+
+// Host -> mesh record being read
+static struct {
+    bridge_hdr_t hdr;
+    uint hdr_fill;              // Header bytes read
+    bool discard;               // Rejected: skip the payload
+    pio_spi_packet_t *pkt;      // Payload buffer (once room was found)
+    uint pos;                   // Payload bytes read
+} out;
+
+// Mesh -> host record being written
+static struct {
+    bridge_hdr_t hdr;
+    pio_spi_packet_t *pkt;
+    uint pos;                   // Header + payload bytes written
+} in;
+
+static bool status_wanted;      // BRIDGE_OP_STATUS reply owed to the host
+
+// LED for visual feedback
+#define LED_PIN PICO_DEFAULT_LED_PIN
+
+static void led_init(void) {
+    gpio_init(LED_PIN);
+    gpio_set_dir(LED_PIN, GPIO_OUT);
+    gpio_put(LED_PIN, 0);
+}
+
+static bool read_root_strap(void) {
+    gpio_init(MESH_ROOT_PIN);
+    gpio_set_dir(MESH_ROOT_PIN, GPIO_IN);
+    gpio_pull_up(MESH_ROOT_PIN);
+    sleep_us(10);
+    return !gpio_get(MESH_ROOT_PIN);
+}
+
+// ============================================================================
+// Host -> Mesh
+// ============================================================================
+
+// Header complete: check it; false if it lost sync
+static bool out_header(void) {
+    const bridge_hdr_t *h = &out.hdr;
+
+    if (h->len > BRIDGE_MAX_PAYLOAD || h->len > PIO_SPI_PACKET_MAX_PAYLOAD) {
+        counters.resyncs++;
+        return false;
+    }
+
+    if (h->flags & BRIDGE_FLAG_LOCAL) {
+        if (h->type == BRIDGE_OP_STATUS) {
+            status_wanted = true;
+        } else {
+            counters.rejected++;
+        }
+        out.discard = true;             // Local requests carry no payload we use
+    } else if (h->type >= MESH_TYPE_RESERVED || h->addr == MESH_ADDR_BROADCAST) {
+        counters.rejected++;
+        out.discard = true;
+    }
+    return true;
+}
+
+// Room for the record: first hop can take it and a buffer is free
+static bool out_claim(void) {
+    if (mesh_addr() == MESH_ADDR_NONE) return false;    // Can't route yet
+
+    mesh_port_t port = mesh_route(out.hdr.addr);
+    if (port != MESH_PORT_LOCAL && mesh_port_up(port) &&
+        mesh_port_queue_free(port) <= BRIDGE_INJECT_RESERVE) {
+        return false;
+    }
+
+    out.pkt = mesh_alloc();
+    return out.pkt != NULL;
+}
+
+static void out_finish(void) {
+    if (out.pkt) {
+        if (mesh_send(out.pkt, out.hdr.addr, out.hdr.type, out.hdr.len)) {
+            counters.to_mesh++;
+        } else {
+            counters.dropped++;         // No route (edge of the mesh, link down)
+        }
+    }
+    out.pkt = NULL;
+    out.discard = false;
+    out.hdr_fill = 0;
+    out.pos = 0;
+}
+
+static void usb_to_mesh(void) {
+    uint8_t *h = (uint8_t *)&out.hdr;
+
+    while (tud_vendor_available()) {
+        if (out.hdr_fill == 0) {
+            // Slide to the next magic byte
+            if (!tud_vendor_read(h, 1)) return;
+            if (h[0] != BRIDGE_MAGIC) continue;
+            out.hdr_fill = 1;
+        }
+
+        if (out.hdr_fill < sizeof(bridge_hdr_t)) {
+            out.hdr_fill += tud_vendor_read(h + out.hdr_fill, sizeof(bridge_hdr_t) - out.hdr_fill);
+            if (out.hdr_fill < sizeof(bridge_hdr_t)) return;
+            if (!out_header()) {
+                out.hdr_fill = 0;
+                continue;
+            }
+        }
+
+        if (!out.discard && !out.pkt && !out_claim()) {
+            return;                     // Leave it in the FIFO: USB NAKs the host
+        }
+
+        uint want = out.hdr.len - out.pos;
+        if (want) {
+            if (out.discard) {
+                uint8_t scratch[64];
+                if (want > sizeof(scratch)) want = sizeof(scratch);
+                out.pos += tud_vendor_read(scratch, want);
+            } else {
+                out.pos += tud_vendor_read(out.pkt->payload + out.pos, want);
+            }
+        }
+
+        if (out.pos == out.hdr.len) {
+            out_finish();
+        }
+    }
+}
+
+// ============================================================================
+// Mesh -> Host
+// ============================================================================
+
+// Status reply in a pool buffer, sent up like a packet
+static pio_spi_packet_t *status_reply(void) {
+    pio_spi_packet_t *pkt = mesh_alloc();
+    if (!pkt) return NULL;
+
+    bridge_status_t *s = (bridge_status_t *)pkt->payload;
+    pio_spi_dma_telemetry_t t[TELEMETRY_MAX];
+    uint n = pio_spi_dma_telemetry_snapshot(t, TELEMETRY_MAX);
+
+    counters.addr = mesh_addr();
+    counters.entries = (uint16_t)n;
+    memcpy(s, &counters, sizeof(counters));
+    memcpy(s + 1, t, n * sizeof(t[0]));
+
+    pkt->hdr.len = (uint16_t)(sizeof(*s) + n * sizeof(t[0]));
+    in.hdr = (bridge_hdr_t){
+        .magic = BRIDGE_MAGIC,
+        .flags = BRIDGE_FLAG_LOCAL,
+        .type = BRIDGE_OP_STATUS,
+        .addr = mesh_addr(),
+        .len = pkt->hdr.len,
+    };
+    return pkt;
+}
+
+static void mesh_to_usb(void) {
+    if (!tud_vendor_mounted()) {
+        // Nobody to deliver to: don't let stale packets hold pool buffers
+        pio_spi_packet_t *pkt;
+        while ((pkt = mesh_recv()) != NULL) {
+            mesh_free(pkt);
+        }
+        return;
+    }
+
+    while (true) {
+        if (!in.pkt) {
+            if (status_wanted && (in.pkt = status_reply()) != NULL) {
+                status_wanted = false;
+            } else if ((in.pkt = mesh_recv()) != NULL) {
+                in.hdr = (bridge_hdr_t){
+                    .magic = BRIDGE_MAGIC,
+                    .type = in.pkt->hdr.type,
+                    .addr = in.pkt->hdr.src,
+                    .len = in.pkt->hdr.len,
+                };
+                counters.from_mesh++;
+            } else {
+                break;
+            }
+            in.pos = 0;
+        }
+
+        uint room = tud_vendor_write_available();
+        if (!room) break;
+
+        const uint8_t *src;
+        uint n;
+        if (in.pos < sizeof(bridge_hdr_t)) {
+            src = (const uint8_t *)&in.hdr + in.pos;
+            n = sizeof(bridge_hdr_t) - in.pos;
+        } else {
+            src = in.pkt->payload + (in.pos - sizeof(bridge_hdr_t));
+            n = sizeof(bridge_hdr_t) + in.hdr.len - in.pos;
+        }
+        if (n > room) n = room;
+        in.pos += tud_vendor_write(src, n);
+
+        if (in.pos == sizeof(bridge_hdr_t) + in.hdr.len) {
+            mesh_free(in.pkt);
+            in.pkt = NULL;
+        }
+    }
+
+    tud_vendor_write_flush();
+}
+
+static void print_status(void) {
+    mesh_print_status();
+    printf("Bridge: usb %s  to mesh %lu  from mesh %lu  dropped %lu  rejected %lu  resyncs %lu\n",
+           tud_vendor_mounted() ? "up" : "down", counters.to_mesh, counters.from_mesh,
+           counters.dropped, counters.rejected, counters.resyncs);
+}
+
+int main() {
+    stdio_init_all();
+
+    printf("\n");
+    printf("============================================\n");
+    printf("       PIO SPI MESH HOST BRIDGE\n");
+    printf("============================================\n");
+    printf("\n");
+    printf("System clock: %lu Hz\n", clock_get_hz(clk_sys));
+    printf("Link clock:   %.1f MHz (%s)\n", MESH_FREQ_HZ / 1000000.0f,
+           MESH_FRAMED ? "framed" : "per-byte CS");
+    printf("USB:          %04x:%04x vendor bulk\n", BRIDGE_USB_VID, BRIDGE_USB_PID);
+    printf("Keys: s=status\n\n");
+
+    led_init();
+
+    mesh_config_t cfg = {
+        .freq_hz = MESH_FREQ_HZ,
+        .framed = MESH_FRAMED,
+        .cut_through = MESH_CUT_THROUGH,
+        .reliable = MESH_RELIABLE,
+        .train = MESH_TRAIN,
+        .root = read_root_strap(),
+    };
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        cfg.pins[p].tx_clk = MESH_PORT_BASE(p) + MESH_TX_CLK_OFS;
+        cfg.pins[p].tx_data = MESH_PORT_BASE(p) + MESH_TX_DATA_OFS;
+        cfg.pins[p].rx_cs = MESH_PORT_BASE(p) + MESH_RX_CS_OFS;
+    }
+
+    printf("Initializing mesh links%s... ", cfg.root ? " (root)" : "");
+    if (!mesh_init(&cfg)) {
+        printf("FAILED!\n");
+        while (1) { tight_loop_contents(); }
+    }
+    printf("OK\n");
+
+    tusb_init();
+
+    bool was_mounted = false;
+
+    while (1) {
+        tud_task();
+        mesh_poll();
+
+        usb_to_mesh();
+        mesh_to_usb();
+
+        if (tud_vendor_mounted() != was_mounted) {
+            was_mounted = !was_mounted;
+            gpio_put(LED_PIN, was_mounted);
+            printf("Host %s\n", was_mounted ? "connected" : "disconnected");
+        }
+
+        int c = getchar_timeout_us(0);
+        if (c == 's') {
+            print_status();
+        }
+    }
+
+    return 0;
+}
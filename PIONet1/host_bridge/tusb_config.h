@@ -0,0 +1,42 @@
+/**
+ * TinyUSB Configuration for the Host Bridge
+ *
+ * Device only, one vendor-class interface. The vendor FIFOs are the
+ * bridge's USB-side buffering: while the OUT FIFO is full the endpoint
+ * NAKs and the host waits, so they only need to cover the gap between
+ * main loop passes - a few ms at the ~1.2 MB/s full-speed bulk ceiling.
+ */
+
+#ifndef TUSB_CONFIG_H
+#define TUSB_CONFIG_H
+
+#ifndef CFG_TUSB_RHPORT0_MODE
+#define CFG_TUSB_RHPORT0_MODE   OPT_MODE_DEVICE
+#endif
+
+#define CFG_TUD_ENABLED         1
+#define CFG_TUSB_OS             OPT_OS_PICO
+
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+// Classes
+#define CFG_TUD_CDC             0
+#define CFG_TUD_MSC             0
+#define CFG_TUD_HID             0
+#define CFG_TUD_MIDI            0
+#define CFG_TUD_VENDOR          1
+
+/** Bulk packet size (64 is the full-speed maximum) */
+#define CFG_TUD_VENDOR_EPSIZE   64
+
+/** Host -> mesh buffering */
+#ifndef CFG_TUD_VENDOR_RX_BUFSIZE
+#define CFG_TUD_VENDOR_RX_BUFSIZE 4096
+#endif
+
+/** Mesh -> host buffering */
+#ifndef CFG_TUD_VENDOR_TX_BUFSIZE
+#define CFG_TUD_VENDOR_TX_BUFSIZE 4096
+#endif
+
+#endif // TUSB_CONFIG_H
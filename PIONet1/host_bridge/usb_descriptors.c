@@ -0,0 +1,95 @@
+/**
+ * USB Descriptors for the Host Bridge
+ *
+ * One configuration with a single vendor-class interface (bulk OUT 0x01,
+ * bulk IN 0x81). Vendor class needs no driver on Linux or macOS (libusb);
+ * on Windows bind WinUSB to it, e.g. with Zadig.
+ *
+ * The serial string is the flash unique ID, so a host with several
+ * bridges attached can tell them apart.
+ */
+
+#include <string.h>
+#include "tusb.h"
+#include "pico/unique_id.h"
+#include "bridge_proto.h"
+
+#define EP_OUT      0x01
+#define EP_IN       0x81
+
+enum {
+    STR_LANGID = 0,
+    STR_MANUFACTURER,
+    STR_PRODUCT,
+    STR_SERIAL,
+    STR_INTERFACE,
+    STR_COUNT
+};
+
+static const tusb_desc_device_t device_desc = {
+    .bLength = sizeof(tusb_desc_device_t),
+    .bDescriptorType = TUSB_DESC_DEVICE,
+    .bcdUSB = 0x0200,
+    .bDeviceClass = 0x00,               // Class per interface
+    .bDeviceSubClass = 0x00,
+    .bDeviceProtocol = 0x00,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .idVendor = BRIDGE_USB_VID,
+    .idProduct = BRIDGE_USB_PID,
+    .bcdDevice = 0x0100,
+    .iManufacturer = STR_MANUFACTURER,
+    .iProduct = STR_PRODUCT,
+    .iSerialNumber = STR_SERIAL,
+    .bNumConfigurations = 1,
+};
+
+#define CONFIG_TOTAL_LEN    (TUD_CONFIG_DESC_LEN + TUD_VENDOR_DESC_LEN)
+
+static const uint8_t config_desc[] = {
+    TUD_CONFIG_DESCRIPTOR(1, 1, 0, CONFIG_TOTAL_LEN, 0, 100),
+    TUD_VENDOR_DESCRIPTOR(0, STR_INTERFACE, EP_OUT, EP_IN, CFG_TUD_VENDOR_EPSIZE),
+};
+
+static const char *const strings[STR_COUNT] = {
+    [STR_MANUFACTURER] = "PIONet",
+    [STR_PRODUCT] = "PIO SPI Mesh Host Bridge",
+    [STR_INTERFACE] = "Mesh Bulk Stream",
+};
+
+const uint8_t *tud_descriptor_device_cb(void) {
+    return (const uint8_t *)&device_desc;
+}
+
+const uint8_t *tud_descriptor_configuration_cb(uint8_t index) {
+    (void)index;
+    return config_desc;
+}
+
+const uint16_t *tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
+    (void)langid;
+    static uint16_t desc[1 + 32];
+    char serial[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+    size_t n;
+
+    if (index == STR_LANGID) {
+        desc[1] = 0x0409;               // English (US)
+        n = 1;
+    } else {
+        if (index >= STR_COUNT) return NULL;
+        const char *s = strings[index];
+        if (index == STR_SERIAL) {
+            pico_get_unique_board_id_string(serial, sizeof(serial));
+            s = serial;
+        }
+
+        // ASCII to UTF-16LE
+        n = strlen(s);
+        if (n > 32) n = 32;
+        for (size_t i = 0; i < n; i++) {
+            desc[1 + i] = (uint8_t)s[i];
+        }
+    }
+
+    desc[0] = (uint16_t)((TUSB_DESC_STRING << 8) | (2 * n + 2));
+    return desc;
+}
@@ -0,0 +1,326 @@
+/**
+ * PIO SPI Link Throughput Benchmark
+ *
+ * Floods the link in both directions at once and verifies every byte.
+ * Reports MB/s, bit error rate and CPU utilisation once per second.
+ *
+ * Flash this onto BOTH boards (same wiring as ping_master/ping_slave) and
+ * select the same settings on each end over USB serial:
+ *
+ *   m - cycle link mode    (per-byte CS / framed / high-speed)
+ *   w - toggle DMA width   (8 / 32 bit, framed modes only)
+ *   s - cycle packet size  (1 B .. 64 KB)
+ *   f - cycle clock rate
+ *   c - clear statistics
+ *   space - pause / resume transmit
+ *
+ * Payload is a fixed 64 KB xorshift32 pattern that both ends hold, so TX
+ * costs no CPU beyond queueing and RX compares against the same table.
+ * After a burst of errors the receiver re-locates itself in the pattern.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/clocks.h"
+#include "pio_spi_dma.h"
+#include "pin_config.h"
+
+// Test settings
+#define PATTERN_BITS        16      // 64 KB pattern (largest packet size)
+#define PATTERN_SIZE        (1u << PATTERN_BITS)
+#define RING_BITS           15      // 32 KB RX ring (DMA ring maximum)
+#define CHECK_CHUNK         256     // Bytes verified per RX step
+#define RESYNC_ERRORS       16      // Consecutive bad bytes before re-locating
+#define STATS_INTERVAL_MS   1000
+#define RX_WD_SM            2       // CS watchdog SM for high-speed RX
+
+typedef enum {
+    MODE_BYTE,                      // Per-byte CS (spi_tx_cs / spi_rx_cs)
+    MODE_FRAMED,                    // One CS per packet
+    MODE_FAST,                      // One CS per packet, 6 cycles/bit
+    MODE_COUNT
+} bench_mode_t;
+
+static const char *mode_names[MODE_COUNT] = { "per-byte CS", "framed", "high-speed" };
+
+static const uint32_t packet_sizes[] = {
+    1, 4, 16, 64, 256, 1024, 4096, 16384, 65536
+};
+
+static const uint32_t freqs_hz[] = {
+    1000000, 5000000, 10000000, 12500000, 20000000, 25000000
+};
+
+// Current settings
+static bench_mode_t mode = MODE_FRAMED;
+static pio_spi_dma_width_t width = PIO_SPI_DMA_WIDTH_32;
+static uint size_idx = 7;           // 16 KB
+static uint freq_idx = 2;           // SPI_FREQ_HZ
+static bool tx_enabled = true;
+
+// Instances
+static pio_spi_dma_tx_inst_t tx;
+static pio_spi_dma_rx_inst_t rx;
+static pio_spi_dma_tx_queue_t txq;
+
+// Buffers
+static uint32_t pattern[PATTERN_SIZE / 4];
+static uint8_t rx_ring[1u << RING_BITS] __attribute__((aligned(1u << RING_BITS)));
+static uint8_t rx_chunk[CHECK_CHUNK];
+
+// Stream positions within the pattern
+static uint32_t tx_offset = 0;
+static uint32_t rx_offset = 0;
+static uint32_t rx_bad_run = 0;
+
+// Statistics
+static uint64_t tx_bytes = 0;
+static uint64_t rx_bytes = 0;
+static uint64_t bit_errors = 0;
+static uint32_t resyncs = 0;
+static uint64_t idle_us = 0;
+
+// LED for visual feedback
+#define LED_PIN PICO_DEFAULT_LED_PIN
+
+static void led_init(void) {
+    gpio_init(LED_PIN);
+    gpio_set_dir(LED_PIN, GPIO_OUT);
+    gpio_put(LED_PIN, 0);
+}
+
+static void led_toggle(void) {
+    gpio_xor_mask(1u << LED_PIN);
+}
+
+static void pattern_init(void) {
+    uint32_t x = 0x2545f491u;
+    for (uint i = 0; i < count_of(pattern); i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        pattern[i] = x;
+    }
+}
+
+static uint32_t packet_size(void) {
+    uint32_t size = packet_sizes[size_idx];
+
+    // Word transfers move whole words only
+    if (mode != MODE_BYTE && width == PIO_SPI_DMA_WIDTH_32 && size < 4) {
+        size = 4;
+    }
+    return size;
+}
+
+static void clear_stats(void) {
+    tx_bytes = 0;
+    rx_bytes = 0;
+    bit_errors = 0;
+    resyncs = 0;
+    idle_us = 0;
+}
+
+// ============================================================================
+// Link Setup
+// ============================================================================
+
+static void link_up(void) {
+    float freq = (float)freqs_hz[freq_idx];
+    pio_spi_dma_width_t w = (mode == MODE_BYTE) ? PIO_SPI_DMA_WIDTH_8 : width;
+
+    switch (mode) {
+    case MODE_BYTE:
+        tx = pio_spi_dma_tx_init(pio0, 0, TX_CLK_PIN, TX_DATA_PIN, freq);
+        rx = pio_spi_dma_rx_init(pio0, 1, RX_CS_PIN);
+        break;
+    case MODE_FRAMED:
+        tx = pio_spi_dma_tx_init_framed(pio0, 0, TX_CLK_PIN, TX_DATA_PIN, freq, w, 1);
+        rx = pio_spi_dma_rx_init_framed(pio0, 1, RX_CS_PIN, w, 1);
+        break;
+    default:
+        tx = pio_spi_dma_tx_init_fast(pio0, 0, TX_CLK_PIN, TX_DATA_PIN, freq, w, 1);
+        rx = pio_spi_dma_rx_init_fast(pio0, 1, RX_WD_SM, RX_CS_PIN, w, 1);
+        break;
+    }
+
+    if (!pio_spi_dma_tx_queue_init(&txq, &tx)) {
+        printf("TX queue init FAILED!\n");
+        while (1) { tight_loop_contents(); }
+    }
+
+    pio_spi_dma_rx_ring_start(&rx, rx_ring, RING_BITS);
+
+    tx_offset = 0;
+    rx_offset = 0;
+    rx_bad_run = 0;
+}
+
+static void link_down(void) {
+    pio_spi_dma_tx_queue_deinit(&txq);
+    pio_spi_dma_tx_deinit(&tx);
+    pio_spi_dma_rx_ring_stop(&rx);
+    pio_spi_dma_rx_deinit(&rx);
+}
+
+static void print_settings(void) {
+    printf("\nMode: %s, width: %d bit, packet: %lu B, clock: %.2f MHz, TX %s\n\n",
+           mode_names[mode],
+           (mode == MODE_BYTE || width == PIO_SPI_DMA_WIDTH_8) ? 8 : 32,
+           packet_size(),
+           freqs_hz[freq_idx] / 1000000.0f,
+           tx_enabled ? "running" : "paused");
+}
+
+// ============================================================================
+// TX / RX Service
+// ============================================================================
+
+// Keep the TX queue full. Returns true if any work was done.
+static bool service_tx(void) {
+    if (!tx_enabled) return false;
+
+    uint32_t size = packet_size();
+    bool worked = false;
+
+    // Framed packets take two queue slots (header + payload)
+    while (pio_spi_dma_tx_queue_free(&txq) >= 2) {
+        pio_spi_dma_tx_queue_submit(&txq, (const uint8_t *)pattern + tx_offset, size);
+        tx_offset = (tx_offset + size) & (PATTERN_SIZE - 1);
+        tx_bytes += size;
+        worked = true;
+    }
+    return worked;
+}
+
+// Find a received word in the pattern and continue from there
+static bool rx_resync(const uint8_t *buf) {
+    uint32_t word;
+    memcpy(&word, buf, 4);
+
+    for (uint i = 0; i < count_of(pattern); i++) {
+        if (pattern[i] == word) {
+            rx_offset = (i * 4) & (PATTERN_SIZE - 1);
+            resyncs++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Verify received data. Returns true if any work was done.
+static bool service_rx(void) {
+    size_t len = pio_spi_dma_rx_ring_peek(&rx, rx_chunk, CHECK_CHUNK);
+    if (len == 0) return false;
+
+    const uint8_t *expect = (const uint8_t *)pattern;
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t diff = rx_chunk[i] ^ expect[rx_offset];
+        rx_offset = (rx_offset + 1) & (PATTERN_SIZE - 1);
+
+        if (diff) {
+            bit_errors += __builtin_popcount(diff);
+
+            // Lost or extra bytes: re-locate on the next 4 bytes
+            if (++rx_bad_run >= RESYNC_ERRORS && i + 4 <= len) {
+                if (rx_resync(&rx_chunk[i])) {
+                    rx_offset = (rx_offset + 1) & (PATTERN_SIZE - 1);
+                }
+                rx_bad_run = 0;
+            }
+        } else {
+            rx_bad_run = 0;
+        }
+    }
+
+    pio_spi_dma_rx_ring_consume(&rx, len);
+    rx_bytes += len;
+    return true;
+}
+
+static void print_stats(uint64_t elapsed_us) {
+    if (elapsed_us == 0) return;
+
+    float secs = elapsed_us / 1000000.0f;
+    float tx_mbs = tx_bytes / secs / 1000000.0f;
+    float rx_mbs = rx_bytes / secs / 1000000.0f;
+    float ber = rx_bytes ? (float)bit_errors / (8.0f * (float)rx_bytes) : 0.0f;
+    float cpu = 100.0f * (1.0f - (float)idle_us / (float)elapsed_us);
+
+    printf("TX %.3f MB/s  RX %.3f MB/s  bit errors %llu  BER %.2e  resyncs %lu  CPU %.1f%%\n",
+           tx_mbs, rx_mbs, bit_errors, ber, resyncs, cpu);
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+static bool handle_key(int c) {
+    switch (c) {
+    case 'm': mode = (mode + 1) % MODE_COUNT; return true;
+    case 'w': width = (width == PIO_SPI_DMA_WIDTH_8) ? PIO_SPI_DMA_WIDTH_32 : PIO_SPI_DMA_WIDTH_8; return true;
+    case 's': size_idx = (size_idx + 1) % count_of(packet_sizes); return true;
+    case 'f': freq_idx = (freq_idx + 1) % count_of(freqs_hz); return true;
+    case ' ': tx_enabled = !tx_enabled; return true;
+    case 'c': clear_stats(); return false;
+    default:  return false;
+    }
+}
+
+int main() {
+    // Initialize stdio
+    stdio_init_all();
+
+    // Wait for USB connection and give time to open terminal
+    sleep_ms(3000);
+
+    printf("\n");
+    printf("============================================\n");
+    printf("       PIO SPI LINK THROUGHPUT BENCHMARK\n");
+    printf("============================================\n");
+    printf("\n");
+    printf("System clock: %lu Hz\n", clock_get_hz(clk_sys));
+    printf("Keys: m=mode w=width s=size f=clock c=clear space=pause\n");
+
+    led_init();
+    pattern_init();
+
+    link_up();
+    print_settings();
+
+    uint64_t window_start = time_us_64();
+
+    while (1) {
+        uint64_t t0 = time_us_64();
+        bool worked = service_tx();
+        worked |= service_rx();
+        if (!worked) {
+            idle_us += time_us_64() - t0;
+        }
+
+        // Report once per interval
+        uint64_t now = time_us_64();
+        if (now - window_start >= STATS_INTERVAL_MS * 1000u) {
+            print_stats(now - window_start);
+            clear_stats();
+            led_toggle();
+            window_start = time_us_64();
+        }
+
+        // Settings change: rebuild the link with the new parameters
+        int c = getchar_timeout_us(0);
+        if (c != PICO_ERROR_TIMEOUT && handle_key(c)) {
+            link_down();
+            link_up();
+            print_settings();
+            clear_stats();
+            window_start = time_us_64();
+        }
+    }
+
+    return 0;
+}
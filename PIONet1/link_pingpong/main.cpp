@@ -0,0 +1,172 @@
+/**
+ * PIO SPI Link Ping-Pong (compile-time link configuration)
+ *
+ * Flash this onto BOTH boards (same wiring as ping_master/ping_slave).
+ * Each end sends a PING frame every PING_INTERVAL_MS and answers the
+ * other end's PINGs with a PONG, so both measure the round trip; stats
+ * once per second over USB serial.
+ *
+ * The link is a pio_spi_dma::Link (pio_spi_dma.hpp): PIO block, state
+ * machines, pins, width and DMA channels are template arguments, so each
+ * start is a few stores to fixed registers. Framed, 32-bit words, one
+ * DATA lane at SPI_FREQ_HZ.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/clocks.h"
+#include "pio_spi_dma.hpp"
+#include "pin_config.h"
+
+// Test settings
+#define FRAME_WORDS         16      // Every frame: 64 bytes
+#define PING_INTERVAL_MS    100
+#define STATS_INTERVAL_MS   1000
+#define TX_DMA_CHAN         11      // Fixed channels, taken from the top
+#define RX_DMA_CHAN         10
+
+// Frame: word 0 type, 1 sequence, 2 PING sender's time_us_32(), rest filler
+#define MSG_PING            0x474e4950u     // "PING"
+#define MSG_PONG            0x474e4f50u     // "PONG"
+
+using Port = pio_spi_dma::Link<0, 0,
+                               pio_spi_dma::TxPins<TX_CLK_PIN, TX_DATA_PIN>,
+                               pio_spi_dma::RxPins<RX_CS_PIN>,
+                               PIO_SPI_DMA_WIDTH_32, TX_DMA_CHAN, RX_DMA_CHAN>;
+
+static Port link;
+
+// Buffers: RX alternates so the next frame is armed before one is handled
+static uint32_t rx_frames[2][FRAME_WORDS];
+static uint32_t tx_frame[FRAME_WORDS];
+
+// Statistics (since the last report)
+static uint32_t pings_sent = 0;
+static uint32_t pongs_received = 0;
+static uint32_t pings_answered = 0;
+static uint32_t bad_frames = 0;
+static uint32_t rtt_min_us = UINT32_MAX;
+static uint32_t rtt_max_us = 0;
+static uint64_t rtt_sum_us = 0;
+
+// LED for visual feedback
+#define LED_PIN PICO_DEFAULT_LED_PIN
+
+static void led_init(void) {
+    gpio_init(LED_PIN);
+    gpio_set_dir(LED_PIN, GPIO_OUT);
+    gpio_put(LED_PIN, 0);
+}
+
+static void led_toggle(void) {
+    gpio_xor_mask(1u << LED_PIN);
+}
+
+static void send(uint32_t type, uint32_t seq, uint32_t sent_us) {
+    link.tx.wait();                     // One TX buffer: previous frame must be out
+    tx_frame[0] = type;
+    tx_frame[1] = seq;
+    tx_frame[2] = sent_us;
+    link.tx.start_words(tx_frame, FRAME_WORDS);
+}
+
+static void handle_frame(const uint32_t *frame) {
+    switch (frame[0]) {
+    case MSG_PING:
+        send(MSG_PONG, frame[1], frame[2]);
+        pings_answered++;
+        break;
+
+    case MSG_PONG: {
+        uint32_t rtt = time_us_32() - frame[2];
+        if (rtt < rtt_min_us) rtt_min_us = rtt;
+        if (rtt > rtt_max_us) rtt_max_us = rtt;
+        rtt_sum_us += rtt;
+        pongs_received++;
+        led_toggle();
+        break;
+    }
+
+    default:
+        bad_frames++;
+        break;
+    }
+}
+
+static void print_stats(void) {
+    printf("pings %lu pongs %lu answered %lu bad %lu", pings_sent, pongs_received,
+           pings_answered, bad_frames);
+    if (pongs_received) {
+        printf("  RTT min/avg/max %lu/%lu/%lu us", rtt_min_us,
+               (uint32_t)(rtt_sum_us / pongs_received), rtt_max_us);
+    }
+    printf("\n");
+
+    pings_sent = pongs_received = pings_answered = bad_frames = 0;
+    rtt_min_us = UINT32_MAX;
+    rtt_max_us = 0;
+    rtt_sum_us = 0;
+}
+
+int main() {
+    // Initialize stdio
+    stdio_init_all();
+
+    // Wait for USB connection
+    sleep_ms(3000);
+
+    printf("\n");
+    printf("============================================\n");
+    printf("       PIO SPI LINK PING-PONG (C++)\n");
+    printf("============================================\n");
+    printf("\n");
+    printf("System clock: %lu Hz\n", clock_get_hz(clk_sys));
+    printf("Link clock:   %.1f MHz (framed, 32-bit, 1 lane)\n", SPI_FREQ_HZ / 1000000.0f);
+    printf("Frame:        %u bytes\n\n", (uint)(FRAME_WORDS * sizeof(uint32_t)));
+
+    led_init();
+
+    printf("Initializing link (TX DMA ch %u, RX DMA ch %u)... ", TX_DMA_CHAN, RX_DMA_CHAN);
+    if (!link.init(SPI_FREQ_HZ)) {
+        printf("FAILED!\n");
+        while (1) { tight_loop_contents(); }
+    }
+    printf("OK\n\n");
+
+    // Filler words the same on both ends, so a bit error shows as a bad type
+    for (uint i = 3; i < FRAME_WORDS; i++) {
+        tx_frame[i] = 0x01010101u * i;
+    }
+
+    uint rx_idx = 0;
+    link.rx.start_words(rx_frames[rx_idx], FRAME_WORDS);
+
+    uint32_t seq = 0;
+    absolute_time_t next_ping = make_timeout_time_ms(PING_INTERVAL_MS);
+    absolute_time_t next_stats = make_timeout_time_ms(STATS_INTERVAL_MS);
+
+    while (1) {
+        if (!link.rx.busy()) {
+            const uint32_t *frame = rx_frames[rx_idx];
+            rx_idx ^= 1;
+            link.rx.start_words(rx_frames[rx_idx], FRAME_WORDS);
+            handle_frame(frame);
+        }
+
+        if (time_reached(next_ping)) {
+            next_ping = make_timeout_time_ms(PING_INTERVAL_MS);
+            send(MSG_PING, seq++, time_us_32());
+            pings_sent++;
+        }
+
+        if (time_reached(next_stats)) {
+            next_stats = make_timeout_time_ms(STATS_INTERVAL_MS);
+            print_stats();
+        }
+    }
+
+    return 0;
+}
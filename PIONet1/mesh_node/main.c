@@ -0,0 +1,356 @@
+/**
+ * PIO SPI Mesh Node
+ *
+ * One node of a 2D nearest-neighbour mesh. Brings up N/E/S/W links,
+ * works out its (x,y) coordinate from its neighbours and routes packets
+ * for any node through the grid.
+ *
+ * Flash this onto every board. Ground MESH_ROOT_PIN on the corner board
+ * that becomes (0,0); the rest locate themselves from it.
+ *
+ * Keys over USB serial:
+ *   s - show address, links and counters
+ *   t - telemetry: one line of driver counters per TX/RX, for a host to poll
+ *   c - clock sync to the root: offset, drift and fit residual
+ *   p - ping every node in the PING_GRID_W x PING_GRID_H corner of the mesh
+ *   b - (root) broadcast a BCAST_TEST_SIZE byte message to every node
+ *   r - (root) census: allreduce node count and mesh extent
+ *   g - (root) time BARRIER_ROUNDS global barriers on the sync line
+ *
+ * With MESH_ON_CORE1 the links, routing and their interrupts live on
+ * core1 and this loop only talks to them through mesh_core1.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/clocks.h"
+#include "mesh.h"
+#include "mesh_collective.h"
+#include "mesh_core1.h"
+#include "mesh_time.h"
+#include "pio_barrier.h"
+#include "mesh_pins.h"
+
+// Application packet types
+#define APP_TYPE_PING       1
+#define APP_TYPE_PONG       2
+
+// Ping sweep area
+#define PING_GRID_W         4
+#define PING_GRID_H         4
+
+// Broadcast tags
+#define APP_TAG_DATA        1       // Test payload
+#define APP_TAG_CENSUS      2       // Everyone joins the census reductions
+#define APP_TAG_BARRIER     3       // Everyone runs the barrier test
+
+#define BARRIER_ROUNDS      1000
+#define BARRIER_PIO         pio2    // Beside RX S/W (framed programs leave room)
+#define BARRIER_SM          2
+
+#define BCAST_TEST_SIZE     16384
+#define COLL_TIMEOUT_MS     1000
+
+// Application side of the stack: same calls whichever core it runs on
+#if MESH_ON_CORE1
+#define net_alloc           mesh_core1_alloc
+#define net_send            mesh_core1_send
+#define net_recv            mesh_core1_recv
+#define net_free            mesh_core1_free
+#define net_call            mesh_core1_call
+#else
+#define net_alloc           mesh_alloc
+#define net_send            mesh_send
+#define net_recv            mesh_recv
+#define net_free            mesh_free
+#define net_call(fn, arg)   (fn)(arg)
+#endif
+
+static pio_barrier_t barrier;
+static bool barrier_ok;
+
+static uint8_t bcast_buf[BCAST_TEST_SIZE];
+static uint32_t bcast_bytes;
+static uint32_t bcast_start_us;
+
+typedef struct {
+    uint32_t sent_us;           // Sender's timestamp, echoed back
+} ping_payload_t;
+
+// LED for visual feedback
+#define LED_PIN PICO_DEFAULT_LED_PIN
+
+static void led_init(void) {
+    gpio_init(LED_PIN);
+    gpio_set_dir(LED_PIN, GPIO_OUT);
+    gpio_put(LED_PIN, 0);
+}
+
+static void led_toggle(void) {
+    gpio_xor_mask(1u << LED_PIN);
+}
+
+static bool read_root_strap(void) {
+    gpio_init(MESH_ROOT_PIN);
+    gpio_set_dir(MESH_ROOT_PIN, GPIO_IN);
+    gpio_pull_up(MESH_ROOT_PIN);
+    sleep_us(10);
+    return !gpio_get(MESH_ROOT_PIN);
+}
+
+static void ping_sweep(void) {
+    if (mesh_addr() == MESH_ADDR_NONE) {
+        printf("Not located yet\n");
+        return;
+    }
+
+    for (uint y = 0; y < PING_GRID_H; y++) {
+        for (uint x = 0; x < PING_GRID_W; x++) {
+            uint16_t dst = MESH_ADDR(x, y);
+            if (dst == mesh_addr()) continue;
+
+            pio_spi_packet_t *pkt = net_alloc();
+            if (!pkt) {
+                printf("Pool empty\n");
+                return;
+            }
+
+            ping_payload_t ping = { .sent_us = time_us_32() };
+            memcpy(pkt->payload, &ping, sizeof(ping));
+            if (!net_send(pkt, dst, APP_TYPE_PING, sizeof(ping))) {
+                printf("PING (%u,%u): no route\n", x, y);
+            }
+            sleep_ms(1);    // Don't overrun the output queues
+        }
+    }
+}
+
+// Two rounds: SUM of 1 (node count), then MAX of the coordinates (stack core)
+static uint32_t run_census(void *arg) {
+    (void)arg;
+    uint32_t count[1] = { 1 };
+    uint32_t extent[2] = { MESH_ADDR_X(mesh_addr()), MESH_ADDR_Y(mesh_addr()) };
+
+    if (!mesh_allreduce(MESH_REDUCE_SUM, count, 1, COLL_TIMEOUT_MS) ||
+        !mesh_allreduce(MESH_REDUCE_MAX, extent, 2, COLL_TIMEOUT_MS)) {
+        printf("Census timed out\n");
+        return 0;
+    }
+    printf("Census: %lu nodes, mesh %lu x %lu\n", count[0], extent[0] + 1, extent[1] + 1);
+    return 1;
+}
+
+// Driver counters of every link direction, timestamped (stack core)
+static uint32_t print_telemetry(void *arg) {
+    (void)arg;
+    pio_spi_dma_telemetry_t t[NUM_DMA_CHANNELS];
+    uint n = pio_spi_dma_telemetry_snapshot(t, NUM_DMA_CHANNELS);
+    uint32_t now = time_us_32();
+
+    for (uint i = 0; i < n; i++) {
+        const pio_spi_dma_stats_t *s = &t[i].stats;
+        printf("T %lu pio%u sm%u %s frames=%lu bytes=%lu aborted=%lu overflows=%lu crc=%lu busy=%lu\n",
+               now, t[i].pio, t[i].sm, t[i].rx ? "rx" : "tx", s->frames, s->bytes,
+               s->aborted, s->fifo_overflows, s->crc_errors, s->busy_cycles);
+    }
+    return n;
+}
+
+// Mesh clock model (stack core)
+static uint32_t print_clock(void *arg) {
+    (void)arg;
+    mesh_time_print_status();
+    return 0;
+}
+
+// Tell every node to do something (root, stack core)
+static uint32_t send_command(void *arg) {
+    uint8_t cmd = 0;
+    return mesh_bcast(&cmd, sizeof(cmd), (uint8_t)(uintptr_t)arg, COLL_TIMEOUT_MS);
+}
+
+static void run_barrier_test(void) {
+    if (!barrier_ok) {
+        printf("No barrier SM\n");
+        return;
+    }
+
+    uint32_t t0 = time_us_32();
+    for (uint i = 0; i < BARRIER_ROUNDS; i++) {
+        pio_barrier(&barrier);
+    }
+    uint32_t us = time_us_32() - t0;
+    printf("Barrier: %u rounds in %lu us (%lu ns each)\n",
+           BARRIER_ROUNDS, us, us * 1000u / BARRIER_ROUNDS);
+}
+
+static uint32_t root_broadcast(void *arg) {
+    (void)arg;
+    for (uint i = 0; i < sizeof(bcast_buf); i++) {
+        bcast_buf[i] = (uint8_t)i;
+    }
+
+    uint32_t t0 = time_us_32();
+    if (!mesh_bcast(bcast_buf, sizeof(bcast_buf), APP_TAG_DATA, COLL_TIMEOUT_MS)) {
+        printf("Broadcast failed\n");
+        return 0;
+    }
+    printf("Broadcast %u bytes queued in %lu us\n", sizeof(bcast_buf), time_us_32() - t0);
+    return 1;
+}
+
+static void handle_bcast(const pio_spi_packet_t *pkt) {
+    const mesh_bcast_hdr_t *hdr = mesh_bcast_header(pkt);
+
+    if (hdr->tag == APP_TAG_CENSUS) {
+        net_call(run_census, NULL);
+        return;
+    }
+    if (hdr->tag == APP_TAG_BARRIER) {
+        run_barrier_test();
+        return;
+    }
+
+    if (hdr->offset == 0) {
+        bcast_bytes = 0;
+        bcast_start_us = time_us_32();
+    }
+    bcast_bytes += mesh_bcast_len(pkt);
+
+    if (hdr->flags & MESH_BCAST_LAST) {
+        uint32_t us = time_us_32() - bcast_start_us;
+        printf("Broadcast %u: %lu/%lu bytes in %lu us\n", hdr->id, bcast_bytes, hdr->total, us);
+    }
+}
+
+static void handle_packet(pio_spi_packet_t *pkt) {
+    uint16_t src = pkt->hdr.src;
+
+    switch (pkt->hdr.type) {
+    case APP_TYPE_PING:
+        // Echo the payload straight back in the same buffer
+        net_send(pkt, src, APP_TYPE_PONG, pkt->hdr.len);
+        led_toggle();
+        return;
+
+    case APP_TYPE_PONG: {
+        ping_payload_t ping;
+        memcpy(&ping, pkt->payload, sizeof(ping));
+        uint32_t hops = (uint32_t)abs((int)MESH_ADDR_X(src) - (int)MESH_ADDR_X(mesh_addr())) +
+                        (uint32_t)abs((int)MESH_ADDR_Y(src) - (int)MESH_ADDR_Y(mesh_addr()));
+        printf("PONG from (%u,%u): %lu hops, RTT %lu us\n",
+               MESH_ADDR_X(src), MESH_ADDR_Y(src), hops, time_us_32() - ping.sent_us);
+        break;
+    }
+
+    case MESH_TYPE_BCAST:
+        handle_bcast(pkt);
+        break;
+
+    default:
+        break;
+    }
+
+    net_free(pkt);
+}
+
+int main() {
+    // Initialize stdio
+    stdio_init_all();
+
+    // Wait for USB connection and give time to open terminal
+    sleep_ms(3000);
+
+    printf("\n");
+    printf("============================================\n");
+    printf("       PIO SPI MESH NODE\n");
+    printf("============================================\n");
+    printf("\n");
+    printf("System clock: %lu Hz\n", clock_get_hz(clk_sys));
+    printf("Link clock:   %.1f MHz%s (%s, %s)\n", MESH_FREQ_HZ / 1000000.0f,
+           MESH_TRAIN ? " until trained" : "",
+           MESH_FRAMED ? "framed" : "per-byte CS",
+           MESH_RELIABLE ? "reliable" :
+           MESH_CUT_THROUGH ? "cut-through" : "store-and-forward");
+    printf("Keys: s=status t=telemetry c=clock p=ping sweep b=broadcast r=census g=barrier\n\n");
+
+    led_init();
+
+    mesh_config_t cfg = {
+        .freq_hz = MESH_FREQ_HZ,
+        .framed = MESH_FRAMED,
+        .cut_through = MESH_CUT_THROUGH,
+        .reliable = MESH_RELIABLE,
+        .train = MESH_TRAIN,
+        .root = read_root_strap(),
+    };
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        cfg.pins[p].tx_clk = MESH_PORT_BASE(p) + MESH_TX_CLK_OFS;
+        cfg.pins[p].tx_data = MESH_PORT_BASE(p) + MESH_TX_DATA_OFS;
+        cfg.pins[p].rx_cs = MESH_PORT_BASE(p) + MESH_RX_CS_OFS;
+    }
+
+    printf("Initializing mesh links%s%s... ", cfg.root ? " (root)" : "",
+           MESH_ON_CORE1 ? " on core1" : "");
+#if MESH_ON_CORE1
+    if (!mesh_core1_launch(&cfg)) {
+#else
+    if (!mesh_init(&cfg)) {
+#endif
+        printf("FAILED!\n");
+        while (1) { tight_loop_contents(); }
+    }
+    printf("OK\n");
+    if (MESH_TRAIN) {
+        mesh_print_status();            // Trained rate and margin per port
+    }
+
+    printf("Initializing barrier... ");
+    barrier_ok = pio_barrier_init(&barrier, BARRIER_PIO, BARRIER_SM, MESH_BARRIER_PIN,
+                                  PIO_BARRIER_HOLD_NS);
+    printf("%s\n", barrier_ok ? "OK" : "no room in PIO (per-byte CS links)");
+
+    uint16_t last_addr = MESH_ADDR_NONE;
+
+    while (1) {
+#if !MESH_ON_CORE1
+        mesh_poll();
+#endif
+
+        pio_spi_packet_t *pkt;
+        while ((pkt = net_recv()) != NULL) {
+            handle_packet(pkt);
+        }
+
+        // Report once when the coordinate is learned
+        if (mesh_addr() != last_addr) {
+            last_addr = mesh_addr();
+            printf("Located at (%u,%u)\n", MESH_ADDR_X(last_addr), MESH_ADDR_Y(last_addr));
+        }
+
+        int c = getchar_timeout_us(0);
+        if (c == 's') {
+            mesh_print_status();
+        } else if (c == 't') {
+            net_call(print_telemetry, NULL);
+        } else if (c == 'c') {
+            net_call(print_clock, NULL);
+        } else if (c == 'p') {
+            ping_sweep();
+        } else if (c == 'b' && cfg.root) {
+            net_call(root_broadcast, NULL);
+        } else if (c == 'r' && cfg.root) {
+            net_call(send_command, (void *)APP_TAG_CENSUS);
+            net_call(run_census, NULL);
+        } else if (c == 'g' && cfg.root) {
+            net_call(send_command, (void *)APP_TAG_BARRIER);
+            run_barrier_test();
+        }
+    }
+
+    return 0;
+}
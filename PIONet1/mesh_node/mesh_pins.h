@@ -0,0 +1,50 @@
+/**
+ * Pin Definitions for the Mesh Node
+ * 
+ * Every node uses the same map. Each port is 6 consecutive GPIOs:
+ * 
+ *   base + 0  TX_CLK   ──>  neighbour's RX_CLK  (base + 4)
+ *   base + 1  TX_CS    ──>  neighbour's RX_CS   (base + 3)
+ *   base + 2  TX_DATA  ──>  neighbour's RX_DATA (base + 5)
+ *   base + 3  RX_CS    <──  neighbour's TX_CS   (base + 1)
+ *   base + 4  RX_CLK   <──  neighbour's TX_CLK  (base + 0)
+ *   base + 5  RX_DATA  <──  neighbour's TX_DATA (base + 2)
+ * 
+ * Cabling: N port to the neighbour's S port, E port to its W port.
+ * 
+ *   Port   Base GPIO
+ *   ────   ─────────
+ *   N      0
+ *   E      6
+ *   S      12
+ *   W      18
+ * 
+ * Total: 24 signal wires per node + ground to each neighbour
+ */
+
+#ifndef MESH_PINS_H
+#define MESH_PINS_H
+
+#define MESH_PORT_PINS      6
+#define MESH_PORT_BASE(p)   ((p) * MESH_PORT_PINS)
+
+// Offsets within a port (TX CLK/CS adjacent, RX CS/CLK/DATA consecutive)
+#define MESH_TX_CLK_OFS     0
+#define MESH_TX_DATA_OFS    2
+#define MESH_RX_CS_OFS      3
+
+// Strap: tie to GND on the one board that is node (0,0)
+#define MESH_ROOT_PIN       26
+
+// Barrier sync line: wire together across every board (open drain, pulled up)
+#define MESH_BARRIER_PIN    27
+
+// Communication settings
+#define MESH_FREQ_HZ        10000000  // 10 MHz
+#define MESH_FRAMED         1         // One CS per packet
+#define MESH_CUT_THROUGH    1         // Stream transit packets PIO to PIO
+#define MESH_RELIABLE       0         // Per-hop ACK and resend (disables cut-through)
+#define MESH_TRAIN          0         // Train each port's rate at boot (MESH_FREQ_HZ is the safe rate)
+#define MESH_ON_CORE1       0         // Network stack on core1, this loop alone on core0
+
+#endif // MESH_PINS_H
@@ -0,0 +1,224 @@
+/**
+ * PIO SPI Mesh Network Boot Loader
+ *
+ * Resident loader for every board: brings up the mesh, receives one
+ * kernel image over the broadcast tree, checks it and runs it from SRAM
+ * (see mesh_boot.h). Flash this once; after that a new kernel goes onto
+ * the root's flash slot only and reaches the whole machine at link rate.
+ *
+ * Boot sequence on every node:
+ *   1. Locate in the mesh, then wait NET_BOOT_SETTLE_MS for the rest
+ *   2. Allreduce: count the nodes
+ *   3. Root broadcasts the image from NET_BOOT_FLASH_OFFSET; the others
+ *      stage and verify it
+ *   4. Allreduce: count good copies; all good -> everyone runs it,
+ *      otherwise the root sends it again
+ *
+ * Any timeout reboots the loader (watchdog), so the machine converges
+ * after a power glitch or a late board: the root broadcasts a restart
+ * first so every node starts over with it, and a node that hears
+ * nothing from the root for NET_BOOT_WAIT_MS starts over by itself.
+ * Console on the UART.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/clocks.h"
+#include "hardware/watchdog.h"
+#include "mesh.h"
+#include "mesh_boot.h"
+#include "mesh_pins.h"
+
+/** Root's image slot: mesh_boot_hdr_t then the image (picotool load -o) */
+#ifndef NET_BOOT_FLASH_OFFSET
+#define NET_BOOT_FLASH_OFFSET   (1024 * 1024)
+#endif
+
+/** Largest image; staged in this loader's own SRAM */
+#ifndef NET_BOOT_MAX_IMAGE
+#define NET_BOOT_MAX_IMAGE      (384 * 1024)
+#endif
+
+/** Time for the whole mesh to locate before the first collective */
+#ifndef NET_BOOT_SETTLE_MS
+#define NET_BOOT_SETTLE_MS      2000
+#endif
+
+/** Wait for each collective before starting over */
+#ifndef NET_BOOT_WAIT_MS
+#define NET_BOOT_WAIT_MS        30000
+#endif
+
+#define NET_BOOT_ATTEMPTS       3
+
+/** Broadcast tag: root is starting over, everyone follow */
+#define NET_BOOT_TAG_RESTART    0xfc
+
+/** Time to keep the links up so the restart broadcast gets out */
+#define NET_BOOT_RESTART_DRAIN_MS 100
+
+static uint8_t stage[NET_BOOT_MAX_IMAGE] __attribute__((aligned(4)));
+static mesh_boot_t boot;
+static bool is_root;
+
+// LED for visual feedback
+#define LED_PIN PICO_DEFAULT_LED_PIN
+
+static void led_init(void) {
+    gpio_init(LED_PIN);
+    gpio_set_dir(LED_PIN, GPIO_OUT);
+    gpio_put(LED_PIN, 0);
+}
+
+static bool read_root_strap(void) {
+    gpio_init(MESH_ROOT_PIN);
+    gpio_set_dir(MESH_ROOT_PIN, GPIO_IN);
+    gpio_pull_up(MESH_ROOT_PIN);
+    sleep_us(10);
+    return !gpio_get(MESH_ROOT_PIN);
+}
+
+static void __attribute__((noreturn)) start_over(const char *why) {
+    printf("%s: restarting loader\n", why);
+
+    // Take the rest of the machine along, or its collectives stay out of
+    // step with ours (best effort: the tree may be what failed)
+    if (is_root && mesh_bcast(NULL, 0, NET_BOOT_TAG_RESTART, NET_BOOT_RESTART_DRAIN_MS)) {
+        absolute_time_t drain = make_timeout_time_ms(NET_BOOT_RESTART_DRAIN_MS);
+        while (!time_reached(drain)) {
+            mesh_poll();
+        }
+    }
+    sleep_ms(10);                       // Let the UART drain
+    watchdog_reboot(0, 0, 0);
+    while (1) { tight_loop_contents(); }
+}
+
+// Sum one word over every node, or start over
+static uint32_t sum_all(uint32_t v, const char *what) {
+    if (!mesh_allreduce(MESH_REDUCE_SUM, &v, 1, NET_BOOT_WAIT_MS)) {
+        start_over(what);
+    }
+    return v;
+}
+
+// Root: send the flash image until every node holds it, then run it
+static void __attribute__((noreturn)) boot_root(uint32_t nodes) {
+    const mesh_boot_hdr_t *hdr = (const mesh_boot_hdr_t *)(XIP_BASE + NET_BOOT_FLASH_OFFSET);
+    const uint8_t *image = (const uint8_t *)(hdr + 1);
+
+    if (!mesh_boot_header_ok(&boot, hdr)) {
+        printf("No valid image at flash offset 0x%x\n", NET_BOOT_FLASH_OFFSET);
+        while (1) { tight_loop_contents(); }
+    }
+
+    for (uint attempt = 1; attempt <= NET_BOOT_ATTEMPTS; attempt++) {
+        uint32_t t0 = time_us_32();
+        if (!mesh_boot_send(&boot, hdr, image, NET_BOOT_WAIT_MS)) {
+            start_over("Image CRC mismatch or broadcast timeout");
+        }
+        uint32_t us = time_us_32() - t0;
+
+        uint32_t good = sum_all(1, "Verify round");
+        printf("Image %lu bytes @ 0x%08lx in %lu us: %lu/%lu nodes good\n",
+               hdr->size, hdr->load_addr, us, good, nodes);
+        if (good == nodes) {
+            mesh_boot_exec(&boot, hdr, image);
+        }
+    }
+    start_over("Nodes kept failing the image");
+}
+
+// Everyone else: stage images until the whole machine has a good one
+static void __attribute__((noreturn)) boot_node(uint32_t nodes) {
+    absolute_time_t deadline = make_timeout_time_ms(NET_BOOT_WAIT_MS);
+
+    while (1) {
+        mesh_poll();
+
+        pio_spi_packet_t *pkt;
+        while ((pkt = mesh_recv()) != NULL) {
+            if (pkt->hdr.type == MESH_TYPE_BCAST &&
+                mesh_bcast_header(pkt)->tag == NET_BOOT_TAG_RESTART) {
+                start_over("Root restarted");
+            }
+            if (mesh_boot_receive(&boot, pkt)) {
+                deadline = make_timeout_time_ms(NET_BOOT_WAIT_MS);
+            }
+            mesh_free(pkt);
+        }
+
+        // Root went quiet (it may have restarted without reaching us)
+        if (time_reached(deadline)) {
+            start_over("No image from the root");
+        }
+
+        mesh_boot_state_t state = mesh_boot_state(&boot);
+        if (state == MESH_BOOT_READY || state == MESH_BOOT_BAD) {
+            bool ok = state == MESH_BOOT_READY;
+            uint32_t good = sum_all(ok, "Verify round");
+            if (good == nodes) {
+                mesh_boot_exec(&boot, &boot.hdr, boot.stage);
+            }
+            printf("Image %s here, %lu/%lu nodes good: waiting for a resend\n",
+                   ok ? "good" : "bad", good, nodes);
+            mesh_boot_reset(&boot);
+            deadline = make_timeout_time_ms(NET_BOOT_WAIT_MS);
+        }
+    }
+}
+
+int main() {
+    stdio_init_all();
+
+    printf("\n");
+    printf("============================================\n");
+    printf("       PIO SPI MESH NETWORK BOOT\n");
+    printf("============================================\n");
+    printf("\n");
+    printf("System clock: %lu Hz\n", clock_get_hz(clk_sys));
+
+    led_init();
+
+    mesh_config_t cfg = {
+        .freq_hz = MESH_FREQ_HZ,
+        .framed = MESH_FRAMED,
+        .cut_through = MESH_CUT_THROUGH,
+        .reliable = MESH_RELIABLE,
+        .train = MESH_TRAIN,
+        .root = read_root_strap(),
+    };
+    is_root = cfg.root;
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        cfg.pins[p].tx_clk = MESH_PORT_BASE(p) + MESH_TX_CLK_OFS;
+        cfg.pins[p].tx_data = MESH_PORT_BASE(p) + MESH_TX_DATA_OFS;
+        cfg.pins[p].rx_cs = MESH_PORT_BASE(p) + MESH_RX_CS_OFS;
+    }
+
+    if (!mesh_init(&cfg) || !mesh_boot_init(&boot, stage, sizeof(stage))) {
+        printf("Mesh init FAILED!\n");
+        while (1) { tight_loop_contents(); }
+    }
+
+    // Locate, then give the rest of the machine time to do the same
+    while (mesh_addr() == MESH_ADDR_NONE) {
+        mesh_poll();
+    }
+    printf("Located at (%u,%u)%s\n", MESH_ADDR_X(mesh_addr()), MESH_ADDR_Y(mesh_addr()),
+           cfg.root ? " (root)" : "");
+    absolute_time_t settle = make_timeout_time_ms(NET_BOOT_SETTLE_MS);
+    while (!time_reached(settle)) {
+        mesh_poll();
+    }
+    gpio_put(LED_PIN, 1);
+
+    uint32_t nodes = sum_all(1, "Node count");
+    printf("%lu nodes\n", nodes);
+
+    if (cfg.root) {
+        boot_root(nodes);
+    }
+    boot_node(nodes);
+}
@@ -0,0 +1,174 @@
+/**
+ * PIO SPI Mesh SIMD Array
+ *
+ * Runs the mesh_pe.h runtime on every node. The root is the controller:
+ * it broadcasts short programs and every node executes them in lockstep
+ * over its MESH_PE_TILE_W x MESH_PE_TILE_H lanes.
+ *
+ * Keys over USB serial (root):
+ *   s - show address, links and counters
+ *   c - count PEs and check shifts in all four directions
+ *   j - time STENCIL_STEPS steps of a 4-neighbour Jacobi-style smoothing
+ *
+ * Flash onto every board (or net boot it); the rest just serve programs.
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/clocks.h"
+#include "mesh.h"
+#include "mesh_pe.h"
+#include "mesh_pins.h"
+
+#define STENCIL_STEPS       100
+
+// Register names for the demo programs
+enum { R0, R1, R2, R3, R4, R5, R6, R7, R8, R9 };
+
+#define I(op, d, a, imm)    MESH_PE_INSN(MESH_PE_##op, d, a, imm)
+
+// LED for visual feedback
+#define LED_PIN PICO_DEFAULT_LED_PIN
+
+static void led_init(void) {
+    gpio_init(LED_PIN);
+    gpio_set_dir(LED_PIN, GPIO_OUT);
+    gpio_put(LED_PIN, 0);
+}
+
+static bool read_root_strap(void) {
+    gpio_init(MESH_ROOT_PIN);
+    gpio_set_dir(MESH_ROOT_PIN, GPIO_IN);
+    gpio_pull_up(MESH_ROOT_PIN);
+    sleep_us(10);
+    return !gpio_get(MESH_ROOT_PIN);
+}
+
+// PE count, then how many PEs see their west/east/south/north neighbour's
+// x or y after a shift (all but one edge row or column each)
+static void run_check(void) {
+    static const uint32_t prog[] = {
+        I(LDI,   R9, 0, 1),
+        I(RSUM,  R8, R9, 0),                        // R8 = PEs
+        I(COORD, R0, 0, 0),                         // R0 = x
+        I(COORD, R1, 0, 1),                         // R1 = y
+        I(ADDI,  R2, R0, 2),                        // Offset so the edge's 0 never matches
+        I(ADDI,  R3, R1, 2),
+        I(SHIFT, R4, R2, MESH_PORT_E),              // West PE's: x+1
+        I(SHIFT, R5, R2, MESH_PORT_W),              // East PE's: x+3
+        I(SHIFT, R6, R3, MESH_PORT_N),              // South PE's: y+1
+        I(SHIFT, R7, R3, MESH_PORT_S),              // North PE's: y+3
+        I(ADDI,  R9, R0, 1),
+        I(EQ,    R4, R4, R9),
+        I(ADDI,  R9, R0, 3),
+        I(EQ,    R5, R5, R9),
+        I(ADDI,  R9, R1, 1),
+        I(EQ,    R6, R6, R9),
+        I(ADDI,  R9, R1, 3),
+        I(EQ,    R7, R7, R9),
+        I(RSUM,  R0, R4, 0),
+        I(RSUM,  R1, R5, 0),
+        I(RSUM,  R2, R6, 0),
+        I(RSUM,  R3, R7, 0),
+    };
+
+    uint32_t t0 = time_us_32();
+    int err = mesh_pe_issue(prog, count_of(prog));
+    uint32_t us = time_us_32() - t0;
+
+    printf("PEs %lu  shift ok E %lu W %lu N %lu S %lu  errors %d  (%lu us)\n",
+           mesh_pe_reg(R8)[0], mesh_pe_reg(R0)[0], mesh_pe_reg(R1)[0],
+           mesh_pe_reg(R2)[0], mesh_pe_reg(R3)[0], err, us);
+}
+
+// Each step: every PE becomes the mean of its four neighbours
+static void run_stencil(void) {
+    static uint32_t prog[4 + STENCIL_STEPS * 8 + 1];
+    uint n = 0;
+
+    prog[n++] = I(COORD, R0, 0, 0);
+    prog[n++] = I(COORD, R1, 0, 1);
+    prog[n++] = I(MUL,   R0, R0, R1);               // Some uneven start
+    prog[n++] = I(LDI,   R6, 0, 2);
+    for (uint i = 0; i < STENCIL_STEPS; i++) {
+        prog[n++] = I(SHIFT, R2, R0, MESH_PORT_E);
+        prog[n++] = I(SHIFT, R3, R0, MESH_PORT_W);
+        prog[n++] = I(SHIFT, R4, R0, MESH_PORT_N);
+        prog[n++] = I(SHIFT, R5, R0, MESH_PORT_S);
+        prog[n++] = I(ADD,   R2, R2, R3);
+        prog[n++] = I(ADD,   R4, R4, R5);
+        prog[n++] = I(ADD,   R0, R2, R4);
+        prog[n++] = I(SHR,   R0, R0, R6);
+    }
+    prog[n++] = I(RSUM,  R7, R0, 0);
+
+    uint32_t t0 = time_us_32();
+    int err = mesh_pe_issue(prog, n);
+    uint32_t us = time_us_32() - t0;
+
+    printf("Stencil: %u steps, %u ops in %lu us, sum %lu, errors %d\n",
+           STENCIL_STEPS, n, us, mesh_pe_reg(R7)[0], err);
+}
+
+int main() {
+    stdio_init_all();
+
+    // Wait for USB connection and give time to open terminal
+    sleep_ms(3000);
+
+    printf("\n");
+    printf("============================================\n");
+    printf("       PIO SPI MESH SIMD ARRAY\n");
+    printf("============================================\n");
+    printf("\n");
+    printf("System clock: %lu Hz\n", clock_get_hz(clk_sys));
+    printf("Tile:         %u x %u PEs per node\n", MESH_PE_TILE_W, MESH_PE_TILE_H);
+    printf("Keys: s=status c=check j=stencil\n\n");
+
+    led_init();
+
+    mesh_config_t cfg = {
+        .freq_hz = MESH_FREQ_HZ,
+        .framed = MESH_FRAMED,
+        .cut_through = MESH_CUT_THROUGH,
+        .reliable = MESH_RELIABLE,
+        .train = MESH_TRAIN,
+        .root = read_root_strap(),
+    };
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        cfg.pins[p].tx_clk = MESH_PORT_BASE(p) + MESH_TX_CLK_OFS;
+        cfg.pins[p].tx_data = MESH_PORT_BASE(p) + MESH_TX_DATA_OFS;
+        cfg.pins[p].rx_cs = MESH_PORT_BASE(p) + MESH_RX_CS_OFS;
+    }
+
+    printf("Initializing mesh links%s... ", cfg.root ? " (root)" : "");
+    if (!mesh_init(&cfg)) {
+        printf("FAILED!\n");
+        while (1) { tight_loop_contents(); }
+    }
+    printf("OK\n");
+
+    mesh_pe_init();
+
+    while (1) {
+        if (!cfg.root) {
+            if (mesh_pe_poll()) {
+                gpio_xor_mask(1u << LED_PIN);
+            }
+            continue;
+        }
+
+        mesh_poll();
+        int c = getchar_timeout_us(0);
+        if (c == 's') {
+            mesh_print_status();
+        } else if (c == 'c') {
+            run_check();
+        } else if (c == 'j') {
+            run_stencil();
+        }
+    }
+
+    return 0;
+}
@@ -2,7 +2,7 @@
  * PIO SPI Ping Master
  * 
  * Sends ping bytes to slave, waits for echo response.
- * Measures round-trip time and reports statistics.
+ * Measures round-trip time in CPU cycles and reports percentiles.
  * 
  * Flash this onto Board A (the "master").
  */
@@ -14,6 +14,7 @@
 #include "hardware/gpio.h"
 #include "hardware/clocks.h"
 #include "pio_spi_dma.h"
+#include "latency_hist.h"
 #include "pin_config.h"
 
 // Test settings
@@ -30,9 +31,7 @@ static uint32_t pings_sent = 0;
 static uint32_t pongs_received = 0;
 static uint32_t timeouts = 0;
 static uint32_t errors = 0;
-static uint64_t total_rtt_us = 0;
-static uint32_t min_rtt_us = UINT32_MAX;
-static uint32_t max_rtt_us = 0;
+static latency_hist_t rtt_hist;
 
 // LED for visual feedback
 #define LED_PIN PICO_DEFAULT_LED_PIN
@@ -53,8 +52,7 @@ static void print_stats(void) {
            pings_sent, pongs_received, timeouts, errors);
     
     if (pongs_received > 0) {
-        uint32_t avg_rtt = (uint32_t)(total_rtt_us / pongs_received);
-        printf("RTT min/avg/max = %lu/%lu/%lu us\n", min_rtt_us, avg_rtt, max_rtt_us);
+        latency_hist_print(&rtt_hist, "RTT");
         
         float loss = 100.0f * (float)(pings_sent - pongs_received) / (float)pings_sent;
         printf("Packet loss: %.1f%%\n", loss);
@@ -112,6 +110,10 @@ int main() {
     // Initialize LED
     led_init();
     
+    // Cycle-counter timestamps for RTT
+    latency_timer_init();
+    latency_hist_reset(&rtt_hist);
+    
     // Initialize TX
     printf("Initializing TX... ");
     tx = pio_spi_dma_tx_init(pio0, 0, TX_CLK_PIN, TX_DATA_PIN, SPI_FREQ_HZ);
@@ -149,7 +151,7 @@ int main() {
         pio_spi_dma_rx_start(&rx, &rx_byte, 1);
         
         // Record start time
-        absolute_time_t start = get_absolute_time();
+        uint32_t start = latency_now();
         
         // Send ping
         pio_spi_dma_tx_blocking(&tx, &tx_byte, 1);
@@ -169,17 +171,14 @@ int main() {
         
         if (got_response) {
             // Calculate RTT
-            absolute_time_t end = get_absolute_time();
-            uint32_t rtt_us = (uint32_t)absolute_time_diff_us(start, end);
+            uint32_t rtt_ticks = latency_now() - start;
             
             // Verify response
             if (rx_byte == tx_byte) {
                 pongs_received++;
-                total_rtt_us += rtt_us;
-                if (rtt_us < min_rtt_us) min_rtt_us = rtt_us;
-                if (rtt_us > max_rtt_us) max_rtt_us = rtt_us;
+                latency_hist_record(&rtt_hist, rtt_ticks);
                 
-                printf("PING seq=%3d: reply in %lu us\n", tx_byte, rtt_us);
+                printf("PING seq=%3d: reply in %lu ns\n", tx_byte, latency_ticks_to_ns(rtt_ticks));
                 led_toggle();
             } else {
                 errors++;
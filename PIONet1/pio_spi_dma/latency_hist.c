@@ -0,0 +1,111 @@
+/**
+ * Cycle-accurate latency measurement with log-bucketed histograms
+ */
+
+#include "latency_hist.h"
+#include "hardware/clocks.h"
+#include <stdio.h>
+#include <string.h>
+
+// ============================================================================
+// Timestamps
+// ============================================================================
+
+void latency_timer_init(void) {
+#if LATENCY_USE_DWT
+    // Trace must be enabled for the DWT to count
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_cyccnt = 0;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+#endif
+}
+
+uint32_t latency_ticks_to_ns(uint32_t ticks) {
+#if LATENCY_USE_DWT
+    return (uint32_t)(((uint64_t)ticks * 1000000000u) / clock_get_hz(clk_sys));
+#else
+    return ticks * 1000u;
+#endif
+}
+
+// ============================================================================
+// Bucket Mapping
+// ============================================================================
+//
+// Values below 2^SUB_BITS map 1:1. Above that, the bucket is the position
+// of the top set bit (octave) plus the next SUB_BITS bits below it.
+
+static uint bucket_of(uint32_t v) {
+    if (v < (1u << LATENCY_HIST_SUB_BITS)) {
+        return v;
+    }
+    uint msb = 31 - __builtin_clz(v);
+    uint shift = msb - LATENCY_HIST_SUB_BITS;
+    uint sub = (v >> shift) & ((1u << LATENCY_HIST_SUB_BITS) - 1);
+    return ((shift + 1) << LATENCY_HIST_SUB_BITS) | sub;
+}
+
+// Largest value that maps into bucket b
+static uint32_t bucket_upper(uint b) {
+    if (b < (1u << LATENCY_HIST_SUB_BITS)) {
+        return b;
+    }
+    uint shift = (b >> LATENCY_HIST_SUB_BITS) - 1;
+    uint sub = b & ((1u << LATENCY_HIST_SUB_BITS) - 1);
+    uint64_t base = (uint64_t)((1u << LATENCY_HIST_SUB_BITS) | sub) << shift;
+    uint64_t upper = base + (1ull << shift) - 1;
+    return upper > UINT32_MAX ? UINT32_MAX : (uint32_t)upper;
+}
+
+// ============================================================================
+// Histogram
+// ============================================================================
+
+void latency_hist_reset(latency_hist_t *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT32_MAX;
+}
+
+void latency_hist_record(latency_hist_t *h, uint32_t ticks) {
+    h->buckets[bucket_of(ticks)]++;
+    h->count++;
+    h->total += ticks;
+    if (ticks < h->min) h->min = ticks;
+    if (ticks > h->max) h->max = ticks;
+}
+
+uint32_t latency_hist_percentile(const latency_hist_t *h, float pct) {
+    if (h->count == 0) return 0;
+    
+    // Rank of the sample we want (1-based, rounded up)
+    uint64_t rank = (uint64_t)((pct / 100.0f) * (float)h->count + 0.999f);
+    if (rank < 1) rank = 1;
+    if (rank > h->count) rank = h->count;
+    
+    uint64_t seen = 0;
+    for (uint b = 0; b < LATENCY_HIST_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            // Never report beyond the largest sample actually seen
+            uint32_t upper = bucket_upper(b);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+void latency_hist_print(const latency_hist_t *h, const char *name) {
+    if (h->count == 0) {
+        printf("%s: no samples\n", name);
+        return;
+    }
+    
+    uint32_t avg = (uint32_t)(h->total / h->count);
+    printf("%s: n=%lu min/avg/max = %lu/%lu/%lu ns\n", name, h->count,
+           latency_ticks_to_ns(h->min), latency_ticks_to_ns(avg),
+           latency_ticks_to_ns(h->max));
+    printf("%s: p50/p99/p99.9 = %lu/%lu/%lu ns\n", name,
+           latency_ticks_to_ns(latency_hist_percentile(h, 50.0f)),
+           latency_ticks_to_ns(latency_hist_percentile(h, 99.0f)),
+           latency_ticks_to_ns(latency_hist_percentile(h, 99.9f)));
+}
@@ -0,0 +1,108 @@
+/**
+ * Cycle-accurate latency measurement with log-bucketed histograms
+ * 
+ * Timestamps come from the Cortex-M33 DWT cycle counter (one tick per
+ * sys clock cycle), falling back to the 1 us system timer on other cores.
+ * Samples go into a log-linear histogram: 8 sub-buckets per power of two,
+ * so any percentile is reported within ~12% with fixed 1 KB of storage
+ * and O(1) recording.
+ *
+ * Usage:
+ *   latency_timer_init();
+ *   uint32_t t0 = latency_now();
+ *   ... operation ...
+ *   latency_hist_record(&h, latency_now() - t0);
+ *   latency_hist_print(&h, "RTT");
+ */
+
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include "pico.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__ARM_ARCH_8M_MAIN__)
+#include "hardware/structs/m33.h"
+#define LATENCY_USE_DWT 1
+#else
+#include "hardware/timer.h"
+#define LATENCY_USE_DWT 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 8 sub-buckets per octave, 32 octaves covers the full uint32_t range
+#define LATENCY_HIST_SUB_BITS   3
+#define LATENCY_HIST_BUCKETS    (32u << LATENCY_HIST_SUB_BITS)
+
+typedef struct {
+    uint32_t buckets[LATENCY_HIST_BUCKETS];
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+} latency_hist_t;
+
+// ============================================================================
+// Timestamps
+// ============================================================================
+
+/**
+ * Enable the cycle counter (call once at startup)
+ */
+void latency_timer_init(void);
+
+/**
+ * Current timestamp in ticks (sys clock cycles with DWT, else microseconds)
+ * 
+ * Differences are valid across wrap as long as the interval fits in 32 bits
+ * (~28 s at 150 MHz).
+ */
+static inline uint32_t latency_now(void) {
+#if LATENCY_USE_DWT
+    return m33_hw->dwt_cyccnt;
+#else
+    return timer_hw->timerawl;
+#endif
+}
+
+/**
+ * Convert a tick count to nanoseconds
+ */
+uint32_t latency_ticks_to_ns(uint32_t ticks);
+
+// ============================================================================
+// Histogram
+// ============================================================================
+
+/**
+ * Clear all samples
+ */
+void latency_hist_reset(latency_hist_t *h);
+
+/**
+ * Add one sample (in ticks)
+ */
+void latency_hist_record(latency_hist_t *h, uint32_t ticks);
+
+/**
+ * Get the value (in ticks) below which pct percent of samples fall
+ * 
+ * @param pct       Percentile, e.g. 50.0f, 99.0f, 99.9f
+ * @return          Upper edge of the bucket holding that sample (0 if empty)
+ */
+uint32_t latency_hist_percentile(const latency_hist_t *h, float pct);
+
+/**
+ * Print count, min/avg/max and p50/p99/p99.9 in nanoseconds
+ */
+void latency_hist_print(const latency_hist_t *h, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LATENCY_HIST_H
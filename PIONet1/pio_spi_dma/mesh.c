@@ -0,0 +1,468 @@
+/**
+ * 2D mesh node: four nearest-neighbour links with dimension-order routing
+ */
+
+#include "mesh.h"
+#include "mesh_collective.h"
+#include "mesh_xnet.h"
+#include "mesh_time.h"
+#include "pio_spi_pool.h"
+#include "pio_spi_train.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TXQ_MASK    (MESH_TXQ_DEPTH - 1)
+#define LOCALQ_MASK (MESH_LOCALQ_DEPTH - 1)
+
+typedef struct {
+    pio_spi_dma_tx_inst_t tx;
+    pio_spi_dma_rx_inst_t rx;
+    pio_spi_link_t link;
+    pio_spi_packet_t *txq[MESH_TXQ_DEPTH];
+    uint32_t txq_head;          // Next slot to fill
+    uint32_t txq_tail;          // Next packet to send
+    mesh_port_stats_t stats;
+} mesh_link_t;
+
+static mesh_link_t links[MESH_PORTS];
+static uint16_t node_addr = MESH_ADDR_NONE;
+static uint8_t node_seq;
+static absolute_time_t next_hello;
+
+// Packet pool, refcounted so one buffer can go out several ports. The tag
+// is the port whose credit a received buffer holds, or LOCAL.
+PIO_SPI_POOL_DEFINE(pool, MESH_POOL_SIZE, sizeof(pio_spi_packet_t), 4, MESH_POOL_PLACEMENT);
+
+// Packets for this node
+static pio_spi_packet_t *localq[MESH_LOCALQ_DEPTH];
+static uint32_t localq_head;
+static uint32_t localq_tail;
+
+static const char *port_names[MESH_PORTS] = { "N", "E", "S", "W" };
+
+// ============================================================================
+// Packet Pool
+// ============================================================================
+
+pio_spi_packet_t *PIO_SPI_DMA_HOT(mesh_alloc)(void) {
+    pio_spi_packet_t *pkt = pio_spi_pool_alloc(&pool);
+    if (pkt) {
+        pio_spi_pool_set_tag(&pool, pkt, MESH_PORT_LOCAL);
+    }
+    return pkt;
+}
+
+void PIO_SPI_DMA_HOT(mesh_ref)(pio_spi_packet_t *pkt) {
+    pio_spi_pool_ref(&pool, pkt);
+}
+
+void PIO_SPI_DMA_HOT(mesh_free)(pio_spi_packet_t *pkt) {
+    pio_spi_pool_free(&pool, pkt);
+}
+
+// A buffer received from a neighbour gives its credit back (IRQs disabled)
+static void PIO_SPI_DMA_HOT(pool_release)(void *buf, uint8_t origin, void *user_data) {
+    (void)buf;
+    (void)user_data;
+    if (origin != MESH_PORT_LOCAL) {
+        pio_spi_link_rx_release(&links[origin].link);
+    }
+}
+
+// ============================================================================
+// Routing
+// ============================================================================
+
+mesh_port_t PIO_SPI_DMA_HOT(mesh_route)(uint16_t dst) {
+    if (dst == node_addr || dst == MESH_ADDR_BROADCAST) {
+        return MESH_PORT_LOCAL;
+    }
+
+    // X first, then Y
+    int dx = (int)MESH_ADDR_X(dst) - (int)MESH_ADDR_X(node_addr);
+    int dy = (int)MESH_ADDR_Y(dst) - (int)MESH_ADDR_Y(node_addr);
+    if (dx > 0) return MESH_PORT_E;
+    if (dx < 0) return MESH_PORT_W;
+    return (dy > 0) ? MESH_PORT_N : MESH_PORT_S;
+}
+
+// The link is idle and holds a credit: next queued packet (IRQs disabled)
+static pio_spi_packet_t *PIO_SPI_DMA_HOT(link_tx_pull)(void *user_data) {
+    mesh_link_t *l = user_data;
+    if (l->txq_tail == l->txq_head) return NULL;
+
+    // Going on the wire now: clock sync stamps its departure here
+    pio_spi_packet_t *pkt = l->txq[l->txq_tail++ & TXQ_MASK];
+    if (pkt->hdr.type == MESH_TYPE_TIME) {
+        mesh_time_tx((mesh_port_t)(l - links), pkt);
+    }
+    return pkt;
+}
+
+static bool PIO_SPI_DMA_HOT(link_enqueue)(mesh_link_t *l, pio_spi_packet_t *pkt) {
+    uint32_t save = save_and_disable_interrupts();
+    bool ok = l->txq_head - l->txq_tail < MESH_TXQ_DEPTH;
+    if (ok) {
+        l->txq[l->txq_head++ & TXQ_MASK] = pkt;
+        pio_spi_link_kick(&l->link);
+    } else {
+        l->stats.dropped++;
+    }
+    restore_interrupts(save);
+
+    if (!ok) mesh_free(pkt);
+    return ok;
+}
+
+bool PIO_SPI_DMA_HOT(mesh_deliver)(pio_spi_packet_t *pkt) {
+    uint32_t save = save_and_disable_interrupts();
+    bool ok = localq_head - localq_tail < MESH_LOCALQ_DEPTH;
+    if (ok) {
+        localq[localq_head++ & LOCALQ_MASK] = pkt;
+    }
+    restore_interrupts(save);
+
+    if (!ok) mesh_free(pkt);
+    return ok;
+}
+
+// Hand a packet with a complete header to its next hop (consumes it)
+static bool PIO_SPI_DMA_HOT(mesh_dispatch)(pio_spi_packet_t *pkt, bool transit) {
+    // Nowhere to route from until this node knows where it is
+    if (node_addr == MESH_ADDR_NONE && pkt->hdr.dst != MESH_ADDR_BROADCAST) {
+        mesh_free(pkt);
+        return false;
+    }
+
+    mesh_port_t port = mesh_route(pkt->hdr.dst);
+    if (port == MESH_PORT_LOCAL) {
+        return mesh_deliver(pkt);
+    }
+
+    // Edge of the mesh (or unplugged cable): destination doesn't exist
+    mesh_link_t *l = &links[port];
+    if (!l->stats.up) {
+        l->stats.dropped++;
+        mesh_free(pkt);
+        return false;
+    }
+
+    if (transit) l->stats.forwarded++;
+    return link_enqueue(l, pkt);
+}
+
+void mesh_set_header(pio_spi_packet_t *pkt, uint16_t dst, uint8_t type, size_t len) {
+    pkt->hdr.dst = dst;
+    pkt->hdr.src = node_addr;
+    pkt->hdr.type = type;
+    pkt->hdr.seq = node_seq++;
+    pkt->hdr.len = (uint16_t)len;
+}
+
+// ============================================================================
+// Link Events (IRQ context)
+// ============================================================================
+
+static void set_node_addr(uint16_t addr) {
+    node_addr = addr;
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        links[p].link.ptx.src = addr;
+    }
+}
+
+// Locate this node from a neighbour's address and the port it arrived on
+static void hello_received(mesh_port_t port, uint16_t src) {
+    links[port].stats.neighbour = src;
+    if (node_addr != MESH_ADDR_NONE || src == MESH_ADDR_NONE) return;
+
+    int x = (int)MESH_ADDR_X(src);
+    int y = (int)MESH_ADDR_Y(src);
+    switch (port) {
+    case MESH_PORT_N: y--; break;
+    case MESH_PORT_E: x--; break;
+    case MESH_PORT_S: y++; break;
+    default:          x++; break;
+    }
+
+    if (x >= 0 && y >= 0 && x < 0xff && y < 0xff) {
+        set_node_addr(MESH_ADDR(x, y));
+    }
+}
+
+static pio_spi_packet_t *PIO_SPI_DMA_HOT(link_rx_packet)(pio_spi_packet_t *pkt, void *user_data) {
+    mesh_link_t *l = user_data;
+    l->stats.rx_packets++;
+    l->stats.up = true;
+
+    if (pkt->hdr.type == MESH_TYPE_HELLO) {
+        hello_received((mesh_port_t)(l - links), pkt->hdr.src);
+        return pkt;
+    }
+
+    // Keep this buffer for its next hop and receive into a fresh one.
+    // It holds the neighbour's credit until its last reference is freed.
+    pio_spi_packet_t *next = mesh_alloc();
+    if (!next) {
+        l->stats.dropped++;
+        return pkt;
+    }
+    pio_spi_pool_set_tag(&pool, pkt, (uint8_t)(l - links));
+
+    if (pkt->hdr.type == MESH_TYPE_SHIFT) {
+        mesh_xnet_receive((mesh_port_t)(l - links), pkt);
+    } else if (pkt->hdr.type == MESH_TYPE_TIME) {
+        mesh_time_receive((mesh_port_t)(l - links), pkt);
+    } else if (pkt->hdr.type > MESH_TYPE_HELLO) {
+        mesh_coll_receive(pkt);
+    } else {
+        mesh_dispatch(pkt, true);
+    }
+    return next;
+}
+
+// Header just landed on l's RX: stream the packet straight out if its
+// output port is idle and holds a credit, otherwise store-and-forward
+static pio_spi_dma_tx_inst_t *PIO_SPI_DMA_HOT(link_rx_route)(const pio_spi_packet_hdr_t *hdr,
+                                                             void *user_data) {
+    mesh_link_t *l = user_data;
+
+    if (hdr->type >= MESH_TYPE_RESERVED || node_addr == MESH_ADDR_NONE) return NULL;
+
+    mesh_port_t port = mesh_route(hdr->dst);
+    if (port == MESH_PORT_LOCAL) return NULL;
+
+    mesh_link_t *out = &links[port];
+    uint32_t save = save_and_disable_interrupts();
+    bool ok = out->stats.up && out->txq_head == out->txq_tail &&
+              pio_spi_packet_can_cut_through(&l->link.prx, &out->tx) &&
+              pio_spi_link_tx_reserve(&out->link);
+    restore_interrupts(save);
+
+    if (!ok) return NULL;
+
+    l->stats.rx_packets++;
+    l->stats.up = true;
+    out->stats.forwarded++;
+    out->stats.tx_packets++;
+    out->stats.cut_through++;
+    return &out->tx;
+}
+
+static void PIO_SPI_DMA_HOT(link_cut_done)(pio_spi_dma_tx_inst_t *tx, void *user_data) {
+    mesh_link_t *l = user_data;
+    mesh_link_t *out = (mesh_link_t *)((uint8_t *)tx - offsetof(mesh_link_t, tx));
+
+    // No buffer was used here, so the upstream credit comes straight back
+    pio_spi_link_rx_passed(&l->link);
+    pio_spi_link_tx_unreserve(&out->link);
+}
+
+// Reliable links hold out-of-order packets in pool buffers
+static pio_spi_packet_t *PIO_SPI_DMA_HOT(link_rx_alloc)(void *user_data) {
+    (void)user_data;
+    return mesh_alloc();
+}
+
+static void PIO_SPI_DMA_HOT(link_tx_sent)(pio_spi_packet_t *pkt, void *user_data) {
+    mesh_link_t *l = user_data;
+    l->stats.tx_packets++;
+    mesh_free(pkt);
+}
+
+// ============================================================================
+// Node API
+// ============================================================================
+
+static bool link_init(mesh_port_t port, const mesh_config_t *cfg) {
+    mesh_link_t *l = &links[port];
+    const mesh_port_pins_t *pins = &cfg->pins[port];
+
+    // TX on pio0 SM = port; RX N/E on pio1, S/W on pio2
+    PIO rx_pio = (port < MESH_PORT_S) ? pio1 : pio2;
+    uint rx_sm = port & 1;
+
+    if (cfg->framed) {
+        l->tx = pio_spi_dma_tx_init_framed(pio0, port, pins->tx_clk, pins->tx_data,
+                                           cfg->freq_hz, PIO_SPI_DMA_WIDTH_32, 1);
+        l->rx = pio_spi_dma_rx_init_framed(rx_pio, rx_sm, pins->rx_cs, PIO_SPI_DMA_WIDTH_32, 1);
+    } else {
+        l->tx = pio_spi_dma_tx_init(pio0, port, pins->tx_clk, pins->tx_data, cfg->freq_hz);
+        l->rx = pio_spi_dma_rx_init(rx_pio, rx_sm, pins->rx_cs);
+    }
+    if ((int)l->tx.dma_chan < 0 || (int)l->rx.dma_chan < 0) {
+        return false;
+    }
+
+    // Arrival stamps for clock sync, before the packet layer copies the
+    // channel config (without a free channel they come from the IRQ)
+    pio_spi_dma_rx_set_timestamps(&l->rx, true);
+
+    if (!pio_spi_link_init(&l->link, &l->tx, &l->rx, mesh_alloc(), node_addr,
+                           MESH_LINK_WINDOW)) {
+        return false;
+    }
+    pio_spi_link_set_callbacks(&l->link, link_tx_pull, link_tx_sent, link_rx_packet, l);
+    if (cfg->reliable) {
+        pio_spi_link_set_reliable(&l->link, link_rx_alloc);
+    } else if (cfg->cut_through) {
+        pio_spi_packet_rx_set_cut_through(&l->link.prx, link_rx_route, link_cut_done, l);
+    }
+
+    l->stats.neighbour = MESH_ADDR_NONE;
+    return true;
+}
+
+// Train every port at once: each neighbour is doing the same on its side,
+// and ports with no one attached time out together
+static void train_links(void) {
+    static pio_spi_train_t train[MESH_PORTS];
+    pio_spi_packet_t *buf[MESH_PORTS];
+
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        buf[p] = mesh_alloc();
+        pio_spi_train_start(&train[p], &links[p].link.ptx, &links[p].link.prx, buf[p]);
+    }
+
+    bool done;
+    do {
+        done = true;
+        for (uint p = 0; p < MESH_PORTS; p++) {
+            done &= pio_spi_train_poll(&train[p]);
+        }
+    } while (!done);
+
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        const pio_spi_train_result_t *r = pio_spi_train_result(&train[p]);
+        links[p].stats.margin_pct = r->margin_pct;
+
+        // Ports now differ in rate: cut-through only into ones at least as fast
+        pio_spi_packet_rx_set_rate(&links[p].link.prx, r->rx_freq_hz);
+        mesh_free(buf[p]);
+    }
+}
+
+bool mesh_init(const mesh_config_t *cfg) {
+    memset(links, 0, sizeof(links));
+
+    PIO_SPI_POOL_INIT(pool);
+    pio_spi_pool_set_release_callback(&pool, pool_release, NULL);
+    localq_head = localq_tail = 0;
+
+    node_addr = cfg->root ? MESH_ADDR(0, 0) : MESH_ADDR_NONE;
+    mesh_coll_init();
+    mesh_xnet_init();
+    mesh_time_init();
+
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        if (!link_init((mesh_port_t)p, cfg)) {
+            return false;
+        }
+    }
+
+    if (cfg->train) {
+        train_links();
+    }
+
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        pio_spi_link_start(&links[p].link);
+    }
+
+    next_hello = get_absolute_time();
+    return true;
+}
+
+void mesh_poll(void) {
+    mesh_time_poll();
+
+    if (absolute_time_diff_us(next_hello, get_absolute_time()) < 0) return;
+    next_hello = make_timeout_time_ms(MESH_HELLO_MS);
+
+    // Beacon on every port: keeps links marked up and locates neighbours.
+    // Credit state goes with it in case an update was lost.
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        pio_spi_link_poll(&links[p].link);
+
+        // Pool empty: skip this beacon, but keep refreshing the other ports
+        pio_spi_packet_t *pkt = mesh_alloc();
+        if (!pkt) continue;
+        mesh_set_header(pkt, MESH_ADDR_BROADCAST, MESH_TYPE_HELLO, 0);
+        link_enqueue(&links[p], pkt);
+    }
+}
+
+uint16_t mesh_addr(void) {
+    return node_addr;
+}
+
+bool mesh_port_up(mesh_port_t port) {
+    return links[port].stats.up;
+}
+
+uint mesh_port_queue_free(mesh_port_t port) {
+    const mesh_link_t *l = &links[port];
+    return MESH_TXQ_DEPTH - (l->txq_head - l->txq_tail);
+}
+
+bool PIO_SPI_DMA_HOT(mesh_port_send)(mesh_port_t port, pio_spi_packet_t *pkt) {
+    return link_enqueue(&links[port], pkt);
+}
+
+bool mesh_send(pio_spi_packet_t *pkt, uint16_t dst, uint8_t type, size_t len) {
+    if (len > PIO_SPI_PACKET_MAX_PAYLOAD) {
+        mesh_free(pkt);
+        return false;
+    }
+
+    mesh_set_header(pkt, dst, type, len);
+    return mesh_dispatch(pkt, false);
+}
+
+pio_spi_packet_t *mesh_recv(void) {
+    pio_spi_packet_t *pkt = NULL;
+    uint32_t save = save_and_disable_interrupts();
+    if (localq_tail != localq_head) {
+        pkt = localq[localq_tail++ & LOCALQ_MASK];
+    }
+    restore_interrupts(save);
+    return pkt;
+}
+
+const mesh_port_stats_t *mesh_port_stats(mesh_port_t port) {
+    mesh_link_t *l = &links[port];
+    l->stats.crc_errors = l->link.prx.crc_errors;
+    l->stats.length_errors = l->link.prx.length_errors;
+    l->stats.credits = pio_spi_link_tx_credits(&l->link);
+    l->stats.retransmits = l->link.retransmits + l->link.timeouts;
+    l->stats.freq_hz = pio_spi_dma_tx_get_freq(&l->tx);
+    pio_spi_dma_tx_get_stats(&l->tx, &l->stats.tx_wire);
+    pio_spi_dma_rx_get_stats(&l->rx, &l->stats.rx_wire);
+    return &l->stats;
+}
+
+void mesh_print_status(void) {
+    if (node_addr == MESH_ADDR_NONE) {
+        printf("Node: (?,?)  pool free %u/%u (low %u)\n", pio_spi_pool_available(&pool),
+               MESH_POOL_SIZE, pool.low_water);
+    } else {
+        printf("Node: (%u,%u)  pool free %u/%u (low %u)\n",
+               MESH_ADDR_X(node_addr), MESH_ADDR_Y(node_addr), pio_spi_pool_available(&pool),
+               MESH_POOL_SIZE, pool.low_water);
+    }
+
+    printf("Port  Link  MHz     Margin  Neighbour   TX      RX      Fwd     Cut     Drop    CRC err  Len err  Abort   Ovf     Credits  Retx\n");
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        const mesh_port_stats_t *s = mesh_port_stats((mesh_port_t)p);
+        char nb[12] = "-";
+        if (s->neighbour != MESH_ADDR_NONE) {
+            snprintf(nb, sizeof(nb), "(%u,%u)", MESH_ADDR_X(s->neighbour), MESH_ADDR_Y(s->neighbour));
+        }
+        printf("%-4s  %-4s  %-6.2f  %-5.0f%%  %-10s  %-6lu  %-6lu  %-6lu  %-6lu  %-6lu  %-7lu  %-7lu  %-6lu  %-6lu  %-7u  %lu\n",
+               port_names[p], s->up ? "up" : "down", s->freq_hz / 1e6f, s->margin_pct, nb,
+               s->tx_packets, s->rx_packets, s->forwarded, s->cut_through, s->dropped,
+               s->crc_errors, s->length_errors, s->rx_wire.aborted,
+               s->rx_wire.fifo_overflows + s->tx_wire.fifo_overflows, s->credits, s->retransmits);
+    }
+}
@@ -0,0 +1,257 @@
+/**
+ * 2D mesh node: four nearest-neighbour links with dimension-order routing
+ *
+ * Each node has a bidirectional pio_spi_dma link to its N/E/S/W
+ * neighbours (X-net style nearest-neighbour grid). Packets carry an (x,y)
+ * destination and are routed X first, then Y, which is deadlock-free on
+ * a mesh. Transit packets never touch the CPU byte by byte. With
+ * cut_through set, a packet whose output port is idle streams from the
+ * RX FIFO into the outgoing TX FIFO as soon as its header is parsed, so
+ * each hop adds a few words of latency rather than a whole packet.
+ * Otherwise RX DMA lands it in a pool buffer, the IRQ swaps in a fresh
+ * buffer and queues the full one on the output port.
+ *
+ * Every link runs credit flow control (pio_spi_link.h): a neighbour only
+ * sends when this node has a buffer set aside for it, so a busy router
+ * slows its neighbours down rather than losing packets. With reliable set,
+ * links also acknowledge every packet and resend corrupted ones
+ * themselves; the reorder window can hold up to PIO_SPI_LINK_MAX_WINDOW
+ * extra pool buffers per port while a resend is outstanding.
+ *
+ * PIO / SM layout (4 links = 8 state machines):
+ *   pio0  SM0-3     TX  N, E, S, W
+ *   pio1  SM0-1     RX  N, E
+ *   pio2  SM0-1     RX  S, W
+ *
+ * Addressing: MESH_ADDR(x, y), 8 bits per coordinate. Coordinates are not
+ * configured per board: the root node (strap pin) is (0,0) and every other
+ * node derives its own from the first HELLO it hears from a neighbour that
+ * already knows where it is. Direction convention: E = x+1, N = y+1.
+ */
+
+#ifndef MESH_H
+#define MESH_H
+
+#include "pio_spi_dma.h"
+#include "pio_spi_packet.h"
+#include "pio_spi_link.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+/** Packet buffers shared by RX, forwarding and the application */
+#ifndef MESH_POOL_SIZE
+#define MESH_POOL_SIZE 32
+#endif
+
+/** Where the pool lives (see pio_spi_pool.h) */
+#ifndef MESH_POOL_PLACEMENT
+#define MESH_POOL_PLACEMENT PIO_SPI_POOL_SRAM
+#endif
+
+/** Packets waiting per output port (power of 2) */
+#ifndef MESH_TXQ_DEPTH
+#define MESH_TXQ_DEPTH 16
+#endif
+
+/**
+ * Receive buffers each port may hold for its neighbour (link credits)
+ *
+ * A held buffer only returns its credit once forwarded or consumed, so a
+ * congested output pushes back hop by hop to the sources instead of
+ * dropping. Keep MESH_POOL_SIZE >= MESH_PORTS * (window + 1) plus what
+ * the application holds, and MESH_TXQ_DEPTH >= 3 * window so transit
+ * traffic always fits the output queue.
+ */
+#ifndef MESH_LINK_WINDOW
+#define MESH_LINK_WINDOW PIO_SPI_LINK_WINDOW
+#endif
+
+/** Packets waiting for the application (power of 2) */
+#ifndef MESH_LOCALQ_DEPTH
+#define MESH_LOCALQ_DEPTH 16
+#endif
+
+/** Interval between HELLO packets on each port */
+#ifndef MESH_HELLO_MS
+#define MESH_HELLO_MS 500
+#endif
+
+// ============================================================================
+// Addressing
+// ============================================================================
+
+#define MESH_ADDR(x, y)     ((uint16_t)(((uint)(y) << 8) | (uint)(x)))
+#define MESH_ADDR_X(a)      ((uint)(a) & 0xffu)
+#define MESH_ADDR_Y(a)      ((uint)(a) >> 8)
+#define MESH_ADDR_NONE      0xfffe                      // Coordinate not known yet
+#define MESH_ADDR_BROADCAST PIO_SPI_PACKET_BROADCAST
+
+/** Packet types from here up are reserved for the mesh itself */
+#define MESH_TYPE_RESERVED  0xf0
+#define MESH_TYPE_HELLO     0xf0                        // Link-local neighbour beacon
+#define MESH_TYPE_BCAST     0xf1                        // Broadcast segment (see mesh_collective.h)
+#define MESH_TYPE_REDUCE    0xf2                        // Partial reduction, child -> parent
+#define MESH_TYPE_RESULT    0xf3                        // Reduction result, root -> all
+#define MESH_TYPE_SHIFT     0xf4                        // Link-local exchange data (see mesh_xnet.h)
+#define MESH_TYPE_TIME      0xf5                        // Link-local clock sync (see mesh_time.h)
+
+typedef enum {
+    MESH_PORT_N,
+    MESH_PORT_E,
+    MESH_PORT_S,
+    MESH_PORT_W,
+    MESH_PORTS,
+    MESH_PORT_LOCAL = MESH_PORTS                        // Route result: this node
+} mesh_port_t;
+
+typedef struct {
+    uint tx_clk;                // TX CLK (CS is tx_clk + 1)
+    uint tx_data;               // TX DATA
+    uint rx_cs;                 // RX CS (CLK and DATA follow)
+} mesh_port_pins_t;
+
+typedef struct {
+    mesh_port_pins_t pins[MESH_PORTS];
+    float freq_hz;              // Link bit rate (safe rate when training)
+    bool framed;                // One CS per packet, 32-bit DMA (else per-byte CS)
+    bool cut_through;           // Stream transit packets RX FIFO -> TX FIFO
+                                // (trained: only into ports at least as fast)
+    bool reliable;              // Per-hop ACK and resend (overrides cut_through)
+    bool train;                 // Find each port's fastest clean rate at init
+    bool root;                  // This node is (0,0)
+} mesh_config_t;
+
+typedef struct {
+    uint16_t neighbour;         // Address heard in HELLO (MESH_ADDR_NONE until known)
+    bool up;                    // Heard anything from the far end
+    uint32_t tx_packets;
+    uint32_t rx_packets;
+    uint32_t forwarded;         // Transit packets sent on this port
+    uint32_t cut_through;       // ... of which streamed without landing in RAM
+    uint32_t dropped;           // Packets lost to a full queue or empty pool
+    uint32_t crc_errors;
+    uint32_t length_errors;
+    uint credits;               // Packets the neighbour will take right now
+    uint32_t retransmits;       // Reliable links: packets sent again
+    float freq_hz;              // TX bit rate
+    float margin_pct;           // Trained ports: headroom to the fastest clean rate
+    pio_spi_dma_stats_t tx_wire;    // Driver counters of this port's TX
+    pio_spi_dma_stats_t rx_wire;    // ... and RX (aborts, FIFO overflows)
+} mesh_port_stats_t;
+
+// ============================================================================
+// Node API
+// ============================================================================
+
+/**
+ * Bring up all four links and start receiving
+ *
+ * @param cfg   Pins and link settings
+ * @return      false if PIO or DMA resources ran out
+ */
+bool mesh_init(const mesh_config_t *cfg);
+
+/**
+ * Housekeeping: HELLO beacons and clock sync (call regularly from the main loop)
+ */
+void mesh_poll(void);
+
+/**
+ * This node's address (MESH_ADDR_NONE until located)
+ */
+uint16_t mesh_addr(void);
+
+/**
+ * Output port for a destination by dimension-order routing
+ *
+ * @return      MESH_PORT_N..W, or MESH_PORT_LOCAL for this node
+ */
+mesh_port_t mesh_route(uint16_t dst);
+
+/**
+ * Take a packet buffer from the pool
+ *
+ * @return      Buffer, or NULL if the pool is empty
+ */
+pio_spi_packet_t *mesh_alloc(void);
+
+/**
+ * Drop one reference to a packet buffer (back to the pool at zero)
+ */
+void mesh_free(pio_spi_packet_t *pkt);
+
+/**
+ * Take an extra reference, e.g. before sending one buffer on several ports
+ */
+void mesh_ref(pio_spi_packet_t *pkt);
+
+/**
+ * Send a packet to any node
+ *
+ * @param pkt   Buffer from mesh_alloc() with payload filled in (ownership passes)
+ * @param dst   Destination address
+ * @param type  Packet type (< MESH_TYPE_RESERVED)
+ * @param len   Payload length
+ * @return      false if the packet was dropped (it is freed either way)
+ */
+bool mesh_send(pio_spi_packet_t *pkt, uint16_t dst, uint8_t type, size_t len);
+
+/**
+ * Next packet addressed to this node
+ *
+ * @return      Packet (release with mesh_free()), or NULL if none waiting
+ */
+pio_spi_packet_t *mesh_recv(void);
+
+// ============================================================================
+// Port-Level API (for layers such as mesh_collective)
+// ============================================================================
+
+/**
+ * Fill in a header from this node (src, next sequence number)
+ */
+void mesh_set_header(pio_spi_packet_t *pkt, uint16_t dst, uint8_t type, size_t len);
+
+/**
+ * Queue a packet on one port with its header as-is (consumes one reference)
+ *
+ * @return      false if the port queue was full (reference dropped)
+ */
+bool mesh_port_send(mesh_port_t port, pio_spi_packet_t *pkt);
+
+/**
+ * Queue a packet for mesh_recv() (consumes one reference)
+ */
+bool mesh_deliver(pio_spi_packet_t *pkt);
+
+/**
+ * Whether anything has been heard from the far end of a port
+ */
+bool mesh_port_up(mesh_port_t port);
+
+/**
+ * Free slots in a port's output queue
+ */
+uint mesh_port_queue_free(mesh_port_t port);
+
+/**
+ * Per-port counters
+ */
+const mesh_port_stats_t *mesh_port_stats(mesh_port_t port);
+
+/**
+ * Print address, neighbours and counters
+ */
+void mesh_print_status(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_H
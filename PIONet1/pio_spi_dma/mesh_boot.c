@@ -0,0 +1,172 @@
+/**
+ * Network boot: broadcast one program image to every node and run it from SRAM
+ */
+
+#include "mesh_boot.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/structs/scb.h"
+#include "hardware/structs/systick.h"
+#include "pico/multicore.h"
+#include <string.h>
+
+// ============================================================================
+// Setup
+// ============================================================================
+
+bool mesh_boot_init(mesh_boot_t *b, void *stage, size_t stage_size) {
+    memset(b, 0, sizeof(*b));
+
+    int chan = dma_claim_unused_channel(false);
+    if (chan < 0) return false;
+
+    b->stage = stage;
+    b->stage_size = stage_size;
+    b->dma_chan = (uint)chan;
+    b->state = MESH_BOOT_IDLE;
+    return true;
+}
+
+void mesh_boot_reset(mesh_boot_t *b) {
+    memset(&b->hdr, 0, sizeof(b->hdr));
+    b->received = 0;
+    b->state = MESH_BOOT_IDLE;
+}
+
+bool mesh_boot_header_ok(const mesh_boot_t *b, const mesh_boot_hdr_t *hdr) {
+    uint32_t load = hdr->load_addr;
+
+    // Main SRAM only: the stack and the copy loop's locals are in scratch.
+    // Loading at or below the staging area keeps the forward copy safe.
+    return hdr->magic == MESH_BOOT_MAGIC &&
+           hdr->size >= 8 && hdr->size <= b->stage_size &&
+           (load & 3u) == 0 &&
+           load >= SRAM_BASE && load + hdr->size <= SRAM_STRIPED_END &&
+           load <= (uintptr_t)b->stage;
+}
+
+// ============================================================================
+// Receive
+// ============================================================================
+
+// CRC of the staged image; the sniffer is only ever held for one packet
+static void verify(mesh_boot_t *b) {
+    uint32_t crc;
+    while (!pio_spi_packet_crc32_dma(b->dma_chan, b->stage, b->hdr.size, &crc)) {
+        tight_loop_contents();
+    }
+    b->state = (crc == b->hdr.crc) ? MESH_BOOT_READY : MESH_BOOT_BAD;
+}
+
+bool mesh_boot_receive(mesh_boot_t *b, const pio_spi_packet_t *pkt) {
+    if (pkt->hdr.type != MESH_TYPE_BCAST) return false;
+
+    const mesh_bcast_hdr_t *bh = mesh_bcast_header(pkt);
+    const uint8_t *data = mesh_bcast_data(pkt);
+    size_t len = mesh_bcast_len(pkt);
+
+    if (bh->tag == MESH_BOOT_TAG_HDR) {
+        // A new header always starts over, including a resend after a bad copy
+        mesh_boot_reset(b);
+        if (len == sizeof(b->hdr)) {
+            memcpy(&b->hdr, data, len);
+        }
+        b->image_id = (uint16_t)(bh->id + 1);
+        b->state = mesh_boot_header_ok(b, &b->hdr) ? MESH_BOOT_RECEIVING : MESH_BOOT_BAD;
+        return true;
+    }
+
+    if (bh->tag != MESH_BOOT_TAG_IMAGE) return false;
+    if (b->state != MESH_BOOT_RECEIVING) return true;
+
+    // Segments arrive in order down the tree; a gap means one was lost
+    if (bh->id != b->image_id || bh->total != b->hdr.size || bh->offset != b->received ||
+        len > b->hdr.size - b->received) {
+        b->state = MESH_BOOT_BAD;
+        return true;
+    }
+
+    memcpy(b->stage + b->received, data, len);
+    b->received += len;
+
+    if (bh->flags & MESH_BCAST_LAST) {
+        if (b->received == b->hdr.size) {
+            verify(b);
+        } else {
+            b->state = MESH_BOOT_BAD;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Send
+// ============================================================================
+
+bool mesh_boot_send(mesh_boot_t *b, const mesh_boot_hdr_t *hdr, const void *image,
+                    uint32_t timeout_ms) {
+    if (!mesh_boot_header_ok(b, hdr)) return false;
+
+    uint32_t crc;
+    while (!pio_spi_packet_crc32_dma(b->dma_chan, image, hdr->size, &crc)) {
+        tight_loop_contents();
+    }
+    if (crc != hdr->crc) return false;
+
+    return mesh_bcast(hdr, sizeof(*hdr), MESH_BOOT_TAG_HDR, timeout_ms) &&
+           mesh_bcast(image, hdr->size, MESH_BOOT_TAG_IMAGE, timeout_ms);
+}
+
+// ============================================================================
+// Execute
+// ============================================================================
+
+void mesh_boot_exec(mesh_boot_t *b, const mesh_boot_hdr_t *hdr, const void *image) {
+    // Everything past the copy lives in registers and the scratch stack:
+    // main SRAM, this state included, is about to be overwritten
+    const uint chan = b->dma_chan;
+    const uint32_t load = hdr->load_addr;
+    const uint32_t words = (hdr->size + 3u) / 4u;
+
+    multicore_reset_core1();
+
+    (void)save_and_disable_interrupts();
+    systick_hw->csr = 0;
+    for (uint i = 0; i < NUM_IRQS; i++) {
+        irq_set_enabled(i, false);
+        irq_clear(i);
+    }
+
+    // Links: no state machine or channel may touch memory from here on
+    for (uint i = 0; i < NUM_PIOS; i++) {
+        pio_set_sm_mask_enabled(pio_get_instance(i), (1u << NUM_PIO_STATE_MACHINES) - 1, false);
+    }
+    dma_hw->abort = (1u << NUM_DMA_CHANNELS) - 1;
+    while (dma_hw->abort) tight_loop_contents();
+    dma_sniffer_disable();
+
+    // Move the image into place. Runs from flash; the DMA needs no RAM code.
+    dma_channel_config c = dma_channel_get_default_config(chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, true);
+    dma_channel_configure(chan, &c, (void *)(uintptr_t)load, image, words, true);
+    while (dma_channel_is_busy(chan)) tight_loop_contents();
+
+    // Enter through the image's vector table, as from reset
+    const uint32_t *vt = (const uint32_t *)(uintptr_t)load;
+    scb_hw->vtor = load;
+#ifdef __ARM_ARCH_8M_MAIN__
+    __asm volatile ("msr msplim, %0" :: "r"(0));
+#endif
+    __asm volatile (
+        "dsb\n"
+        "isb\n"
+        "msr msp, %0\n"
+        "cpsie i\n"
+        "bx %1\n"
+        :: "r"(vt[0]), "r"(vt[1]) : "memory");
+    __builtin_unreachable();
+}
@@ -0,0 +1,135 @@
+/**
+ * Network boot: broadcast one program image to every node and run it from SRAM
+ *
+ * Every board keeps a small resident loader in flash (net_boot). The root
+ * broadcasts a kernel image down the mesh_bcast() tree; each node stages
+ * it in SRAM, checks it with the sniffer CRC and, once the whole machine
+ * has a good copy, moves it to its load address and jumps to it. One
+ * flash write then boots the machine, and kernels run from zero wait
+ * state SRAM rather than through the XIP cache.
+ *
+ *   Root                                Every other node
+ *   allreduce SUM(1)      <- ready ->   allreduce SUM(1)      node count
+ *   bcast MESH_BOOT_TAG_HDR   ----->    arm for the image
+ *   bcast MESH_BOOT_TAG_IMAGE ----->    stage segments, CRC on the last
+ *   allreduce SUM(ok)     <- good ->    allreduce SUM(ok)     == count?
+ *   mesh_boot_exec()                    mesh_boot_exec()
+ *
+ * If any node's copy fails, the root broadcasts the image again.
+ *
+ * Images are RAM-only binaries (pico_set_binary_type(<target> no_flash))
+ * with their vector table at the load address. Prefix the .bin with a
+ * mesh_boot_hdr_t and write it to the root's flash with picotool:
+ *
+ *   python3 -c "import struct,sys,zlib;d=open('k.bin','rb').read();
+ *     sys.stdout.buffer.write(struct.pack('<4I',0x544f4f42,0x20000000,
+ *     len(d),zlib.crc32(d))+d)" > k.boot
+ *   picotool load -t bin -o 0x10100000 k.boot
+ */
+
+#ifndef MESH_BOOT_H
+#define MESH_BOOT_H
+
+#include "mesh_collective.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Broadcast tags of the boot messages (keep application tags below) */
+#define MESH_BOOT_TAG_HDR   0xfe
+#define MESH_BOOT_TAG_IMAGE 0xff
+
+#define MESH_BOOT_MAGIC     0x544f4f42      // "BOOT"
+
+/** Leads an image in flash and is broadcast ahead of it */
+typedef struct {
+    uint32_t magic;             // MESH_BOOT_MAGIC
+    uint32_t load_addr;         // Where the image runs (its vector table)
+    uint32_t size;              // Image bytes
+    uint32_t crc;               // CRC-32 of the image (pio_spi_packet_crc32)
+} mesh_boot_hdr_t;
+
+typedef enum {
+    MESH_BOOT_IDLE,             // No header seen
+    MESH_BOOT_RECEIVING,        // Header accepted, staging segments
+    MESH_BOOT_READY,            // Whole image staged and its CRC matches
+    MESH_BOOT_BAD               // Rejected header, missed segment or CRC mismatch
+} mesh_boot_state_t;
+
+typedef struct {
+    uint8_t *stage;             // Staging area (word aligned)
+    size_t stage_size;
+    uint dma_chan;              // For the CRC and the final copy
+    mesh_boot_hdr_t hdr;        // Image being received
+    uint16_t image_id;          // Broadcast id expected for the image
+    uint32_t received;          // Image bytes staged, in order
+    mesh_boot_state_t state;
+} mesh_boot_t;
+
+/**
+ * Set up a loader
+ *
+ * @param b          Loader state
+ * @param stage      Staging area, above every address an image loads to
+ *                   (or equal to one), so the final forward copy is safe
+ * @param stage_size Largest image accepted
+ * @return           false if no DMA channel is free
+ */
+bool mesh_boot_init(mesh_boot_t *b, void *stage, size_t stage_size);
+
+/**
+ * Offer a packet from mesh_recv() to the loader
+ *
+ * @return      true if it was a boot segment (still the caller's to free)
+ *
+ * Checks the CRC with the sniffer when the last segment lands, so the
+ * loader moves to MESH_BOOT_READY or MESH_BOOT_BAD on its own.
+ */
+bool mesh_boot_receive(mesh_boot_t *b, const pio_spi_packet_t *pkt);
+
+/** Where the loader is with the current image */
+static inline mesh_boot_state_t mesh_boot_state(const mesh_boot_t *b) {
+    return b->state;
+}
+
+/** Forget the current image and wait for the next header */
+void mesh_boot_reset(mesh_boot_t *b);
+
+/**
+ * Broadcast an image from the root
+ *
+ * @param hdr        Header (checked against the image)
+ * @param image      Image bytes, e.g. straight from XIP flash
+ * @param timeout_ms Per-message broadcast timeout
+ * @return           false if not the root, the header is bad or a
+ *                   broadcast timed out
+ *
+ * Recomputes the CRC over the image first, so a corrupt flash slot is
+ * caught here rather than on every node.
+ */
+bool mesh_boot_send(mesh_boot_t *b, const mesh_boot_hdr_t *hdr, const void *image,
+                    uint32_t timeout_ms);
+
+/**
+ * Stop this node's links and run an image (does not return)
+ *
+ * @param hdr   Header of the image
+ * @param image Verified image bytes (staging area, or flash on the root)
+ *
+ * Interrupts, DMA, PIO and core1 are stopped first so nothing still
+ * writes the SRAM the image lands in; the image is then moved by DMA,
+ * which needs no code in SRAM. The image starts as from reset: its
+ * runtime init resets the peripherals it uses.
+ */
+void __attribute__((noreturn)) mesh_boot_exec(mesh_boot_t *b, const mesh_boot_hdr_t *hdr,
+                                              const void *image);
+
+/** Whether an image with this header fits the SRAM and staging area */
+bool mesh_boot_header_ok(const mesh_boot_t *b, const mesh_boot_hdr_t *hdr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_BOOT_H
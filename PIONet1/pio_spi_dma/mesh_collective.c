@@ -0,0 +1,280 @@
+/**
+ * Broadcast and reduction collectives over the mesh (MasPar ACU style)
+ */
+
+#include "mesh_collective.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
+#include <string.h>
+
+typedef struct {
+    uint16_t id;                // Round number
+    uint8_t op;                 // mesh_reduce_op_t
+    uint8_t count;              // Words in values
+    uint32_t values[MESH_REDUCE_WORDS];
+} reduce_msg_t;
+
+// A child can run one round ahead of its parent, so keep two in flight
+typedef struct {
+    bool active;
+    bool local;                 // This node's contribution is in
+    bool have;                  // acc holds at least one contribution
+    uint8_t waiting;            // Children still to report
+    uint16_t id;
+    uint8_t op;
+    uint8_t count;
+    uint32_t acc[MESH_REDUCE_WORDS];
+} reduce_slot_t;
+
+static reduce_slot_t slots[2];
+static uint16_t reduce_id;              // Next round this node contributes to
+static uint16_t bcast_id;               // Next broadcast from the root
+
+static volatile bool result_ready;
+static uint16_t result_id;
+static uint8_t result_count;
+static uint32_t result_values[MESH_REDUCE_WORDS];
+
+// ============================================================================
+// Spanning Tree
+// ============================================================================
+
+// Children: north always, east along row 0. Only ports with a live link.
+static uint PIO_SPI_DMA_HOT(tree_children)(mesh_port_t kids[2]) {
+    uint n = 0;
+    if (mesh_port_up(MESH_PORT_N)) {
+        kids[n++] = MESH_PORT_N;
+    }
+    if (MESH_ADDR_Y(mesh_addr()) == 0 && mesh_port_up(MESH_PORT_E)) {
+        kids[n++] = MESH_PORT_E;
+    }
+    return n;
+}
+
+mesh_port_t PIO_SPI_DMA_HOT(mesh_tree_parent)(void) {
+    uint16_t addr = mesh_addr();
+    if (MESH_ADDR_Y(addr) > 0) return MESH_PORT_S;
+    if (MESH_ADDR_X(addr) > 0) return MESH_PORT_W;
+    return MESH_PORT_LOCAL;                         // Root
+}
+
+// Send one buffer down to every child (references taken per port)
+static void PIO_SPI_DMA_HOT(tree_forward)(pio_spi_packet_t *pkt) {
+    mesh_port_t kids[2];
+    uint n = tree_children(kids);
+    for (uint i = 0; i < n; i++) {
+        mesh_ref(pkt);
+        mesh_port_send(kids[i], pkt);
+    }
+}
+
+// ============================================================================
+// Broadcast
+// ============================================================================
+
+bool mesh_bcast(const void *data, size_t len, uint8_t tag, uint32_t timeout_ms) {
+    if (mesh_tree_parent() != MESH_PORT_LOCAL || mesh_addr() == MESH_ADDR_NONE) {
+        return false;
+    }
+
+    absolute_time_t deadline = make_timeout_time_ms(timeout_ms);
+    const uint8_t *src = data;
+    uint16_t id = bcast_id++;
+    size_t offset = 0;
+
+    do {
+        size_t seg = len - offset;
+        if (seg > MESH_BCAST_SEG) seg = MESH_BCAST_SEG;
+
+        // Wait for a buffer and room on both child ports: the tree drains
+        // at link rate, so this paces the root to what the links carry
+        pio_spi_packet_t *pkt = NULL;
+        while (!pkt || mesh_port_queue_free(MESH_PORT_N) == 0 ||
+               mesh_port_queue_free(MESH_PORT_E) == 0) {
+            if (!pkt) pkt = mesh_alloc();
+            if (time_reached(deadline)) {
+                if (pkt) mesh_free(pkt);
+                return false;
+            }
+            tight_loop_contents();
+        }
+
+        mesh_bcast_hdr_t hdr = {
+            .id = id,
+            .tag = tag,
+            .flags = (offset + seg == len) ? MESH_BCAST_LAST : 0,
+            .offset = (uint32_t)offset,
+            .total = (uint32_t)len,
+        };
+        memcpy(pkt->payload, &hdr, sizeof(hdr));
+        memcpy(pkt->payload + sizeof(hdr), src + offset, seg);
+        mesh_set_header(pkt, MESH_ADDR_BROADCAST, MESH_TYPE_BCAST, sizeof(hdr) + seg);
+
+        tree_forward(pkt);
+        mesh_free(pkt);                 // Root keeps no copy
+        offset += seg;
+    } while (offset < len);
+
+    return true;
+}
+
+// ============================================================================
+// Reduce
+// ============================================================================
+
+static void PIO_SPI_DMA_HOT(combine)(uint op, uint32_t *acc, const uint32_t *v, uint count) {
+    for (uint i = 0; i < count; i++) {
+        switch (op) {
+        case MESH_REDUCE_OR:  acc[i] |= v[i]; break;
+        case MESH_REDUCE_AND: acc[i] &= v[i]; break;
+        case MESH_REDUCE_SUM: acc[i] += v[i]; break;
+        default:              if (v[i] > acc[i]) acc[i] = v[i]; break;
+        }
+    }
+}
+
+static void PIO_SPI_DMA_HOT(store_result)(uint16_t id, uint count, const uint32_t *values) {
+    memcpy(result_values, values, count * sizeof(uint32_t));
+    result_count = (uint8_t)count;
+    result_id = id;
+    result_ready = true;
+}
+
+// Send a reduce-family message: partial to the parent, or result to the tree
+static void PIO_SPI_DMA_HOT(send_reduce_msg)(uint8_t type, uint16_t dst, mesh_port_t port,
+                                             const reduce_slot_t *slot) {
+    pio_spi_packet_t *pkt = mesh_alloc();
+    if (!pkt) return;                   // Round is lost; callers time out
+
+    reduce_msg_t *msg = (reduce_msg_t *)pkt->payload;
+    msg->id = slot->id;
+    msg->op = slot->op;
+    msg->count = slot->count;
+    memcpy(msg->values, slot->acc, slot->count * sizeof(uint32_t));
+    mesh_set_header(pkt, dst, type, 4 + slot->count * sizeof(uint32_t));
+
+    if (port == MESH_PORT_LOCAL) {
+        tree_forward(pkt);
+        mesh_free(pkt);
+    } else {
+        mesh_port_send(port, pkt);
+    }
+}
+
+// Add a contribution to its round; pass it on once everyone is in (IRQs disabled)
+static void PIO_SPI_DMA_HOT(reduce_add)(uint16_t id, uint op, const uint32_t *values,
+                                        uint count, bool local) {
+    reduce_slot_t *slot = &slots[id & 1];
+
+    if (!slot->active || slot->id != id) {
+        mesh_port_t kids[2];
+        memset(slot, 0, sizeof(*slot));
+        slot->active = true;
+        slot->id = id;
+        slot->op = (uint8_t)op;
+        slot->count = (uint8_t)count;
+        slot->waiting = (uint8_t)tree_children(kids);
+    }
+
+    if (!slot->have) {
+        memcpy(slot->acc, values, count * sizeof(uint32_t));
+        slot->have = true;
+    } else {
+        combine(op, slot->acc, values, count);
+    }
+
+    if (local) {
+        slot->local = true;
+    } else if (slot->waiting) {
+        slot->waiting--;
+    }
+
+    if (!slot->local || slot->waiting) return;
+
+    mesh_port_t parent = mesh_tree_parent();
+    if (parent == MESH_PORT_LOCAL) {
+        store_result(slot->id, slot->count, slot->acc);
+        send_reduce_msg(MESH_TYPE_RESULT, MESH_ADDR_BROADCAST, MESH_PORT_LOCAL, slot);
+    } else {
+        uint16_t addr = mesh_addr();
+        uint16_t dst = (parent == MESH_PORT_S)
+            ? MESH_ADDR(MESH_ADDR_X(addr), MESH_ADDR_Y(addr) - 1)
+            : MESH_ADDR(MESH_ADDR_X(addr) - 1, MESH_ADDR_Y(addr));
+        send_reduce_msg(MESH_TYPE_REDUCE, dst, parent, slot);
+    }
+    slot->active = false;
+}
+
+bool mesh_reduce_contribute(mesh_reduce_op_t op, const uint32_t *values, uint count) {
+    if (count == 0 || count > MESH_REDUCE_WORDS) return false;
+
+    uint32_t save = save_and_disable_interrupts();
+    result_ready = false;
+    reduce_add(reduce_id++, op, values, count, true);
+    restore_interrupts(save);
+    return true;
+}
+
+bool mesh_reduce_result(uint32_t *result) {
+    uint32_t save = save_and_disable_interrupts();
+    bool done = result_ready && result_id == (uint16_t)(reduce_id - 1);
+    if (done) {
+        memcpy(result, result_values, result_count * sizeof(uint32_t));
+    }
+    restore_interrupts(save);
+    return done;
+}
+
+bool mesh_allreduce(mesh_reduce_op_t op, uint32_t *values, uint count, uint32_t timeout_ms) {
+    if (!mesh_reduce_contribute(op, values, count)) return false;
+
+    absolute_time_t deadline = make_timeout_time_ms(timeout_ms);
+    while (!mesh_reduce_result(values)) {
+        if (time_reached(deadline)) return false;
+        tight_loop_contents();
+    }
+    return true;
+}
+
+// ============================================================================
+// Mesh Hooks
+// ============================================================================
+
+void mesh_coll_init(void) {
+    memset(slots, 0, sizeof(slots));
+    reduce_id = 0;
+    bcast_id = 0;
+    result_ready = false;
+}
+
+void PIO_SPI_DMA_HOT(mesh_coll_receive)(pio_spi_packet_t *pkt) {
+    const reduce_msg_t *msg = (const reduce_msg_t *)pkt->payload;
+
+    switch (pkt->hdr.type) {
+    case MESH_TYPE_BCAST:
+        // Pass it on first: forwarding latency is what sets the issue rate
+        tree_forward(pkt);
+        mesh_deliver(pkt);
+        return;
+
+    case MESH_TYPE_REDUCE:
+        if (msg->count <= MESH_REDUCE_WORDS) {
+            uint32_t save = save_and_disable_interrupts();
+            reduce_add(msg->id, msg->op, msg->values, msg->count, false);
+            restore_interrupts(save);
+        }
+        break;
+
+    case MESH_TYPE_RESULT:
+        tree_forward(pkt);
+        if (msg->count <= MESH_REDUCE_WORDS) {
+            store_result(msg->id, msg->count, msg->values);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    mesh_free(pkt);
+}
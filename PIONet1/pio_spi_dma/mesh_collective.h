@@ -0,0 +1,152 @@
+/**
+ * Broadcast and reduction collectives over the mesh (MasPar ACU style)
+ *
+ * The root node (0,0) plays the array control unit. Both collectives run
+ * on a fixed spanning tree built from the mesh's row/column structure:
+ *
+ *   (0,2)   (1,2)   (2,2)          Broadcast: east along row 0, and
+ *     ^       ^       ^            north up every column from there.
+ *   (0,1)   (1,1)   (2,1)          Reduce: the same tree in reverse.
+ *     ^       ^       ^
+ *   (0,0) > (1,0) > (2,0)          Depth = width + height - 2 hops.
+ *
+ * Broadcast: the root cuts the message into MESH_BCAST_SEG byte segments.
+ * Each node forwards a segment to its children the moment it lands (one
+ * refcounted buffer, no copies), so a large broadcast streams down the
+ * tree with one segment time per hop rather than one message time.
+ * Segments reach the application through mesh_recv() as MESH_TYPE_BCAST
+ * packets.
+ *
+ * Reduce: every node contributes a vector of up to MESH_REDUCE_WORDS
+ * words; partials are combined in the DMA IRQ on the way up, and the root
+ * broadcasts the result so every node sees it (allreduce). Reductions are
+ * numbered by a per-node counter, so all nodes must contribute to every
+ * round, in order.
+ */
+
+#ifndef MESH_COLLECTIVE_H
+#define MESH_COLLECTIVE_H
+
+#include "mesh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Data bytes per broadcast segment (smaller = lower per-hop latency) */
+#ifndef MESH_BCAST_SEG
+#define MESH_BCAST_SEG 256
+#endif
+
+/** Largest reduction vector in 32-bit words */
+#ifndef MESH_REDUCE_WORDS
+#define MESH_REDUCE_WORDS 16
+#endif
+
+// ============================================================================
+// Spanning Tree
+// ============================================================================
+
+/**
+ * Port towards the root on the collective tree: south, else west
+ *
+ * MESH_PORT_LOCAL on the root. Anything that follows the tree up (e.g.
+ * clock sync, mesh_time.h) uses this, so it stays on the collectives' tree.
+ */
+mesh_port_t mesh_tree_parent(void);
+
+// ============================================================================
+// Broadcast
+// ============================================================================
+
+#define MESH_BCAST_LAST     0x01        // Final segment of the message
+
+/** Leads the payload of every MESH_TYPE_BCAST packet */
+typedef struct {
+    uint16_t id;                // Broadcast number (wraps)
+    uint8_t tag;                // Application-defined
+    uint8_t flags;              // MESH_BCAST_LAST
+    uint32_t offset;            // Byte offset of this segment in the message
+    uint32_t total;             // Bytes in the whole message
+} mesh_bcast_hdr_t;
+
+/**
+ * Broadcast a message from the root to every other node
+ *
+ * @param data       Message
+ * @param len        Length in bytes (any size, segmented)
+ * @param tag        Application tag carried in every segment
+ * @param timeout_ms Give up if the tree doesn't drain in this time
+ * @return           false if not the root or the timeout expired
+ *
+ * Blocks until every segment is queued on the root's child ports.
+ */
+bool mesh_bcast(const void *data, size_t len, uint8_t tag, uint32_t timeout_ms);
+
+/** Segment header of a MESH_TYPE_BCAST packet */
+static inline const mesh_bcast_hdr_t *mesh_bcast_header(const pio_spi_packet_t *pkt) {
+    return (const mesh_bcast_hdr_t *)pkt->payload;
+}
+
+/** Segment data of a MESH_TYPE_BCAST packet */
+static inline const uint8_t *mesh_bcast_data(const pio_spi_packet_t *pkt) {
+    return pkt->payload + sizeof(mesh_bcast_hdr_t);
+}
+
+/** Segment data length of a MESH_TYPE_BCAST packet */
+static inline size_t mesh_bcast_len(const pio_spi_packet_t *pkt) {
+    return pkt->hdr.len - sizeof(mesh_bcast_hdr_t);
+}
+
+// ============================================================================
+// Reduce
+// ============================================================================
+
+typedef enum {
+    MESH_REDUCE_OR,
+    MESH_REDUCE_AND,
+    MESH_REDUCE_SUM,
+    MESH_REDUCE_MAX
+} mesh_reduce_op_t;
+
+/**
+ * Contribute this node's values to the next reduction round (non-blocking)
+ *
+ * @param op     Combining operation (must match on every node)
+ * @param values Values to combine element-wise
+ * @param count  Number of words (<= MESH_REDUCE_WORDS)
+ * @return       false if count is too large
+ */
+bool mesh_reduce_contribute(mesh_reduce_op_t op, const uint32_t *values, uint count);
+
+/**
+ * Fetch the result of the round last contributed to
+ *
+ * @param result Receives count words
+ * @return       true once the result has arrived
+ */
+bool mesh_reduce_result(uint32_t *result);
+
+/**
+ * Contribute, then wait for the global result (allreduce)
+ *
+ * @param values In: this node's values. Out: combined over all nodes.
+ * @return       false on timeout
+ */
+bool mesh_allreduce(mesh_reduce_op_t op, uint32_t *values, uint count, uint32_t timeout_ms);
+
+// ============================================================================
+// Mesh Hooks
+// ============================================================================
+
+/** Reset collective state (called by mesh_init) */
+void mesh_coll_init(void);
+
+/** Handle a collective packet from a link (IRQ context, consumes pkt) */
+void mesh_coll_receive(pio_spi_packet_t *pkt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_COLLECTIVE_H
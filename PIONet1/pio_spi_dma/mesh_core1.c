@@ -0,0 +1,161 @@
+/**
+ * Mesh network stack on core1, application on core0
+ */
+
+#include "mesh_core1.h"
+#include "spsc_ring.h"
+#include "pico/multicore.h"
+#include "pico/time.h"
+#include "hardware/sync.h"
+
+// Timers for the links (resync, retransmit) fire on core1 too
+#define CORE1_ALARMS    16
+
+static mesh_config_t core1_cfg;
+
+static void *tx_slots[MESH_CORE1_RING_DEPTH];
+static void *rx_slots[MESH_CORE1_RING_DEPTH];
+static void *free_slots[MESH_CORE1_RING_DEPTH];
+static void *alloc_slots[MESH_CORE1_ALLOC_DEPTH];
+static spsc_ring_t tx_ring;             // core0 -> core1: packets to send
+static spsc_ring_t rx_ring;             // core1 -> core0: packets received
+static spsc_ring_t free_ring;           // core0 -> core1: buffers to release
+static spsc_ring_t alloc_ring;          // core1 -> core0: buffers to fill
+
+// One call at a time: core0 owns the slot until done is set
+static mesh_core1_func_t call_fn;
+static void *call_arg;
+static uint32_t call_result;
+static volatile bool call_pending;
+static volatile bool call_done;
+
+// ============================================================================
+// Core1
+// ============================================================================
+
+static void core1_service(void) {
+    pio_spi_packet_t *pkt;
+    static pio_spi_packet_t *rx_pending;   // Waiting for room in rx_ring
+
+    while ((pkt = spsc_ring_pop(&free_ring)) != NULL) {
+        mesh_free(pkt);
+    }
+
+    while ((pkt = spsc_ring_pop(&tx_ring)) != NULL) {
+        mesh_send(pkt, pkt->hdr.dst, pkt->hdr.type, pkt->hdr.len);
+    }
+
+    while (spsc_ring_space(&alloc_ring) && (pkt = mesh_alloc()) != NULL) {
+        spsc_ring_push(&alloc_ring, pkt);
+    }
+
+    bool delivered = false;
+    for (;;) {
+        if (!rx_pending) rx_pending = mesh_recv();
+        if (!rx_pending || !spsc_ring_push(&rx_ring, rx_pending)) break;
+        rx_pending = NULL;
+        delivered = true;
+    }
+    if (delivered) {
+        __sev();                        // Wake core0 if it waits in WFE
+    }
+
+    if (call_pending) {
+        call_pending = false;
+        call_result = call_fn(call_arg);
+        __mem_fence_release();
+        call_done = true;
+        __sev();
+    }
+}
+
+static void core1_main(void) {
+    pio_spi_packet_set_alarm_pool(alarm_pool_create_with_unused_hardware_alarm(CORE1_ALARMS));
+
+    // DMA and PIO IRQ handlers install on the core that brings links up
+    bool ok = mesh_init(&core1_cfg);
+    multicore_fifo_push_blocking(ok);
+    if (!ok) return;
+
+    while (1) {
+        mesh_poll();
+        core1_service();
+    }
+}
+
+// ============================================================================
+// Core0
+// ============================================================================
+
+bool mesh_core1_launch(const mesh_config_t *cfg) {
+    core1_cfg = *cfg;
+    spsc_ring_init(&tx_ring, tx_slots, MESH_CORE1_RING_DEPTH);
+    spsc_ring_init(&rx_ring, rx_slots, MESH_CORE1_RING_DEPTH);
+    spsc_ring_init(&free_ring, free_slots, MESH_CORE1_RING_DEPTH);
+    spsc_ring_init(&alloc_ring, alloc_slots, MESH_CORE1_ALLOC_DEPTH);
+    call_pending = false;
+    call_done = false;
+
+    multicore_reset_core1();
+    multicore_launch_core1(core1_main);
+    return multicore_fifo_pop_blocking() != 0;
+}
+
+pio_spi_packet_t *mesh_core1_alloc(void) {
+    return spsc_ring_pop(&alloc_ring);
+}
+
+void mesh_core1_free(pio_spi_packet_t *pkt) {
+    // Core1 drains continuously, so a full ring clears within a poll
+    while (!spsc_ring_push(&free_ring, pkt)) {
+        tight_loop_contents();
+    }
+}
+
+bool mesh_core1_send(pio_spi_packet_t *pkt, uint16_t dst, uint8_t type, size_t len) {
+    if (len > PIO_SPI_PACKET_MAX_PAYLOAD) {
+        mesh_core1_free(pkt);
+        return false;
+    }
+
+    // Core1 takes the destination from the header and fills in the rest
+    pkt->hdr.dst = dst;
+    pkt->hdr.type = type;
+    pkt->hdr.len = (uint16_t)len;
+    if (!spsc_ring_push(&tx_ring, pkt)) {
+        mesh_core1_free(pkt);
+        return false;
+    }
+    return true;
+}
+
+pio_spi_packet_t *mesh_core1_recv(void) {
+    return spsc_ring_pop(&rx_ring);
+}
+
+pio_spi_packet_t *mesh_core1_recv_blocking(uint32_t timeout_us) {
+    absolute_time_t deadline = make_timeout_time_us(timeout_us);
+    pio_spi_packet_t *pkt;
+
+    // Core1 sends an event with every delivery; the timer wakes us too
+    while ((pkt = spsc_ring_pop(&rx_ring)) == NULL) {
+        if (best_effort_wfe_or_timeout(deadline)) {
+            return spsc_ring_pop(&rx_ring);
+        }
+    }
+    return pkt;
+}
+
+uint32_t mesh_core1_call(mesh_core1_func_t fn, void *arg) {
+    call_fn = fn;
+    call_arg = arg;
+    call_done = false;
+    __mem_fence_release();
+    call_pending = true;
+
+    while (!call_done) {
+        __wfe();
+    }
+    __mem_fence_acquire();
+    return call_result;
+}
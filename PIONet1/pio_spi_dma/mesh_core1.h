@@ -0,0 +1,100 @@
+/**
+ * Mesh network stack on core1, application on core0
+ *
+ * mesh_core1_launch() brings the mesh up on core1, so DMA and PIO
+ * interrupts, link timers, HELLO beacons and routing all run there and
+ * core0 sees no network interrupts at all. The cores meet only through
+ * lock-free SPSC rings of packet pointers (spsc_ring.h):
+ *
+ *   core0                          core1
+ *   mesh_core1_alloc()  <-- alloc ---  pool buffers kept topped up
+ *   mesh_core1_send()   --- tx ----->  mesh_send()
+ *   mesh_core1_recv()   <-- rx ------  mesh_recv()
+ *   mesh_core1_free()   --- free --->  mesh_free()
+ *
+ * Core1 signals new RX packets with SEV, so mesh_core1_recv_blocking()
+ * sleeps in WFE instead of spinning.
+ *
+ * Everything else in mesh.h and mesh_collective.h must only be called on
+ * core1: use mesh_core1_call() to run such code there (e.g. a reduction),
+ * with core0 waiting for the result.
+ */
+
+#ifndef MESH_CORE1_H
+#define MESH_CORE1_H
+
+#include "mesh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Slots in each of the tx, rx and free rings (power of 2) */
+#ifndef MESH_CORE1_RING_DEPTH
+#define MESH_CORE1_RING_DEPTH 16
+#endif
+
+/** Pool buffers kept ready for mesh_core1_alloc() (power of 2) */
+#ifndef MESH_CORE1_ALLOC_DEPTH
+#define MESH_CORE1_ALLOC_DEPTH 4
+#endif
+
+/** Function run on core1 by mesh_core1_call() */
+typedef uint32_t (*mesh_core1_func_t)(void *arg);
+
+/**
+ * Start core1 and bring the mesh up on it (call from core0)
+ *
+ * @param cfg   As for mesh_init() (copied)
+ * @return      Result of mesh_init() on core1
+ */
+bool mesh_core1_launch(const mesh_config_t *cfg);
+
+/**
+ * Take a packet buffer (core0)
+ *
+ * @return      Buffer, or NULL if none is ready yet
+ */
+pio_spi_packet_t *mesh_core1_alloc(void);
+
+/**
+ * Send a packet to any node (core0, as mesh_send)
+ *
+ * @return      false if the tx ring was full (the packet is freed)
+ */
+bool mesh_core1_send(pio_spi_packet_t *pkt, uint16_t dst, uint8_t type, size_t len);
+
+/**
+ * Next packet addressed to this node (core0)
+ *
+ * @return      Packet (release with mesh_core1_free()), or NULL
+ */
+pio_spi_packet_t *mesh_core1_recv(void);
+
+/**
+ * Wait for the next packet addressed to this node (core0)
+ *
+ * @param timeout_us    Give up after this long
+ * @return              Packet, or NULL on timeout
+ */
+pio_spi_packet_t *mesh_core1_recv_blocking(uint32_t timeout_us);
+
+/**
+ * Release a packet buffer (core0)
+ */
+void mesh_core1_free(pio_spi_packet_t *pkt);
+
+/**
+ * Run a function on core1 between network polls and wait for it (core0)
+ *
+ * @param fn    Function, free to use the whole mesh API
+ * @param arg   Passed to fn
+ * @return      fn's return value
+ */
+uint32_t mesh_core1_call(mesh_core1_func_t fn, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_CORE1_H
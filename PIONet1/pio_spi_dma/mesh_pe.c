@@ -0,0 +1,324 @@
+/**
+ * SIMD processing-element runtime (MasPar style instruction stream)
+ */
+
+#include "mesh_pe.h"
+#include "mesh_xnet.h"
+#include "pico/time.h"
+#include <string.h>
+
+#define EDGE_MAX (MESH_PE_TILE_W > MESH_PE_TILE_H ? MESH_PE_TILE_W : MESH_PE_TILE_H)
+
+// PE state: lanes are the inner index, so one register or memory word of
+// the whole tile is contiguous
+static uint32_t regs[MESH_PE_REGS][MESH_PE_LANES];
+static uint32_t mem[MESH_PE_MEM_WORDS][MESH_PE_LANES];
+static uint8_t active[MESH_PE_LANES];
+static uint32_t errors;                 // This program, voted at the end
+
+// Program arriving from the root
+static uint32_t prog[MESH_PE_PROG_WORDS];
+static struct {
+    bool started;
+    bool done;                  // Last segment seen
+    bool broken;                // Segment missing or too long: stop early
+    uint16_t id;
+    uint32_t bytes;             // Landed, in order
+    uint32_t total;
+} rx;
+
+// ============================================================================
+// Geometry
+// ============================================================================
+
+static const int8_t dir_dx[MESH_PORTS] = { 0, 1, 0, -1 };
+static const int8_t dir_dy[MESH_PORTS] = { 1, 0, -1, 0 };
+
+static inline uint lane_of(uint x, uint y) {
+    return y * MESH_PE_TILE_W + x;
+}
+
+static inline mesh_port_t opposite(mesh_port_t p) {
+    return (mesh_port_t)((p + 2) % MESH_PORTS);
+}
+
+// ============================================================================
+// Receive
+// ============================================================================
+
+static void program_segment(const pio_spi_packet_t *pkt) {
+    const mesh_bcast_hdr_t *hdr = mesh_bcast_header(pkt);
+    size_t len = mesh_bcast_len(pkt);
+
+    if (hdr->offset == 0) {
+        memset(&rx, 0, sizeof(rx));
+        rx.started = true;
+        rx.id = hdr->id;
+        rx.total = hdr->total;
+        rx.broken = (hdr->total % 4) || hdr->total > sizeof(prog);
+    } else if (!rx.started || hdr->id != rx.id || hdr->offset != rx.bytes) {
+        rx.broken = true;
+    }
+
+    if (!rx.broken) {
+        memcpy((uint8_t *)prog + rx.bytes, mesh_bcast_data(pkt), len);
+        rx.bytes += len;
+    }
+    if (hdr->flags & MESH_BCAST_LAST) {
+        rx.done = true;
+    }
+}
+
+static void take(pio_spi_packet_t *pkt) {
+    if (pkt->hdr.type == MESH_TYPE_BCAST && mesh_bcast_header(pkt)->tag == MESH_PE_TAG) {
+        program_segment(pkt);
+    }
+    mesh_free(pkt);
+}
+
+// Everything waiting: called from every wait so packets never back up
+static void drain(void) {
+    mesh_poll();
+
+    pio_spi_packet_t *pkt;
+    while ((pkt = mesh_recv()) != NULL) {
+        take(pkt);
+    }
+}
+
+// ============================================================================
+// Communication Ops
+// ============================================================================
+
+// d = a moved one PE in direction dir, across tiles
+static void shift(uint32_t *rd, const uint32_t *ra, mesh_port_t dir) {
+    static uint32_t edge_out[EDGE_MAX], edge_in[EDGE_MAX];
+    static uint32_t next[MESH_PE_LANES];
+    int dx = dir_dx[dir], dy = dir_dy[dir];
+
+    // The lanes that fall off our far edge go to the neighbour that way
+    uint n = 0;
+    for (uint y = 0; y < MESH_PE_TILE_H; y++) {
+        for (uint x = 0; x < MESH_PE_TILE_W; x++) {
+            if (x + dx >= MESH_PE_TILE_W || y + dy >= MESH_PE_TILE_H) {
+                edge_out[n++] = ra[lane_of(x, y)];
+            }
+        }
+    }
+
+    const void *tx[MESH_PORTS] = { NULL };
+    void *rx[MESH_PORTS] = { NULL };
+    tx[dir] = edge_out;
+    rx[opposite(dir)] = edge_in;
+
+    mesh_xnet_t xn;
+    absolute_time_t deadline = make_timeout_time_ms(MESH_PE_TIMEOUT_MS);
+    bool started;
+    while (!(started = mesh_xnet_start(&xn, tx, rx, n * sizeof(uint32_t))) &&
+           !time_reached(deadline)) {
+        drain();
+    }
+    while (started && !mesh_xnet_done(&xn) && !time_reached(deadline)) {
+        drain();
+    }
+    if (!started || !mesh_xnet_done(&xn) || xn.mismatch) {
+        if (started) mesh_xnet_cancel(&xn);
+        else memset(edge_in, 0, sizeof(edge_in));
+        errors++;
+    }
+
+    // Interior lanes copy within the tile, the near edge takes edge_in
+    n = 0;
+    for (uint y = 0; y < MESH_PE_TILE_H; y++) {
+        for (uint x = 0; x < MESH_PE_TILE_W; x++) {
+            uint sx = x - dx, sy = y - dy;
+            if (sx < MESH_PE_TILE_W && sy < MESH_PE_TILE_H) {
+                next[lane_of(x, y)] = ra[lane_of(sx, sy)];
+            } else {
+                next[lane_of(x, y)] = edge_in[n++];
+            }
+        }
+    }
+
+    for (uint l = 0; l < MESH_PE_LANES; l++) {
+        if (active[l]) rd[l] = next[l];
+    }
+}
+
+// Combine over the active lanes here, then over the array
+static bool reduce(mesh_reduce_op_t op, uint32_t *value) {
+    if (!mesh_reduce_contribute(op, value, 1)) return false;
+
+    absolute_time_t deadline = make_timeout_time_ms(MESH_PE_TIMEOUT_MS);
+    while (!mesh_reduce_result(value)) {
+        if (time_reached(deadline)) return false;
+        drain();
+    }
+    return true;
+}
+
+static void reduce_op(uint32_t *rd, const uint32_t *ra, bool sum) {
+    uint32_t v = 0;
+    for (uint l = 0; l < MESH_PE_LANES; l++) {
+        if (!active[l]) continue;
+        if (sum) v += ra[l];
+        else if (ra[l] > v) v = ra[l];
+    }
+
+    if (!reduce(sum ? MESH_REDUCE_SUM : MESH_REDUCE_MAX, &v)) {
+        errors++;
+        return;
+    }
+    for (uint l = 0; l < MESH_PE_LANES; l++) {
+        if (active[l]) rd[l] = v;
+    }
+}
+
+// ============================================================================
+// Execute
+// ============================================================================
+
+#define FOR_ACTIVE(l) for (uint l = 0; l < MESH_PE_LANES; l++) if (active[l])
+
+static void exec(uint32_t insn) {
+    uint op = insn >> 24;
+    uint16_t imm = (uint16_t)insn;
+    int32_t simm = (int16_t)imm;
+    uint32_t *rd = regs[(insn >> 20) & 0xf];
+    const uint32_t *ra = regs[(insn >> 16) & 0xf];
+    const uint32_t *rb = regs[imm & 0xf];
+
+    switch (op) {
+    case MESH_PE_NOP:   break;
+    case MESH_PE_LDI:   FOR_ACTIVE(l) rd[l] = (uint32_t)simm; break;
+    case MESH_PE_COORD: {
+        uint16_t a = mesh_addr();
+        FOR_ACTIVE(l) {
+            rd[l] = imm ? MESH_ADDR_Y(a) * MESH_PE_TILE_H + l / MESH_PE_TILE_W
+                        : MESH_ADDR_X(a) * MESH_PE_TILE_W + l % MESH_PE_TILE_W;
+        }
+        break;
+    }
+    case MESH_PE_MOV:   FOR_ACTIVE(l) rd[l] = ra[l]; break;
+
+    case MESH_PE_LD:
+    case MESH_PE_ST:
+        if (imm >= MESH_PE_MEM_WORDS) {
+            errors++;
+        } else if (op == MESH_PE_LD) {
+            FOR_ACTIVE(l) rd[l] = mem[imm][l];
+        } else {
+            FOR_ACTIVE(l) mem[imm][l] = rd[l];
+        }
+        break;
+
+    case MESH_PE_LDX:
+    case MESH_PE_STX:
+        FOR_ACTIVE(l) {
+            uint32_t addr = ra[l] + (uint32_t)simm;
+            if (addr >= MESH_PE_MEM_WORDS) {
+                errors++;
+            } else if (op == MESH_PE_LDX) {
+                rd[l] = mem[addr][l];
+            } else {
+                mem[addr][l] = rd[l];
+            }
+        }
+        break;
+
+    case MESH_PE_ADD:   FOR_ACTIVE(l) rd[l] = ra[l] + rb[l]; break;
+    case MESH_PE_SUB:   FOR_ACTIVE(l) rd[l] = ra[l] - rb[l]; break;
+    case MESH_PE_MUL:   FOR_ACTIVE(l) rd[l] = ra[l] * rb[l]; break;
+    case MESH_PE_AND:   FOR_ACTIVE(l) rd[l] = ra[l] & rb[l]; break;
+    case MESH_PE_OR:    FOR_ACTIVE(l) rd[l] = ra[l] | rb[l]; break;
+    case MESH_PE_XOR:   FOR_ACTIVE(l) rd[l] = ra[l] ^ rb[l]; break;
+    case MESH_PE_SHL:   FOR_ACTIVE(l) rd[l] = ra[l] << (rb[l] & 31); break;
+    case MESH_PE_SHR:   FOR_ACTIVE(l) rd[l] = ra[l] >> (rb[l] & 31); break;
+    case MESH_PE_MIN:   FOR_ACTIVE(l) rd[l] = ((int32_t)ra[l] < (int32_t)rb[l]) ? ra[l] : rb[l]; break;
+    case MESH_PE_MAX:   FOR_ACTIVE(l) rd[l] = ((int32_t)ra[l] > (int32_t)rb[l]) ? ra[l] : rb[l]; break;
+    case MESH_PE_EQ:    FOR_ACTIVE(l) rd[l] = ra[l] == rb[l]; break;
+    case MESH_PE_LT:    FOR_ACTIVE(l) rd[l] = (int32_t)ra[l] < (int32_t)rb[l]; break;
+    case MESH_PE_ADDI:  FOR_ACTIVE(l) rd[l] = ra[l] + (uint32_t)simm; break;
+
+    case MESH_PE_MSET:  for (uint l = 0; l < MESH_PE_LANES; l++) active[l] = ra[l] != 0; break;
+    case MESH_PE_MAND:  for (uint l = 0; l < MESH_PE_LANES; l++) active[l] &= ra[l] != 0; break;
+    case MESH_PE_MNOT:  for (uint l = 0; l < MESH_PE_LANES; l++) active[l] = !active[l]; break;
+    case MESH_PE_MALL:  memset(active, 1, sizeof(active)); break;
+
+    case MESH_PE_SHIFT:
+        if (imm < MESH_PORTS) {
+            shift(rd, ra, (mesh_port_t)imm);
+        } else {
+            errors++;
+        }
+        break;
+
+    case MESH_PE_RSUM:  reduce_op(rd, ra, true); break;
+    case MESH_PE_RMAX:  reduce_op(rd, ra, false); break;
+
+    default:
+        errors++;
+        break;
+    }
+}
+
+// Run a program and vote: errors summed over the array
+static int run(const uint32_t *code, uint count, bool streaming) {
+    absolute_time_t deadline = make_timeout_time_ms(MESH_PE_TIMEOUT_MS);
+
+    for (uint pc = 0; pc < count; pc++) {
+        // Execute as segments land; stop where a broken stream leaves off
+        while (streaming && pc >= rx.bytes / 4) {
+            if (rx.broken || time_reached(deadline)) {
+                errors++;
+                pc = count;
+                break;
+            }
+            drain();
+            deadline = make_timeout_time_ms(MESH_PE_TIMEOUT_MS);
+        }
+        if (pc < count) exec(code[pc]);
+    }
+
+    uint32_t vote = errors;
+    errors = 0;
+    return reduce(MESH_REDUCE_SUM, &vote) ? (int)vote : -1;
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+void mesh_pe_init(void) {
+    memset(regs, 0, sizeof(regs));
+    memset(mem, 0, sizeof(mem));
+    memset(active, 1, sizeof(active));
+    memset(&rx, 0, sizeof(rx));
+    errors = 0;
+}
+
+bool mesh_pe_poll(void) {
+    drain();
+    if (!rx.started) return false;
+
+    if (rx.broken) errors++;            // Still votes, keeping reductions in step
+    run(prog, rx.broken ? 0 : rx.total / 4, true);
+    memset(&rx, 0, sizeof(rx));
+    return true;
+}
+
+int mesh_pe_issue(const uint32_t *code, uint count) {
+    if (count == 0 || count > MESH_PE_PROG_WORDS) return -1;
+    if (!mesh_bcast(code, count * sizeof(uint32_t), MESH_PE_TAG, MESH_PE_TIMEOUT_MS)) {
+        return -1;
+    }
+    return run(code, count, false);
+}
+
+uint32_t *mesh_pe_reg(uint r) {
+    return regs[r % MESH_PE_REGS];
+}
+
+uint32_t *mesh_pe_mem(uint addr) {
+    return mem[addr % MESH_PE_MEM_WORDS];
+}
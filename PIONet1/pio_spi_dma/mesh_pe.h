@@ -0,0 +1,162 @@
+/**
+ * SIMD processing-element runtime (MasPar style instruction stream)
+ *
+ * Every node is a tile of MESH_PE_TILE_W x MESH_PE_TILE_H processing
+ * elements (lanes) with their own registers and memory; the whole mesh
+ * is one array of width * MESH_PE_TILE_W by height * MESH_PE_TILE_H PEs.
+ * The root plays the array control unit: it broadcasts a program of
+ * 32-bit opcodes and every node runs it in lockstep over all its lanes,
+ * so one broadcast instruction does a whole vector of work per node.
+ *
+ *   31      24 23  20 19  16 15               0
+ *   +---------+------+------+------------------+
+ *   |   op    |  d   |  a   |   imm / b (3:0)  |
+ *   +---------+------+------+------------------+
+ *
+ * Lanes whose activity bit is clear skip register and memory writes;
+ * mask ops set the bits from a register (MasPar "where"). SHIFT moves a
+ * register one PE in a direction across the whole array: interior lanes
+ * copy within the tile and the tile's edge goes over the link to the
+ * neighbour (mesh_xnet.h), which is what ties the nodes together. Lanes
+ * on the edge of the array shift in zero.
+ *
+ * A program runs as its broadcast segments land, so it overlaps its own
+ * delivery. At the end every node votes its error count into an
+ * allreduce; the root only issues the next program after that, which
+ * makes programs the unit of flow control as well as of lockstep.
+ */
+
+#ifndef MESH_PE_H
+#define MESH_PE_H
+
+#include "mesh_collective.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+/** Lanes per node: a tile of W * H PEs */
+#ifndef MESH_PE_TILE_W
+#define MESH_PE_TILE_W 8
+#endif
+
+#ifndef MESH_PE_TILE_H
+#define MESH_PE_TILE_H 8
+#endif
+
+#define MESH_PE_LANES (MESH_PE_TILE_W * MESH_PE_TILE_H)
+
+/** Registers per PE (4-bit fields address 16) */
+#define MESH_PE_REGS 16
+
+/** Memory words per PE */
+#ifndef MESH_PE_MEM_WORDS
+#define MESH_PE_MEM_WORDS 256
+#endif
+
+/** Largest program in opcodes (one broadcast) */
+#ifndef MESH_PE_PROG_WORDS
+#define MESH_PE_PROG_WORDS 1024
+#endif
+
+/** Give up on a neighbour's shift data or a reduction after this long */
+#ifndef MESH_PE_TIMEOUT_MS
+#define MESH_PE_TIMEOUT_MS 1000
+#endif
+
+/** Broadcast tag of program messages */
+#define MESH_PE_TAG 0xfd
+
+// ============================================================================
+// Instruction Set
+// ============================================================================
+
+typedef enum {
+    MESH_PE_NOP,
+    // Data movement
+    MESH_PE_LDI,        // d = sign-extended imm
+    MESH_PE_COORD,      // d = array x (imm 0) or y (imm 1) of the lane
+    MESH_PE_MOV,        // d = a
+    MESH_PE_LD,         // d = mem[imm]
+    MESH_PE_ST,         // mem[imm] = d
+    MESH_PE_LDX,        // d = mem[a + imm]
+    MESH_PE_STX,        // mem[a + imm] = d
+    // ALU: d = a op b
+    MESH_PE_ADD,
+    MESH_PE_SUB,
+    MESH_PE_MUL,
+    MESH_PE_AND,
+    MESH_PE_OR,
+    MESH_PE_XOR,
+    MESH_PE_SHL,        // by b & 31
+    MESH_PE_SHR,        // Logical, by b & 31
+    MESH_PE_MIN,        // Signed
+    MESH_PE_MAX,        // Signed
+    MESH_PE_EQ,         // 1 if equal, else 0
+    MESH_PE_LT,         // 1 if a < b signed, else 0
+    MESH_PE_ADDI,       // d = a + sign-extended imm
+    // Activity mask (applies to every lane, active or not)
+    MESH_PE_MSET,       // active = a != 0
+    MESH_PE_MAND,       // active &= a != 0
+    MESH_PE_MNOT,       // active = !active
+    MESH_PE_MALL,       // active = 1
+    // Communication
+    MESH_PE_SHIFT,      // d = a of the next PE against direction imm (mesh_port_t)
+    MESH_PE_RSUM,       // d = sum of a over every active lane of the array
+    MESH_PE_RMAX,       // d = max of a (unsigned) over every active lane
+    MESH_PE_OPS
+} mesh_pe_op_t;
+
+#define MESH_PE_INSN(op, d, a, imm) \
+    (((uint32_t)(op) << 24) | (((uint32_t)(d) & 0xf) << 20) | \
+     (((uint32_t)(a) & 0xf) << 16) | ((uint32_t)(imm) & 0xffff))
+
+/** d = a op b */
+#define MESH_PE_ALU(op, d, a, b)    MESH_PE_INSN(op, d, a, b)
+
+/** d = a moved one PE in direction dir (MESH_PORT_E: east, taking the west PE's) */
+#define MESH_PE_SHIFT_INSN(d, a, dir)   MESH_PE_INSN(MESH_PE_SHIFT, d, a, dir)
+
+// ============================================================================
+// API
+// ============================================================================
+
+/** Clear registers and memory and set every lane active */
+void mesh_pe_init(void);
+
+/**
+ * Run the next program from the root, if one is arriving (other nodes)
+ *
+ * @return      true if a program ran
+ *
+ * Blocks until the program has arrived, run and voted. Call in a loop;
+ * the runtime owns mesh_recv() while it runs and frees non-PE packets.
+ */
+bool mesh_pe_poll(void);
+
+/**
+ * Broadcast a program and run it here too (root)
+ *
+ * @param prog   Opcodes
+ * @param count  Number of opcodes (<= MESH_PE_PROG_WORDS)
+ * @return       Errors summed over the array (bad opcodes, memory
+ *               addresses out of range, shift or reduction timeouts),
+ *               or -1 if not the root or the broadcast failed
+ */
+int mesh_pe_issue(const uint32_t *prog, uint count);
+
+/** One register of every lane (lane = y * MESH_PE_TILE_W + x) */
+uint32_t *mesh_pe_reg(uint r);
+
+/** One memory word of every lane */
+uint32_t *mesh_pe_mem(uint addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_PE_H
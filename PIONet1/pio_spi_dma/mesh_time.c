@@ -0,0 +1,370 @@
+/**
+ * Machine-wide clock: every node's timer synced to the root's
+ */
+
+#include "mesh_time.h"
+#include "mesh_collective.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
+#include <stdio.h>
+#include <string.h>
+
+// Responses waiting for mesh_time_poll() (power of 2)
+#define SAMPLE_DEPTH 4
+
+// Largest rate the fit may report (crystals are tens of ppm apart)
+#define MAX_RATE 500e-6
+
+// Bits of a packet header, after which the RX stamp is taken
+#define HDR_BITS (8 * sizeof(pio_spi_packet_hdr_t))
+
+enum {
+    TIME_REQ,
+    TIME_RESP
+};
+
+typedef struct __attribute__((packed, aligned(4))) {
+    uint8_t op;
+    uint8_t seq;
+    uint16_t reserved;
+    int64_t t1;                 // Child's departure (its local time)
+    int64_t t2;                 // Parent's arrival (mesh time)
+    int64_t t3;                 // Parent's departure (mesh time)
+} time_msg_t;
+
+typedef struct {
+    int64_t t1, t2, t3, t4;
+} time_sample_t;
+
+typedef struct {
+    int64_t at;                 // Local time of the exchange (midpoint)
+    int64_t offset;             // Mesh minus local
+    int64_t rtt;
+} time_point_t;
+
+// mesh = local + off + rate * (local - ref) / 2^32
+typedef struct {
+    int64_t ref;
+    int64_t off;
+    int32_t rate;
+} time_model_t;
+
+static time_model_t model;
+static volatile bool synced;
+
+static uint32_t hdr_ns[MESH_PORTS];         // Header wire time per TX port
+
+static time_sample_t samples[SAMPLE_DEPTH];
+static volatile uint32_t sample_head;
+static uint32_t sample_tail;
+
+static volatile bool req_pending;
+static uint8_t req_seq;
+static absolute_time_t next_req;
+
+static time_point_t window[MESH_TIME_WINDOW];
+static uint win_count;
+static uint win_next;
+static uint slow_streak;
+static uint step_streak;
+
+static mesh_time_status_t status;
+
+// ============================================================================
+// Time Base
+// ============================================================================
+
+int64_t PIO_SPI_DMA_HOT(mesh_time_local)(void) {
+    return (int64_t)time_us_64() * 1000;
+}
+
+// Widen a 32-bit timer stamp from the recent past
+static int64_t PIO_SPI_DMA_HOT(stamp_local)(uint32_t stamp) {
+    uint64_t now = time_us_64();
+    return (int64_t)(now - (uint32_t)((uint32_t)now - stamp)) * 1000;
+}
+
+static inline int64_t PIO_SPI_DMA_HOT(model_apply)(const time_model_t *m, int64_t local_ns) {
+    int64_t d = local_ns - m->ref;
+    return local_ns + m->off + (((d >> 8) * m->rate) >> 24);
+}
+
+int64_t PIO_SPI_DMA_HOT(mesh_time_from_local)(int64_t local_ns) {
+    uint32_t save = save_and_disable_interrupts();
+    time_model_t m = model;
+    restore_interrupts(save);
+    return model_apply(&m, local_ns);
+}
+
+int64_t mesh_time_to_local(int64_t mesh_ns) {
+    uint32_t save = save_and_disable_interrupts();
+    time_model_t m = model;
+    restore_interrupts(save);
+
+    // One step of the inverse: the rate term is tiny, so its error is too
+    int64_t local = mesh_ns - m.off;
+    int64_t d = local - m.ref;
+    return local - (((d >> 8) * m.rate) >> 24);
+}
+
+int64_t PIO_SPI_DMA_HOT(mesh_time_now)(void) {
+    return mesh_time_from_local(mesh_time_local());
+}
+
+int64_t mesh_time_rx(const pio_spi_packet_t *pkt) {
+    return mesh_time_from_local(stamp_local(pio_spi_packet_rx_stamp(pkt)));
+}
+
+bool mesh_time_synced(void) {
+    return synced;
+}
+
+void mesh_time_wait_until(int64_t t) {
+    int64_t local = mesh_time_to_local(t);
+    while (mesh_time_local() < local) {
+        tight_loop_contents();
+    }
+}
+
+// ============================================================================
+// Model
+// ============================================================================
+
+static int64_t best_rtt(void) {
+    int64_t best = INT64_MAX;
+    for (uint i = 0; i < win_count; i++) {
+        if (window[i].rtt < best) best = window[i].rtt;
+    }
+    return best;
+}
+
+// Least squares over the window, about the newest exchange
+static void fit(void) {
+    const time_point_t *last = &window[(win_next + MESH_TIME_WINDOW - 1) % MESH_TIME_WINDOW];
+    double n = (double)win_count;
+    double mx = 0, my = 0;
+    for (uint i = 0; i < win_count; i++) {
+        mx += (double)(window[i].at - last->at);
+        my += (double)(window[i].offset - last->offset);
+    }
+    mx /= n;
+    my /= n;
+
+    double sxx = 0, sxy = 0;
+    for (uint i = 0; i < win_count; i++) {
+        double x = (double)(window[i].at - last->at) - mx;
+        double y = (double)(window[i].offset - last->offset) - my;
+        sxx += x * x;
+        sxy += x * y;
+    }
+
+    // Too few points for a slope yet: keep the rate we had
+    double b = (double)model.rate / 4294967296.0;
+    if (win_count >= 4 && sxx > 0) {
+        b = sxy / sxx;
+        if (b > MAX_RATE) b = MAX_RATE;
+        if (b < -MAX_RATE) b = -MAX_RATE;
+    }
+    double a = my - b * mx;                 // Offset at the newest exchange
+
+    double resid = 0;
+    for (uint i = 0; i < win_count; i++) {
+        double x = (double)(window[i].at - last->at);
+        double e = (double)(window[i].offset - last->offset) - (a + b * x);
+        resid += e < 0 ? -e : e;
+    }
+
+    time_model_t m = {
+        .ref = last->at,
+        .off = last->offset + (int64_t)a,
+        .rate = (int32_t)(b * 4294967296.0),
+    };
+    uint32_t save = save_and_disable_interrupts();
+    model = m;
+    synced = true;
+    restore_interrupts(save);
+
+    int64_t rtt = best_rtt();
+    status.residual_ns = (uint32_t)(resid / n);
+    status.rtt_ns = rtt > 0 ? (uint32_t)rtt : 0;       // Rounding can take it below 0
+}
+
+static void window_reset(void) {
+    win_count = 0;
+    win_next = 0;
+    slow_streak = 0;
+    step_streak = 0;
+}
+
+static void take_sample(const time_sample_t *s) {
+    time_point_t p = {
+        .at = s->t1 + (s->t4 - s->t1) / 2,
+        .offset = ((s->t2 - s->t1) + (s->t3 - s->t4)) / 2,
+        .rtt = (s->t4 - s->t1) - (s->t3 - s->t2),
+    };
+
+    if (synced && win_count) {
+        // Far from the model several times running: the parent's clock jumped
+        int64_t miss = p.offset - (model_apply(&model, p.at) - p.at);
+        if (miss > MESH_TIME_STEP_NS || miss < -MESH_TIME_STEP_NS) {
+            if (++step_streak < 4) {
+                status.rejected++;
+                return;
+            }
+            window_reset();
+            status.steps++;
+        }
+
+        // Queued behind other traffic somewhere. If that is all we see
+        // for a whole window, the path itself is slower now: start over.
+        if (win_count && p.rtt > best_rtt() + MESH_TIME_RTT_SLACK_NS) {
+            if (++slow_streak < MESH_TIME_WINDOW) {
+                status.rejected++;
+                return;
+            }
+            window_reset();
+        }
+    } else if (!synced) {
+        status.steps++;
+    }
+
+    slow_streak = 0;
+    step_streak = 0;
+    window[win_next] = p;
+    win_next = (win_next + 1) % MESH_TIME_WINDOW;
+    if (win_count < MESH_TIME_WINDOW) win_count++;
+    status.samples++;
+    fit();
+}
+
+// ============================================================================
+// Exchange
+// ============================================================================
+
+static void send_request(mesh_port_t parent) {
+    if (req_pending) status.lost++;
+    req_pending = false;
+
+    pio_spi_packet_t *pkt = mesh_alloc();
+    if (!pkt) return;
+
+    time_msg_t *msg = (time_msg_t *)pkt->payload;
+    memset(msg, 0, sizeof(*msg));
+    msg->op = TIME_REQ;
+    msg->seq = ++req_seq;
+    mesh_set_header(pkt, MESH_ADDR_BROADCAST, MESH_TYPE_TIME, sizeof(*msg));
+    req_pending = mesh_port_send(parent, pkt);
+}
+
+void PIO_SPI_DMA_HOT(mesh_time_tx)(mesh_port_t port, pio_spi_packet_t *pkt) {
+    time_msg_t *msg = (time_msg_t *)pkt->payload;
+
+    // The far end stamps once the header is in: count its wire time here
+    int64_t t = mesh_time_local() + hdr_ns[port];
+    if (msg->op == TIME_REQ) {
+        msg->t1 = t;
+    } else {
+        msg->t3 = model_apply(&model, t);
+    }
+}
+
+void PIO_SPI_DMA_HOT(mesh_time_receive)(mesh_port_t port, pio_spi_packet_t *pkt) {
+    time_msg_t *msg = (time_msg_t *)pkt->payload;
+    if (pkt->hdr.len < sizeof(*msg)) {
+        mesh_free(pkt);
+        return;
+    }
+    int64_t arrival = stamp_local(pio_spi_packet_rx_stamp(pkt));
+
+    if (msg->op == TIME_REQ) {
+        // Nothing to give a child until this node has the time itself.
+        // The answer goes back in the same buffer.
+        if (!synced) {
+            mesh_free(pkt);
+            return;
+        }
+        msg->op = TIME_RESP;
+        msg->t2 = model_apply(&model, arrival);
+        mesh_set_header(pkt, MESH_ADDR_BROADCAST, MESH_TYPE_TIME, sizeof(*msg));
+        mesh_port_send(port, pkt);
+        return;
+    }
+
+    if (req_pending && msg->seq == req_seq && port == mesh_tree_parent() &&
+        sample_head - sample_tail < SAMPLE_DEPTH) {
+        time_sample_t *s = &samples[sample_head & (SAMPLE_DEPTH - 1)];
+        s->t1 = msg->t1;
+        s->t2 = msg->t2;
+        s->t3 = msg->t3;
+        s->t4 = arrival;
+        sample_head++;
+        req_pending = false;
+    }
+    mesh_free(pkt);
+}
+
+// ============================================================================
+// Mesh Hooks
+// ============================================================================
+
+void mesh_time_init(void) {
+    memset(&model, 0, sizeof(model));
+    memset(&status, 0, sizeof(status));
+    memset(hdr_ns, 0, sizeof(hdr_ns));
+    synced = false;
+    sample_head = sample_tail = 0;
+    req_pending = false;
+    window_reset();
+    next_req = get_absolute_time();
+}
+
+void mesh_time_poll(void) {
+    while (sample_tail != sample_head) {
+        time_sample_t s = samples[sample_tail & (SAMPLE_DEPTH - 1)];
+        sample_tail++;
+        take_sample(&s);
+    }
+
+    if (absolute_time_diff_us(next_req, get_absolute_time()) < 0) return;
+    next_req = make_timeout_time_ms(MESH_TIME_INTERVAL_MS);
+
+    // Rates change with training; responses need them as much as requests
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        float freq = mesh_port_stats((mesh_port_t)p)->freq_hz;
+        hdr_ns[p] = freq > 0 ? (uint32_t)(HDR_BITS * 1e9f / freq) : 0;
+    }
+
+    if (mesh_addr() == MESH_ADDR_NONE) return;
+
+    // The root's clock is the mesh clock
+    mesh_port_t parent = mesh_tree_parent();
+    if (parent == MESH_PORT_LOCAL) {
+        synced = true;
+        return;
+    }
+    if (mesh_port_up(parent)) {
+        send_request(parent);
+    }
+}
+
+void mesh_time_get_status(mesh_time_status_t *out) {
+    *out = status;
+    out->synced = synced;
+    out->parent = mesh_addr() == MESH_ADDR_NONE ? MESH_PORT_LOCAL : mesh_tree_parent();
+
+    int64_t local = mesh_time_local();
+    out->offset_ns = mesh_time_from_local(local) - local;
+    out->drift_ppb = (int32_t)(((int64_t)model.rate * 1000000000) >> 32);
+}
+
+void mesh_time_print_status(void) {
+    static const char *names[] = { "N", "E", "S", "W", "-" };
+    mesh_time_status_t s;
+    mesh_time_get_status(&s);
+
+    printf("Time: %s from %s  offset %lld ns  drift %ld ppb  rtt %lu ns  residual %lu ns\n",
+           s.synced ? "synced" : "not synced", names[s.parent], (long long)s.offset_ns,
+           (long)s.drift_ppb, s.rtt_ns, s.residual_ns);
+    printf("      samples %lu  rejected %lu  lost %lu  steps %lu\n",
+           s.samples, s.rejected, s.lost, s.steps);
+}
@@ -0,0 +1,143 @@
+/**
+ * Machine-wide clock: every node's timer synced to the root's
+ *
+ * Each node keeps its own free-running 1 MHz timer and a model of how
+ * the root's clock ("mesh time", in ns) relates to it: an offset plus a
+ * rate. The model comes from PTP-style exchanges with the node's parent
+ * on the collective spanning tree (mesh_collective.h), every
+ * MESH_TIME_INTERVAL_MS:
+ *
+ *   child                          parent
+ *   t1  --- REQ ------------------>  t2      t1, t4: child's timer
+ *   t4  <-- RESP {t1, t2, t3} -----  t3      t2, t3: parent's mesh time
+ *
+ *   offset = ((t2 - t1) + (t3 - t4)) / 2
+ *   round trip = (t4 - t1) - (t3 - t2)
+ *
+ * The parent answers in mesh time, so the sync runs down the tree and
+ * every node ends up on the root's clock. Both ends take their stamps at
+ * the same point of a frame: arrival is stamped by a DMA channel chained
+ * from the RX header transfer (pio_spi_dma_rx_set_timestamps()), with no
+ * interrupt latency in it, and departure is taken as the frame is handed
+ * to the idle link, plus the header's time on the wire at that port's
+ * own bit rate. What is left of the fixed delays is the same in both
+ * directions and drops out of the offset.
+ *
+ * Each stamp is whole microseconds, but successive exchanges fall at
+ * unrelated phases of the two timers, so a least-squares fit of offset
+ * against time over the last MESH_TIME_WINDOW exchanges averages the
+ * rounding out and gives the rate (drift) as its slope: the model is
+ * good to well under a microsecond once the window has filled, and
+ * keeps running on the fitted rate if the parent goes quiet. Exchanges
+ * whose round trip was slowed by other traffic are left out.
+ *
+ * Uses (all mesh time, ns):
+ *   - Put mesh_time_now() in a payload and compare it with
+ *     mesh_time_rx() at the far end: one-way latency across any number
+ *     of hops.
+ *   - Agree on a start time and period once, then mesh_time_wait_until()
+ *     each step: lockstep phases without a barrier every step.
+ *
+ * Same rules as mesh.h: call from the core running the mesh.
+ */
+
+#ifndef MESH_TIME_H
+#define MESH_TIME_H
+
+#include "mesh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Exchanges with the parent this often */
+#ifndef MESH_TIME_INTERVAL_MS
+#define MESH_TIME_INTERVAL_MS 50
+#endif
+
+/** Exchanges in the fit */
+#ifndef MESH_TIME_WINDOW
+#define MESH_TIME_WINDOW 32
+#endif
+
+/** Exchanges whose round trip is this much over the best in the window are left out */
+#ifndef MESH_TIME_RTT_SLACK_NS
+#define MESH_TIME_RTT_SLACK_NS 2000
+#endif
+
+/** An offset this far off the model is a step (parent restarted): re-sync from scratch */
+#ifndef MESH_TIME_STEP_NS
+#define MESH_TIME_STEP_NS 100000
+#endif
+
+typedef struct {
+    bool synced;                // Model in use (always on the root)
+    mesh_port_t parent;         // Port synced from (MESH_PORT_LOCAL on the root)
+    int64_t offset_ns;          // Mesh time minus local time, now
+    int32_t drift_ppb;          // Mesh clock rate against the local one, - 1 (ppb)
+    uint32_t rtt_ns;            // Best round trip in the window
+    uint32_t residual_ns;       // Mean distance of the window's exchanges from the fit
+    uint32_t samples;           // Exchanges taken into the model
+    uint32_t rejected;          // ... left out for a slow round trip or an outlying offset
+    uint32_t lost;              // Requests with no response in time
+    uint32_t steps;             // Re-syncs from scratch
+} mesh_time_status_t;
+
+/** Local timer in ns (time_us_64() * 1000) */
+int64_t mesh_time_local(void);
+
+/** Current mesh time in ns */
+int64_t mesh_time_now(void);
+
+/** Mesh time of a local time (ns) */
+int64_t mesh_time_from_local(int64_t local_ns);
+
+/** Local time (ns) of a mesh time */
+int64_t mesh_time_to_local(int64_t mesh_ns);
+
+/**
+ * Mesh time when a received packet's header landed here
+ *
+ * For packets from mesh_recv() (pio_spi_packet_rx_stamp()), read before
+ * the buffer is sent on; at most ~71 minutes old.
+ */
+int64_t mesh_time_rx(const pio_spi_packet_t *pkt);
+
+/** Whether this node's model is in use (mesh_time_now() means the root's clock) */
+bool mesh_time_synced(void);
+
+/**
+ * Spin until mesh time t (ns)
+ *
+ * Interrupts keep running meanwhile; the model is not updated until the
+ * next mesh_poll().
+ */
+void mesh_time_wait_until(int64_t t);
+
+/** Snapshot of the model and its counters */
+void mesh_time_get_status(mesh_time_status_t *status);
+
+/** Print the model and counters */
+void mesh_time_print_status(void);
+
+// ============================================================================
+// Mesh Hooks
+// ============================================================================
+
+/** Reset the model (called by mesh_init) */
+void mesh_time_init(void);
+
+/** Send the next request and take in responses (called by mesh_poll) */
+void mesh_time_poll(void);
+
+/** Handle a MESH_TYPE_TIME packet from a link (IRQ context, consumes pkt) */
+void mesh_time_receive(mesh_port_t port, pio_spi_packet_t *pkt);
+
+/** Stamp a MESH_TYPE_TIME packet as the idle link takes it (IRQs disabled) */
+void mesh_time_tx(mesh_port_t port, pio_spi_packet_t *pkt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_TIME_H
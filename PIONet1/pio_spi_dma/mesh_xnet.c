@@ -0,0 +1,194 @@
+/**
+ * Neighbour exchange over all four links at once (MasPar xnet style)
+ */
+
+#include "mesh_xnet.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
+#include <string.h>
+
+// Early arrivals per port: the link window bounds them
+#define HELD_DEPTH MESH_LINK_WINDOW
+
+typedef struct {
+    uint16_t seq;
+    uint16_t len;
+    uint8_t data[];
+} xnet_msg_t;
+
+static mesh_xnet_t *posted[MESH_PORTS][MESH_XNET_INFLIGHT];
+static pio_spi_packet_t *held[MESH_PORTS][HELD_DEPTH];
+static uint8_t held_count[MESH_PORTS];
+static uint16_t next_seq;
+
+// ============================================================================
+// Receive (IRQs disabled)
+// ============================================================================
+
+static void PIO_SPI_DMA_HOT(land)(mesh_xnet_t *x, mesh_port_t p, const xnet_msg_t *msg) {
+    size_t n = msg->len;
+    if (n != x->len) {
+        x->mismatch |= (uint8_t)(1u << p);
+        if (n > x->len) n = x->len;
+    }
+    memcpy(x->rx[p], msg->data, n);
+    x->pending &= (uint8_t)~(1u << p);
+    if (posted[p][x->seq % MESH_XNET_INFLIGHT] == x) {
+        posted[p][x->seq % MESH_XNET_INFLIGHT] = NULL;
+    }
+}
+
+// Take a held packet out of port p's list
+static pio_spi_packet_t *unhold(mesh_port_t p, uint i) {
+    pio_spi_packet_t *pkt = held[p][i];
+    held_count[p]--;
+    memmove(&held[p][i], &held[p][i + 1], (held_count[p] - i) * sizeof(held[p][0]));
+    return pkt;
+}
+
+void PIO_SPI_DMA_HOT(mesh_xnet_receive)(mesh_port_t port, pio_spi_packet_t *pkt) {
+    const xnet_msg_t *msg = (const xnet_msg_t *)pkt->payload;
+    mesh_xnet_t *x = posted[port][msg->seq % MESH_XNET_INFLIGHT];
+
+    if (x && x->seq == msg->seq && (x->pending & (1u << port))) {
+        land(x, port, msg);
+        mesh_free(pkt);
+        return;
+    }
+
+    // Neighbour is ahead: keep it for its exchange. Full means something
+    // stale is in there (a cancelled exchange), so the oldest goes.
+    if (held_count[port] == HELD_DEPTH) {
+        mesh_free(unhold(port, 0));
+    }
+    held[port][held_count[port]++] = pkt;
+}
+
+// ============================================================================
+// Exchange
+// ============================================================================
+
+bool mesh_xnet_start(mesh_xnet_t *x, const void *const tx[MESH_PORTS],
+                     void *const rx[MESH_PORTS], size_t len) {
+    if (len > MESH_XNET_MAX_LEN) return false;
+
+    uint16_t seq = next_seq;
+    uint slot = seq % MESH_XNET_INFLIGHT;
+    pio_spi_packet_t *out[MESH_PORTS] = { NULL };
+
+    // Every buffer and slot up front: all directions go, or none
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        bool fail = rx[p] && posted[p][slot];
+        if (!fail && tx[p] && mesh_port_up((mesh_port_t)p)) {
+            fail = mesh_port_queue_free((mesh_port_t)p) == 0 || !(out[p] = mesh_alloc());
+        }
+        if (fail) {
+            for (uint q = 0; q < MESH_PORTS; q++) {
+                if (out[q]) mesh_free(out[q]);
+            }
+            return false;
+        }
+    }
+    next_seq++;
+
+    x->seq = seq;
+    x->len = len;
+    x->ports = 0;
+    x->mismatch = 0;
+    uint8_t pending = 0;
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        x->rx[p] = rx[p];
+        if (!rx[p]) continue;
+        x->ports |= (uint8_t)(1u << p);
+        if (mesh_port_up((mesh_port_t)p)) {
+            pending |= (uint8_t)(1u << p);
+        } else {
+            memset(rx[p], 0, len);      // Edge of the array
+        }
+    }
+    x->pending = pending;
+
+    // Copy the sends now, so the caller's buffers are free on return
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        if (!out[p]) continue;
+        xnet_msg_t *msg = (xnet_msg_t *)out[p]->payload;
+        msg->seq = seq;
+        msg->len = (uint16_t)len;
+        memcpy(msg->data, tx[p], len);
+        mesh_set_header(out[p], MESH_ADDR_BROADCAST, MESH_TYPE_SHIFT, sizeof(*msg) + len);
+    }
+
+    // Post the receives and take anything that came early. Earlier
+    // numbers still held belong to cancelled exchanges.
+    uint32_t save = save_and_disable_interrupts();
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        if (!(pending & (1u << p))) continue;
+        posted[p][slot] = x;
+        for (uint i = 0; i < held_count[p] && (x->pending & (1u << p)); ) {
+            const xnet_msg_t *msg = (const xnet_msg_t *)held[p][i]->payload;
+            if (msg->seq == seq) {
+                land(x, (mesh_port_t)p, msg);
+                mesh_free(unhold((mesh_port_t)p, i));
+            } else if ((int16_t)(msg->seq - seq) < 0) {
+                mesh_free(unhold((mesh_port_t)p, i));
+            } else {
+                i++;
+            }
+        }
+    }
+    restore_interrupts(save);
+
+    // All sends onto their links back to back: the four wires run together
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        if (out[p]) mesh_port_send((mesh_port_t)p, out[p]);
+    }
+    return true;
+}
+
+void mesh_xnet_cancel(mesh_xnet_t *x) {
+    uint32_t save = save_and_disable_interrupts();
+    for (uint p = 0; p < MESH_PORTS; p++) {
+        if (!(x->pending & (1u << p))) continue;
+        if (posted[p][x->seq % MESH_XNET_INFLIGHT] == x) {
+            posted[p][x->seq % MESH_XNET_INFLIGHT] = NULL;
+        }
+        memset(x->rx[p], 0, x->len);
+    }
+    x->pending = 0;
+    restore_interrupts(save);
+}
+
+bool mesh_xnet_wait(mesh_xnet_t *x, uint32_t timeout_ms) {
+    absolute_time_t deadline = make_timeout_time_ms(timeout_ms);
+    while (!mesh_xnet_done(x)) {
+        if (time_reached(deadline)) {
+            mesh_xnet_cancel(x);
+            return false;
+        }
+        tight_loop_contents();
+    }
+    return x->mismatch == 0;
+}
+
+bool mesh_xnet_shift(const void *const tx[MESH_PORTS], void *const rx[MESH_PORTS],
+                     size_t len, uint32_t timeout_ms) {
+    mesh_xnet_t x;
+    absolute_time_t deadline = make_timeout_time_ms(timeout_ms);
+
+    while (!mesh_xnet_start(&x, tx, rx, len)) {
+        if (time_reached(deadline)) return false;
+        tight_loop_contents();
+    }
+    int64_t left_us = absolute_time_diff_us(get_absolute_time(), deadline);
+    return mesh_xnet_wait(&x, left_us > 0 ? (uint32_t)(left_us / 1000) : 0);
+}
+
+// ============================================================================
+// Mesh Hooks
+// ============================================================================
+
+void mesh_xnet_init(void) {
+    memset(posted, 0, sizeof(posted));
+    memset(held_count, 0, sizeof(held_count));
+    next_seq = 0;
+}
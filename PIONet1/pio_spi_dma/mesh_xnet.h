@@ -0,0 +1,102 @@
+/**
+ * Neighbour exchange over all four links at once (MasPar xnet style)
+ *
+ * One call posts the receives on every requested port and puts every
+ * send on its link back to back, so the four links run in parallel and
+ * a shift step costs one link time rather than four:
+ *
+ *   mesh_xnet_t x;
+ *   const void *tx[MESH_PORTS] = { [MESH_PORT_E] = east_edge };
+ *   void *rx[MESH_PORTS] = { [MESH_PORT_W] = west_halo };
+ *   mesh_xnet_start(&x, tx, rx, sizeof(east_edge));   // Rotate east
+ *   ... compute the interior ...
+ *   mesh_xnet_wait(&x, timeout_ms);
+ *
+ * Send data is copied at start, so its buffer is free again on return.
+ * Incoming data lands straight in rx from the link IRQ. Up to
+ * MESH_XNET_INFLIGHT exchanges can be outstanding, so the next step's
+ * halo can stream into one buffer set while the current step's compute
+ * reads the other (double buffering).
+ *
+ * Exchanges are numbered by a per-node counter, so every node must start
+ * the same exchanges in the same order (lockstep SPMD, as with the
+ * reductions in mesh_collective.h). Data that arrives before its
+ * exchange is posted waits in its pool buffer, holding the neighbour's
+ * link credit: a node that runs ahead is throttled by the link.
+ * A port with no link is the edge of the array; its rx is zero-filled.
+ */
+
+#ifndef MESH_XNET_H
+#define MESH_XNET_H
+
+#include "mesh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Exchanges outstanding at once (double buffering) */
+#ifndef MESH_XNET_INFLIGHT
+#define MESH_XNET_INFLIGHT 2
+#endif
+
+/** Largest exchange per direction in bytes */
+#define MESH_XNET_MAX_LEN (PIO_SPI_PACKET_MAX_PAYLOAD - 4)
+
+typedef struct {
+    uint16_t seq;               // Exchange number (same on every node)
+    uint8_t ports;              // Bit p: receiving from port p
+    volatile uint8_t pending;   // Bit p: still waiting for port p
+    volatile uint8_t mismatch;  // Bit p: port p sent a different length
+    size_t len;
+    void *rx[MESH_PORTS];
+} mesh_xnet_t;
+
+/**
+ * Start an exchange
+ *
+ * @param x     Exchange state (valid until done)
+ * @param tx    Per port: data to send, or NULL
+ * @param rx    Per port: where the neighbour's data lands, or NULL
+ * @param len   Bytes per direction (<= MESH_XNET_MAX_LEN)
+ * @return      false if a buffer, queue slot or receive slot was not free
+ *              right now (nothing was sent: retry; no number was used)
+ */
+bool mesh_xnet_start(mesh_xnet_t *x, const void *const tx[MESH_PORTS],
+                     void *const rx[MESH_PORTS], size_t len);
+
+/** Whether every receive of an exchange has landed */
+static inline bool mesh_xnet_done(const mesh_xnet_t *x) {
+    return x->pending == 0;
+}
+
+/**
+ * Wait for an exchange
+ *
+ * @return      false on timeout or a length mismatch (the receives still
+ *              pending are cancelled and their rx zero-filled)
+ */
+bool mesh_xnet_wait(mesh_xnet_t *x, uint32_t timeout_ms);
+
+/** Stop waiting for an exchange's outstanding receives (rx zero-filled) */
+void mesh_xnet_cancel(mesh_xnet_t *x);
+
+/** Start and wait (retries the start until the timeout) */
+bool mesh_xnet_shift(const void *const tx[MESH_PORTS], void *const rx[MESH_PORTS],
+                     size_t len, uint32_t timeout_ms);
+
+// ============================================================================
+// Mesh Hooks
+// ============================================================================
+
+/** Reset exchange state (called by mesh_init) */
+void mesh_xnet_init(void);
+
+/** Handle a MESH_TYPE_SHIFT packet from a link (IRQ context, consumes pkt) */
+void mesh_xnet_receive(mesh_port_t port, pio_spi_packet_t *pkt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_XNET_H
@@ -18,6 +18,11 @@
  *   GND ──────────────────────── GND
  * 
  * Total: 6 signal wires + 1 ground = 7 wires
+ * 
+ * Optional barrier sync line (pio_barrier.h), shared by ALL boards:
+ * 
+ *   GPIO 14 (BARRIER) ──┬── GPIO 14 (BARRIER) ── ... every other board
+ *                       └── 4.7k pull-up to 3V3 (recommended)
  */
 
 #ifndef PIN_CONFIG_H
@@ -34,6 +39,9 @@
 #define RX_CLK_PIN    11      // Base + 1 (automatic)
 #define RX_DATA_PIN   12      // Base + 2 (automatic)
 
+// Barrier sync line (open drain, wired-AND across all boards)
+#define BARRIER_PIN   14
+
 // Communication settings
 #define SPI_FREQ_HZ   10000000  // 10 MHz
 
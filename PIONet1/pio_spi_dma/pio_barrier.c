@@ -0,0 +1,56 @@
+/**
+ * Hardware-assisted global barrier on a shared wired-AND sync line
+ */
+
+#include "pio_barrier.h"
+#include "pio_barrier.pio.h"
+#include "pio_spi_dma.h"
+
+bool pio_barrier_init(pio_barrier_t *b, PIO pio, uint sm, uint pin, uint hold_ns) {
+    b->pio = pio;
+    b->sm = sm;
+    b->pin = pin;
+    b->arrived = false;
+    
+    if (!pio_can_add_program(pio, &pio_barrier_program)) {
+        return false;
+    }
+    b->pio_offset = pio_add_program(pio, &pio_barrier_program);
+    
+    pio_barrier_program_init(pio, sm, b->pio_offset, pin, hold_ns);
+    return true;
+}
+
+void PIO_SPI_DMA_HOT(pio_barrier_arrive)(pio_barrier_t *b) {
+    // Drop any stale pass from a barrier nobody waited on
+    while (!pio_sm_is_rx_fifo_empty(b->pio, b->sm)) {
+        (void)pio_sm_get(b->pio, b->sm);
+    }
+    
+    pio_sm_put(b->pio, b->sm, 0);
+    b->arrived = true;
+}
+
+bool PIO_SPI_DMA_HOT(pio_barrier_passed)(pio_barrier_t *b) {
+    if (!b->arrived) return true;
+    
+    if (pio_sm_is_rx_fifo_empty(b->pio, b->sm)) {
+        return false;
+    }
+    (void)pio_sm_get(b->pio, b->sm);
+    b->arrived = false;
+    return true;
+}
+
+void PIO_SPI_DMA_HOT(pio_barrier_wait)(pio_barrier_t *b) {
+    while (!pio_barrier_passed(b)) {
+        tight_loop_contents();
+    }
+}
+
+void pio_barrier_deinit(pio_barrier_t *b) {
+    pio_sm_set_enabled(b->pio, b->sm, false);
+    pio_sm_set_consecutive_pindirs(b->pio, b->sm, b->pin, 1, false);
+    pio_remove_program(b->pio, &pio_barrier_program, b->pio_offset);
+    b->arrived = false;
+}
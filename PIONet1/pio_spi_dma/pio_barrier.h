@@ -0,0 +1,94 @@
+/**
+ * Hardware-assisted global barrier on a shared wired-AND sync line
+ * 
+ * All nodes connect one GPIO to a common open-drain line. Each node pulls
+ * it low while working and releases it on pio_barrier_arrive(); a PIO SM
+ * detects the line going high (every node arrived) and signals the CPU
+ * through its RX FIFO. Completion time is the line's rise time plus a
+ * couple of SM cycles, independent of node count or mesh diameter.
+ * 
+ * Costs one SM and 8 instruction slots. Usage:
+ * 
+ *   pio_barrier_t b;
+ *   pio_barrier_init(&b, pio2, 2, BARRIER_PIN, PIO_BARRIER_HOLD_NS);
+ *   ...
+ *   pio_barrier(&b);            // Every step
+ */
+
+#ifndef PIO_BARRIER_H
+#define PIO_BARRIER_H
+
+#include "hardware/pio.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default hold time after release (covers rise-time skew along the line) */
+#ifndef PIO_BARRIER_HOLD_NS
+#define PIO_BARRIER_HOLD_NS 1000
+#endif
+
+typedef struct {
+    PIO pio;
+    uint sm;
+    uint pio_offset;
+    uint pin;
+    bool arrived;               // Arrived and waiting for the rest
+} pio_barrier_t;
+
+/**
+ * Initialize the barrier (line held low until first arrive)
+ * 
+ * @param b         Barrier state
+ * @param pio       PIO instance
+ * @param sm        State machine index (0-3)
+ * @param pin       GPIO for the shared sync line
+ * @param hold_ns   Release hold time (PIO_BARRIER_HOLD_NS), also the least
+ *                  time the line is low between two passes
+ * @return          false if the program doesn't fit in this PIO
+ */
+bool pio_barrier_init(pio_barrier_t *b, PIO pio, uint sm, uint pin, uint hold_ns);
+
+/**
+ * Arrive at the barrier (non-blocking, releases the line)
+ */
+void pio_barrier_arrive(pio_barrier_t *b);
+
+/**
+ * Check whether the barrier arrived at has passed
+ */
+bool pio_barrier_passed(pio_barrier_t *b);
+
+/**
+ * Wait for the barrier arrived at to pass
+ */
+void pio_barrier_wait(pio_barrier_t *b);
+
+/**
+ * Arrive and wait
+ */
+static inline void pio_barrier(pio_barrier_t *b) {
+    pio_barrier_arrive(b);
+    pio_barrier_wait(b);
+}
+
+/**
+ * DREQ that fires when the barrier passes (to start a DMA-driven step)
+ */
+static inline uint pio_barrier_get_dreq(const pio_barrier_t *b) {
+    return pio_get_dreq(b->pio, b->sm, false);  // false = RX
+}
+
+/**
+ * Stop the SM, release the line and free the program
+ */
+void pio_barrier_deinit(pio_barrier_t *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIO_BARRIER_H
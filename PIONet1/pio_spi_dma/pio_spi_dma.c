@@ -0,0 +1,1305 @@
+/**
+ * PIO-based SPI-like TX/RX with DMA for RP2350
+ */
+
+#include "pio_spi_dma.h"
+#include "spi_tx_cs.pio.h"
+#include "spi_rx_cs.pio.h"
+#include "spi_rx_fast.pio.h"
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include <assert.h>
+#include <string.h>
+
+// ============================================================================
+// IRQ Handling (internal)
+// ============================================================================
+
+// Dispatch table indexed by DMA channel number, so an interrupt costs one
+// status read plus one lookup per completed channel regardless of how many
+// links exist. Instances bind on first start, since init returns them by value.
+typedef enum {
+    DISPATCH_NONE = 0,
+    DISPATCH_TX,
+    DISPATCH_RX,
+    DISPATCH_TXQ,
+    DISPATCH_FUNC
+} dispatch_kind_t;
+
+typedef struct {
+    uint8_t kind;               // dispatch_kind_t
+    uint8_t idx;                // TX queue: which of its two channels
+    void *obj;                  // Instance, queue, or callback user data
+    pio_spi_dma_callback_t func; // DISPATCH_FUNC: callback
+} dispatch_entry_t;
+
+static dispatch_entry_t dispatch[NUM_DMA_CHANNELS];
+
+static void tx_queue_irq(pio_spi_dma_tx_queue_t *q, uint idx);
+static void rx_poll_overflow(pio_spi_dma_rx_inst_t *inst);
+
+static inline void dispatch_bind(uint chan, dispatch_kind_t kind, uint idx, void *obj) {
+    dispatch[chan].kind = (uint8_t)kind;
+    dispatch[chan].idx = (uint8_t)idx;
+    dispatch[chan].obj = obj;
+}
+
+static inline void dispatch_unbind(uint chan) {
+    dispatch[chan].kind = DISPATCH_NONE;
+    dispatch[chan].obj = NULL;
+}
+
+static void PIO_SPI_DMA_HOT(dma_irq_dispatch)(uint irq_index) {
+    // Read and acknowledge every pending channel on this line at once
+    uint32_t status = irq_index ? dma_hw->ints1 : dma_hw->ints0;
+    if (irq_index) {
+        dma_hw->ints1 = status;
+    } else {
+        dma_hw->ints0 = status;
+    }
+    
+    while (status) {
+        uint chan = __builtin_ctz(status);
+        status &= status - 1;
+        
+        dispatch_entry_t *e = &dispatch[chan];
+        switch (e->kind) {
+        case DISPATCH_TX:
+            // Frame is all in the FIFO; complete once it is on the wire
+            pio_spi_dma_tx_drain(e->obj);
+            break;
+        case DISPATCH_RX: {
+            pio_spi_dma_rx_inst_t *inst = e->obj;
+            inst->busy = false;
+            inst->stats.bytes += inst->pending;
+            rx_poll_overflow(inst);
+            if (inst->callback) {
+                inst->callback(inst->callback_data);
+            }
+            break;
+        }
+        case DISPATCH_TXQ:
+            tx_queue_irq(e->obj, e->idx);
+            break;
+        case DISPATCH_FUNC:
+            e->func(e->obj);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void PIO_SPI_DMA_HOT(dma_irq0_handler)(void) {
+    dma_irq_dispatch(0);
+}
+
+static void PIO_SPI_DMA_HOT(dma_irq1_handler)(void) {
+    dma_irq_dispatch(1);
+}
+
+static bool irq_installed[2] = {false, false};
+
+static void ensure_irq_handler(uint irq_index) {
+    if (!irq_installed[irq_index]) {
+        irq_set_exclusive_handler(DMA_IRQ_0 + irq_index,
+                                  irq_index ? dma_irq1_handler : dma_irq0_handler);
+        irq_set_enabled(DMA_IRQ_0 + irq_index, true);
+        irq_installed[irq_index] = true;
+    }
+}
+
+// Route a channel's completion interrupt to DMA_IRQ_0 or DMA_IRQ_1
+static void channel_irq_route(uint chan, uint irq_index, bool enabled) {
+    dma_irqn_set_channel_enabled(irq_index ^ 1, chan, false);
+    if (enabled) {
+        ensure_irq_handler(irq_index);
+    }
+    dma_irqn_set_channel_enabled(irq_index, chan, enabled);
+}
+
+void pio_spi_dma_channel_set_irq_callback(uint chan, uint irq_index,
+                                          pio_spi_dma_callback_t callback,
+                                          void *user_data) {
+    if (callback) {
+        dispatch[chan].func = callback;
+        dispatch_bind(chan, DISPATCH_FUNC, 0, user_data);
+        channel_irq_route(chan, irq_index, true);
+    } else {
+        channel_irq_route(chan, irq_index, false);
+        dispatch_unbind(chan);
+    }
+}
+
+// ============================================================================
+// PIO SM Flags (internal)
+// ============================================================================
+
+// Every program raises IRQ flag (0 + SM) for the CPU: spi_rx_cs when CS
+// cuts a byte short, the TX programs when a frame ends with their FIFO
+// dry. One shared handler on PIO_SPI_DMA_PIO_IRQ of each block counts
+// the RX aborts (pio_spi_dma_rx_get_stats() folds them in) and completes
+// TX transfers that are waiting for their last bit to leave.
+static volatile uint32_t pio_aborts[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+static pio_spi_dma_tx_inst_t *pio_drain[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+static uint8_t pio_abort_mask[NUM_PIOS];    // RX SMs with abort flags enabled
+static uint8_t pio_drain_mask[NUM_PIOS];    // TX SMs waiting for the wire
+static bool pio_irq_installed[NUM_PIOS];
+
+static void tx_drained(pio_spi_dma_tx_inst_t *inst);
+
+static void PIO_SPI_DMA_HOT(pio_flag_irq_handler)(void) {
+    for (uint i = 0; i < NUM_PIOS; i++) {
+        uint32_t mask = pio_abort_mask[i] | pio_drain_mask[i];
+        if (!mask) continue;
+        PIO pio = pio_get_instance(i);
+        uint32_t flags = pio->irq & mask;
+        pio->irq = flags;                       // Write 1 to clear
+        while (flags) {
+            uint sm = __builtin_ctz(flags);
+            flags &= flags - 1;
+            if (pio_drain_mask[i] & (1u << sm)) {
+                tx_drained(pio_drain[i][sm]);
+            } else {
+                pio_aborts[i][sm]++;
+            }
+        }
+    }
+}
+
+static void pio_flag_enable(PIO pio, uint sm, bool enabled) {
+    uint i = pio_get_index(pio);
+    if (enabled && !pio_irq_installed[i]) {
+        uint irq = pio_get_irq_num(pio, PIO_SPI_DMA_PIO_IRQ);
+        irq_add_shared_handler(irq, pio_flag_irq_handler,
+                               PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(irq, true);
+        pio_irq_installed[i] = true;
+    }
+    pio_set_irqn_source_enabled(pio, PIO_SPI_DMA_PIO_IRQ, pis_interrupt0 + sm, enabled);
+}
+
+static void pio_abort_enable(PIO pio, uint sm, bool enabled) {
+    uint i = pio_get_index(pio);
+    pio_interrupt_clear(pio, sm);
+    pio_aborts[i][sm] = 0;
+    if (enabled) {
+        pio_abort_mask[i] |= (uint8_t)(1u << sm);
+    } else {
+        pio_abort_mask[i] &= (uint8_t)~(1u << sm);
+    }
+    pio_flag_enable(pio, sm, enabled);
+}
+
+// Transfer count for channels that run forever (RX ring, RX watchdog)
+static inline uint32_t ring_endless_count(void) {
+#if PICO_RP2040
+    return 0xffffffffu;                         // ~4G beats, effectively forever
+#else
+    return dma_encode_endless_transfer_count(); // RP2350 MODE=ENDLESS
+#endif
+}
+
+// ============================================================================
+// Program Sharing (internal)
+// ============================================================================
+
+// One copy of each program per PIO block, keyed by the lane count the
+// multi-lane variants are patched for. Every SM running it shares the
+// copy, so four links on a block cost one TX and one RX program instead
+// of four each, and later links skip the load entirely.
+typedef uint (*program_loader_t)(PIO pio, uint lanes);
+
+typedef struct {
+    PIO pio;                    // NULL if the slot is free
+    const pio_program_t *program;
+    uint8_t lanes;
+    uint8_t offset;
+    uint16_t refs;
+} program_slot_t;
+
+#define PROGRAM_SLOTS (NUM_PIOS * 8)
+
+static program_slot_t programs[PROGRAM_SLOTS];
+
+static uint load_spi_tx_cs(PIO pio, uint lanes) {
+    (void)lanes;
+    return pio_add_program(pio, &spi_tx_cs_program);
+}
+
+static uint load_spi_rx_cs(PIO pio, uint lanes) {
+    (void)lanes;
+    return pio_add_program(pio, &spi_rx_cs_program);
+}
+
+static uint load_spi_rx_fast_watchdog(PIO pio, uint lanes) {
+    (void)lanes;
+    return pio_add_program(pio, &spi_rx_fast_watchdog_program);
+}
+
+static uint program_acquire(PIO pio, const pio_program_t *program, uint lanes,
+                            program_loader_t load) {
+    program_slot_t *free_slot = NULL;
+    for (uint i = 0; i < PROGRAM_SLOTS; i++) {
+        program_slot_t *s = &programs[i];
+        if (s->pio == pio && s->program == program && s->lanes == lanes) {
+            s->refs++;
+            return s->offset;
+        }
+        if (!s->pio && !free_slot) {
+            free_slot = s;
+        }
+    }
+    
+    uint offset = load(pio, lanes);
+    if (free_slot) {
+        free_slot->pio = pio;
+        free_slot->program = program;
+        free_slot->lanes = (uint8_t)lanes;
+        free_slot->offset = (uint8_t)offset;
+        free_slot->refs = 1;
+    }
+    // Table full: this copy just isn't shared (release removes it)
+    return offset;
+}
+
+static void program_release(PIO pio, const pio_program_t *program, uint offset) {
+    for (uint i = 0; i < PROGRAM_SLOTS; i++) {
+        program_slot_t *s = &programs[i];
+        if (s->pio == pio && s->program == program && s->offset == offset) {
+            if (--s->refs) return;
+            s->pio = NULL;
+            break;
+        }
+    }
+    pio_remove_program(pio, program, offset);
+}
+
+// ============================================================================
+// TX Implementation
+// ============================================================================
+
+static dma_channel_config tx_dma_config(const pio_spi_dma_tx_inst_t *inst, uint dma_chan) {
+    dma_channel_config c = dma_channel_get_default_config(dma_chan);
+    
+    // Transfer 8 or 32 bits at a time
+    channel_config_set_transfer_data_size(&c, (enum dma_channel_transfer_size)inst->width);
+    
+    // Word transfers: swap bytes so memory byte 0 is first on the wire
+    channel_config_set_bswap(&c, inst->width == PIO_SPI_DMA_WIDTH_32);
+    
+    // Increment read address (source buffer), don't increment write (PIO FIFO)
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    
+    // Pace transfers based on PIO TX FIFO
+    channel_config_set_dreq(&c, pio_get_dreq(inst->pio, inst->sm, true));  // true = TX
+    
+    return c;
+}
+
+// Cache the bit-clock length for the busy-time counter
+static void tx_timing_update(pio_spi_dma_tx_inst_t *inst) {
+    uint32_t cycles_per_bit = (inst->program == &spi_tx_cs_fast_program) ? 6 : 12;
+    inst->clock_cycles = cycles_per_bit * pio_spi_dma_tx_get_clkdiv(inst);
+}
+
+// Count a frame as it is handed to the wire
+static inline void tx_count_frame(pio_spi_dma_tx_inst_t *inst, size_t frame_len) {
+    uint32_t clocks = (uint32_t)(frame_len * 8 / inst->lanes);
+    inst->stats.frames++;
+    inst->stats.bytes += (uint32_t)frame_len;
+    inst->stats.busy_cycles += (uint32_t)(((uint64_t)clocks * inst->clock_cycles) >> 8);
+}
+
+static void tx_dma_configure(pio_spi_dma_tx_inst_t *inst) {
+    dma_channel_config c = tx_dma_config(inst, inst->dma_chan);
+    
+    // Configure but don't start
+    dma_channel_configure(
+        inst->dma_chan,
+        &c,
+        &inst->pio->txf[inst->sm],  // Write to PIO TX FIFO
+        NULL,               // Read address set later
+        0,                  // Transfer count set later
+        false               // Don't start yet
+    );
+    
+    // Set up IRQ
+    channel_irq_route(inst->dma_chan, inst->irq_index, true);
+}
+
+static void tx_dma_setup(pio_spi_dma_tx_inst_t *inst) {
+    // Claim DMA channel
+    inst->dma_chan = dma_claim_unused_channel(true);
+    if (inst->dma_chan < 0) {
+        return;  // Failed
+    }
+    
+    tx_dma_configure(inst);
+}
+
+pio_spi_dma_tx_inst_t pio_spi_dma_tx_init(PIO pio, uint sm,
+                                           uint pin_clk, uint pin_data,
+                                           float freq_hz) {
+    pio_spi_dma_tx_inst_t inst = {
+        .pio = pio,
+        .sm = sm,
+        .pio_offset = 0,
+        .dma_chan = -1,
+        .framed = false,
+        .width = PIO_SPI_DMA_WIDTH_8,
+        .lanes = 1,
+        .irq_index = 0,
+        .busy = false,
+        .callback = NULL,
+        .callback_data = NULL
+    };
+    
+    // Load PIO program
+    inst.program = &spi_tx_cs_program;
+    inst.pio_offset = program_acquire(pio, &spi_tx_cs_program, 1, load_spi_tx_cs);
+    spi_tx_cs_program_init(pio, sm, inst.pio_offset, pin_clk, pin_data, freq_hz);
+    
+    tx_timing_update(&inst);
+    tx_dma_setup(&inst);
+    
+    return inst;
+}
+
+pio_spi_dma_tx_inst_t pio_spi_dma_tx_init_framed(PIO pio, uint sm,
+                                                  uint pin_clk, uint pin_data,
+                                                  float freq_hz,
+                                                  pio_spi_dma_width_t width, uint lanes) {
+    pio_spi_dma_tx_inst_t inst = {
+        .pio = pio,
+        .sm = sm,
+        .pio_offset = 0,
+        .dma_chan = -1,
+        .framed = true,
+        .width = width,
+        .lanes = lanes,
+        .irq_index = 0,
+        .busy = false,
+        .callback = NULL,
+        .callback_data = NULL
+    };
+    
+    // Load PIO program
+    inst.program = &spi_tx_cs_frame_program;
+    inst.pio_offset = program_acquire(pio, &spi_tx_cs_frame_program, lanes,
+                                      spi_tx_cs_frame_add_program);
+    spi_tx_cs_frame_program_init(pio, sm, inst.pio_offset, pin_clk, pin_data, freq_hz,
+                                 8u << width, lanes);
+    
+    tx_timing_update(&inst);
+    tx_dma_setup(&inst);
+    
+    return inst;
+}
+
+pio_spi_dma_tx_inst_t pio_spi_dma_tx_init_fast(PIO pio, uint sm,
+                                                uint pin_clk, uint pin_data,
+                                                float freq_hz,
+                                                pio_spi_dma_width_t width, uint lanes) {
+    pio_spi_dma_tx_inst_t inst = {
+        .pio = pio,
+        .sm = sm,
+        .pio_offset = 0,
+        .dma_chan = -1,
+        .framed = true,
+        .width = width,
+        .lanes = lanes,
+        .irq_index = 0,
+        .busy = false,
+        .callback = NULL,
+        .callback_data = NULL
+    };
+    
+    // Load PIO program (same packet format as framed, 6 cycles/bit)
+    inst.program = &spi_tx_cs_fast_program;
+    inst.pio_offset = program_acquire(pio, &spi_tx_cs_fast_program, lanes,
+                                      spi_tx_cs_fast_add_program);
+    spi_tx_cs_fast_program_init(pio, sm, inst.pio_offset, pin_clk, pin_data, freq_hz,
+                                8u << width, lanes);
+    
+    tx_timing_update(&inst);
+    tx_dma_setup(&inst);
+    
+    return inst;
+}
+
+void PIO_SPI_DMA_HOT(pio_spi_dma_tx_begin_frame)(pio_spi_dma_tx_inst_t *inst, size_t frame_len) {
+    tx_count_frame(inst, frame_len);
+    
+    // Framed mode: header word (clock count - 1) goes ahead of the payload,
+    // so CS stays low for the whole frame
+    if (inst->framed) {
+        pio_sm_put_blocking(inst->pio, inst->sm, (uint32_t)(frame_len * 8 / inst->lanes - 1));
+    }
+}
+
+void PIO_SPI_DMA_HOT(pio_spi_dma_tx_start_frame)(pio_spi_dma_tx_inst_t *inst,
+                                                 const uint8_t *data, size_t len,
+                                                 size_t frame_len) {
+    if (len == 0) return;
+    
+    pio_spi_dma_tx_begin_frame(inst, frame_len);
+    pio_spi_dma_tx_continue_frame(inst, data, len);
+}
+
+void PIO_SPI_DMA_HOT(pio_spi_dma_tx_continue_frame)(pio_spi_dma_tx_inst_t *inst,
+                                                    const uint8_t *data, size_t len) {
+    if (len == 0) return;
+    
+    dispatch_bind(inst->dma_chan, DISPATCH_TX, 0, inst);
+    inst->busy = true;
+    
+    // Set source and count (in DMA beats), then start
+    dma_channel_set_read_addr(inst->dma_chan, data, false);
+    dma_channel_set_trans_count(inst->dma_chan, len >> inst->width, true);  // true = start
+}
+
+void PIO_SPI_DMA_HOT(pio_spi_dma_tx_start)(pio_spi_dma_tx_inst_t *inst, const uint8_t *data, size_t len) {
+    pio_spi_dma_tx_start_frame(inst, data, len, len);
+}
+
+// Last frame finished before the flag was armed: SM parked at its first
+// instruction (PULL or the header OUT) with nothing left to take
+static inline bool tx_on_wire_idle(const pio_spi_dma_tx_inst_t *inst) {
+    return pio_sm_is_tx_fifo_empty(inst->pio, inst->sm) &&
+           pio_sm_get_pc(inst->pio, inst->sm) == inst->pio_offset;
+}
+
+static void PIO_SPI_DMA_HOT(tx_drained)(pio_spi_dma_tx_inst_t *inst) {
+    uint i = pio_get_index(inst->pio);
+    pio_drain_mask[i] &= (uint8_t)~(1u << inst->sm);
+    pio_flag_enable(inst->pio, inst->sm, false);
+    
+    inst->busy = false;
+    if (inst->callback) {
+        inst->callback(inst->callback_data);
+    }
+}
+
+void PIO_SPI_DMA_HOT(pio_spi_dma_tx_drain)(pio_spi_dma_tx_inst_t *inst) {
+    uint i = pio_get_index(inst->pio);
+    uint32_t save = save_and_disable_interrupts();
+    
+    // Flags so far are from FIFO underruns mid-transfer. Arm first, then
+    // look: a last frame ending in between leaves the flag pending.
+    pio_interrupt_clear(inst->pio, inst->sm);
+    pio_drain[i][inst->sm] = inst;
+    pio_drain_mask[i] |= (uint8_t)(1u << inst->sm);
+    pio_flag_enable(inst->pio, inst->sm, true);
+    
+    if (tx_on_wire_idle(inst)) {
+        pio_interrupt_clear(inst->pio, inst->sm);
+        tx_drained(inst);
+    }
+    restore_interrupts(save);
+}
+
+// Drop a pending drain without calling back
+static void tx_drain_cancel(pio_spi_dma_tx_inst_t *inst) {
+    uint i = pio_get_index(inst->pio);
+    uint32_t save = save_and_disable_interrupts();
+    if (pio_drain_mask[i] & (1u << inst->sm)) {
+        pio_drain_mask[i] &= (uint8_t)~(1u << inst->sm);
+        pio_flag_enable(inst->pio, inst->sm, false);
+    }
+    restore_interrupts(save);
+}
+
+void pio_spi_dma_tx_wait(pio_spi_dma_tx_inst_t *inst) {
+    // Cleared by the on-wire completion; sleep until an interrupt sets it
+    while (inst->busy) {
+        __wfe();
+    }
+}
+
+void pio_spi_dma_tx_blocking(pio_spi_dma_tx_inst_t *inst, const uint8_t *data, size_t len) {
+    pio_spi_dma_tx_start(inst, data, len);
+    pio_spi_dma_tx_wait(inst);
+}
+
+void pio_spi_dma_tx_set_callback(pio_spi_dma_tx_inst_t *inst,
+                                  pio_spi_dma_callback_t callback,
+                                  void *user_data) {
+    inst->callback = callback;
+    inst->callback_data = user_data;
+}
+
+void pio_spi_dma_tx_set_irq_index(pio_spi_dma_tx_inst_t *inst, uint irq_index) {
+    inst->irq_index = irq_index;
+    channel_irq_route(inst->dma_chan, irq_index, true);
+}
+
+void pio_spi_dma_tx_set_clkdiv(pio_spi_dma_tx_inst_t *inst, uint32_t div) {
+    pio_sm_set_clkdiv_int_frac(inst->pio, inst->sm, (uint16_t)(div >> 8), (uint8_t)div);
+    tx_timing_update(inst);
+}
+
+uint32_t pio_spi_dma_tx_get_clkdiv(const pio_spi_dma_tx_inst_t *inst) {
+    // CLKDIV holds INT in bits 31:16 and FRAC in 15:8
+    return inst->pio->sm[inst->sm].clkdiv >> PIO_SM0_CLKDIV_FRAC_LSB;
+}
+
+float pio_spi_dma_tx_get_freq(const pio_spi_dma_tx_inst_t *inst) {
+    return (float)clock_get_hz(clk_sys) * 256.0f / (float)inst->clock_cycles;
+}
+
+void pio_spi_dma_tx_get_stats(pio_spi_dma_tx_inst_t *inst, pio_spi_dma_stats_t *stats) {
+    uint32_t save = save_and_disable_interrupts();
+    uint32_t over = 1u << (PIO_FDEBUG_TXOVER_LSB + inst->sm);
+    if (inst->pio->fdebug & over) {
+        inst->pio->fdebug = over;               // Write 1 to clear
+        inst->stats.fifo_overflows++;
+    }
+    *stats = inst->stats;
+    restore_interrupts(save);
+}
+
+void pio_spi_dma_tx_abort(pio_spi_dma_tx_inst_t *inst) {
+    dma_channel_abort(inst->dma_chan);
+    tx_drain_cancel(inst);
+    inst->busy = false;
+}
+
+void pio_spi_dma_tx_set_dma_chan(pio_spi_dma_tx_inst_t *inst, uint chan) {
+    pio_spi_dma_tx_abort(inst);
+    channel_irq_route(inst->dma_chan, inst->irq_index, false);
+    dispatch_unbind(inst->dma_chan);
+    dma_channel_unclaim(inst->dma_chan);
+    
+    // Bound now rather than on first start: the instance is in place
+    inst->dma_chan = chan;
+    tx_dma_configure(inst);
+    dispatch_bind(chan, DISPATCH_TX, 0, inst);
+}
+
+void pio_spi_dma_tx_deinit(pio_spi_dma_tx_inst_t *inst) {
+    // Abort any ongoing transfer
+    pio_spi_dma_tx_abort(inst);
+    
+    // Disable IRQ for this channel
+    channel_irq_route(inst->dma_chan, inst->irq_index, false);
+    dispatch_unbind(inst->dma_chan);
+    
+    // Release DMA channel
+    dma_channel_unclaim(inst->dma_chan);
+    
+    // Disable PIO SM
+    pio_sm_set_enabled(inst->pio, inst->sm, false);
+    program_release(inst->pio, inst->program, inst->pio_offset);
+    
+    inst->dma_chan = -1;
+}
+
+// ============================================================================
+// TX Queue (chained DMA)
+// ============================================================================
+//
+// Two DMA channels take turns. While one streams a segment, the other is
+// loaded with the next one and the running channel's CHAIN_TO is pointed
+// at it, so the hand-over happens in hardware with no idle bit-times. The
+// completion IRQ of each channel frees its segment and reloads it.
+//
+// Framed links need a header word ahead of each payload; it is queued as
+// its own 32-bit segment whose data lives in the queue slot.
+//
+// When the last segment is in the FIFO the queue drains through the
+// instance (pio_spi_dma_tx_drain()), so it completes once the last bit
+// has left the pin, like a one-shot transfer.
+
+#define TXQ_MASK (PIO_SPI_DMA_TXQ_DEPTH - 1)
+
+static void PIO_SPI_DMA_HOT(txq_set_chain)(pio_spi_dma_tx_queue_t *q, uint idx, uint to_idx) {
+    channel_config_set_chain_to(&q->config[idx], q->dma_chan[to_idx]);
+    dma_channel_set_config(q->dma_chan[idx], &q->config[idx], false);
+}
+
+// Load queued segments into idle channels. Call with DMA IRQ masked.
+static void PIO_SPI_DMA_HOT(txq_kick)(pio_spi_dma_tx_queue_t *q) {
+    while (q->load != q->head) {
+        uint idx = q->next_chan;
+        if (q->loaded[idx]) {
+            break;  // Both channels in use
+        }
+        
+        pio_spi_dma_tx_seg_t *seg = &q->seg[q->load & TXQ_MASK];
+        uint chan = q->dma_chan[idx];
+        uint peer = idx ^ 1;
+        
+        // Per-segment width; header words are never byte swapped
+        dma_channel_config *c = &q->config[idx];
+        channel_config_set_transfer_data_size(c, (enum dma_channel_transfer_size)seg->size);
+        channel_config_set_bswap(c, seg->bswap);
+        channel_config_set_chain_to(c, chan);  // No chaining until a successor is loaded
+        dma_channel_set_config(chan, c, false);
+        dma_channel_set_read_addr(chan, seg->addr, false);
+        dma_channel_set_trans_count(chan, seg->count, false);
+        
+        q->loaded[idx] = true;
+        q->next_chan = peer;
+        q->load++;
+        
+        if (q->loaded[peer]) {
+            // Peer is streaming: hand over in hardware when it finishes
+            txq_set_chain(q, peer, idx);
+            
+            // Peer may have finished before the chain was set
+            if (!dma_channel_is_busy(q->dma_chan[peer]) &&
+                !dma_channel_is_busy(chan) &&
+                dma_channel_hw_addr(chan)->transfer_count == seg->count) {
+                dma_channel_start(chan);
+            }
+        } else {
+            dma_channel_start(chan);
+        }
+    }
+}
+
+static void PIO_SPI_DMA_HOT(tx_queue_irq)(pio_spi_dma_tx_queue_t *q, uint idx) {
+    // Channels complete in load order, so this is the oldest segment
+    q->loaded[idx] = false;
+    q->done++;
+    
+    txq_kick(q);
+    
+    if (q->done == q->head) {
+        pio_spi_dma_tx_drain(q->tx);
+    }
+}
+
+// Instance callback: everything queued so far is on the wire
+static void PIO_SPI_DMA_HOT(txq_drained)(void *user_data) {
+    pio_spi_dma_tx_queue_t *q = user_data;
+    
+    // More was submitted meanwhile; its last segment drains again
+    if (q->done != q->head) return;
+    
+    q->busy = false;
+    if (q->callback) {
+        q->callback(q->callback_data);
+    }
+}
+
+bool pio_spi_dma_tx_queue_init(pio_spi_dma_tx_queue_t *q, pio_spi_dma_tx_inst_t *tx) {
+    memset(q, 0, sizeof(*q));
+    q->tx = tx;
+    
+    // First channel is the instance's own, second is claimed here
+    int chan = dma_claim_unused_channel(false);
+    if (chan < 0) {
+        return false;
+    }
+    q->dma_chan[0] = tx->dma_chan;
+    q->dma_chan[1] = (uint)chan;
+    
+    for (uint idx = 0; idx < 2; idx++) {
+        q->config[idx] = tx_dma_config(tx, q->dma_chan[idx]);
+        dma_channel_configure(q->dma_chan[idx], &q->config[idx],
+                              &tx->pio->txf[tx->sm], NULL, 0, false);
+        channel_irq_route(q->dma_chan[idx], tx->irq_index, true);
+    }
+    
+    // The queue owns the instance's channel and completion from now on
+    for (uint idx = 0; idx < 2; idx++) {
+        dispatch_bind(q->dma_chan[idx], DISPATCH_TXQ, idx, q);
+    }
+    pio_spi_dma_tx_set_callback(tx, txq_drained, q);
+    
+    return true;
+}
+
+static void PIO_SPI_DMA_HOT(txq_push)(pio_spi_dma_tx_queue_t *q, const void *addr, uint32_t count,
+                     pio_spi_dma_width_t size, bool bswap) {
+    pio_spi_dma_tx_seg_t *seg = &q->seg[q->head & TXQ_MASK];
+    seg->addr = addr;
+    seg->count = count;
+    seg->size = (uint8_t)size;
+    seg->bswap = bswap;
+    q->head++;
+}
+
+bool PIO_SPI_DMA_HOT(pio_spi_dma_tx_queue_submit)(pio_spi_dma_tx_queue_t *q, const uint8_t *data, size_t len) {
+    if (len == 0) return true;
+    
+    pio_spi_dma_tx_inst_t *tx = q->tx;
+    uint32_t needed = tx->framed ? 2 : 1;
+    
+    uint32_t save = save_and_disable_interrupts();
+    
+    if (PIO_SPI_DMA_TXQ_DEPTH - (q->head - q->done) < needed) {
+        restore_interrupts(save);
+        return false;  // Queue full
+    }
+    
+    // Framed mode: header word (clock count - 1) as its own 32-bit segment
+    if (tx->framed) {
+        pio_spi_dma_tx_seg_t *seg = &q->seg[q->head & TXQ_MASK];
+        seg->header = (uint32_t)(len * 8 / tx->lanes - 1);
+        txq_push(q, &seg->header, 1, PIO_SPI_DMA_WIDTH_32, false);
+    }
+    txq_push(q, data, len >> tx->width, tx->width, tx->width == PIO_SPI_DMA_WIDTH_32);
+    tx_count_frame(tx, len);
+    
+    q->busy = true;
+    txq_kick(q);
+    
+    restore_interrupts(save);
+    return true;
+}
+
+void pio_spi_dma_tx_queue_wait(pio_spi_dma_tx_queue_t *q) {
+    // Cleared by the on-wire completion; sleep until an interrupt sets it
+    while (q->busy) {
+        __wfe();
+    }
+}
+
+void pio_spi_dma_tx_queue_set_callback(pio_spi_dma_tx_queue_t *q,
+                                        pio_spi_dma_callback_t callback,
+                                        void *user_data) {
+    q->callback = callback;
+    q->callback_data = user_data;
+}
+
+void pio_spi_dma_tx_queue_deinit(pio_spi_dma_tx_queue_t *q) {
+    dispatch_unbind(q->dma_chan[0]);
+    dispatch_unbind(q->dma_chan[1]);
+    
+    for (uint idx = 0; idx < 2; idx++) {
+        dma_channel_abort(q->dma_chan[idx]);
+    }
+    tx_drain_cancel(q->tx);
+    pio_spi_dma_tx_set_callback(q->tx, NULL, NULL);
+    q->tx->busy = false;
+    
+    // Hand the first channel back to the instance in one-shot configuration
+    dma_channel_config c = tx_dma_config(q->tx, q->dma_chan[0]);
+    dma_channel_configure(q->dma_chan[0], &c, &q->tx->pio->txf[q->tx->sm], NULL, 0, false);
+    
+    channel_irq_route(q->dma_chan[1], q->tx->irq_index, false);
+    dma_channel_unclaim(q->dma_chan[1]);
+    
+    q->busy = false;
+}
+
+// ============================================================================
+// Scatter-Gather TX (control-block chain)
+// ============================================================================
+//
+// The control channel copies one four-word block into the data channel's
+// READ_ADDR, WRITE_ADDR, TRANS_COUNT and CTRL_TRIG, which starts it. Every
+// segment but the last is IRQ-quiet and chains back to the control
+// channel for the next block. The last carries the caller's own CTRL, so
+// the frame ends exactly like a one-shot transfer: IRQ, or a chain into
+// whatever sends the rest of the frame.
+
+bool pio_spi_dma_tx_sg_init(pio_spi_dma_tx_sg_t *sg, pio_spi_dma_tx_inst_t *tx) {
+    memset(sg, 0, sizeof(*sg));
+    sg->tx = tx;
+    sg->data_config = tx_dma_config(tx, tx->dma_chan);
+    
+    sg->ctrl_chan = dma_claim_unused_channel(false);
+    if (sg->ctrl_chan < 0) {
+        return false;
+    }
+    
+    // Four words per trigger, writes wrapping on the 16-byte alias 0 group
+    dma_channel_config c = dma_channel_get_default_config(sg->ctrl_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, 4);   // true = write side
+    
+    dma_channel_configure(
+        sg->ctrl_chan,
+        &c,
+        &dma_hw->ch[tx->dma_chan].read_addr,
+        NULL,               // Block list set per frame
+        4,
+        false
+    );
+    return true;
+}
+
+bool PIO_SPI_DMA_HOT(pio_spi_dma_tx_sg_start_frame)(pio_spi_dma_tx_sg_t *sg,
+                                                    const pio_spi_dma_iovec_t *iov,
+                                                    uint count, size_t frame_len,
+                                                    const dma_channel_config *config) {
+    pio_spi_dma_tx_inst_t *inst = sg->tx;
+    dma_channel_config last = config ? *config : sg->data_config;
+    dma_channel_config mid = last;
+    channel_config_set_chain_to(&mid, (uint)sg->ctrl_chan);
+    channel_config_set_irq_quiet(&mid, true);
+    
+    uint32_t mid_ctrl = channel_config_get_ctrl_value(&mid);
+    uint n = 0;
+    for (uint i = 0; i < count; i++) {
+        if (iov[i].len == 0) continue;
+        if (n == PIO_SPI_DMA_SG_MAX_SEGS) return false;
+        
+        pio_spi_dma_ctrl_block_t *b = &sg->block[n++];
+        b->read_addr = iov[i].base;
+        b->write_addr = &inst->pio->txf[inst->sm];
+        b->trans_count = (uint32_t)(iov[i].len >> inst->width);
+        b->ctrl = mid_ctrl;
+    }
+    if (n == 0) return false;
+    sg->block[n - 1].ctrl = channel_config_get_ctrl_value(&last);
+    
+    dispatch_bind(inst->dma_chan, DISPATCH_TX, 0, inst);
+    inst->busy = true;
+    
+    pio_spi_dma_tx_begin_frame(inst, frame_len);
+    dma_channel_set_read_addr((uint)sg->ctrl_chan, sg->block, true);  // true = start
+    return true;
+}
+
+bool PIO_SPI_DMA_HOT(pio_spi_dma_tx_sg_start)(pio_spi_dma_tx_sg_t *sg,
+                                              const pio_spi_dma_iovec_t *iov, uint count) {
+    size_t len = 0;
+    for (uint i = 0; i < count; i++) {
+        len += iov[i].len;
+    }
+    return pio_spi_dma_tx_sg_start_frame(sg, iov, count, len, NULL);
+}
+
+void pio_spi_dma_tx_sg_deinit(pio_spi_dma_tx_sg_t *sg) {
+    if (sg->ctrl_chan < 0) return;
+    
+    dma_channel_abort((uint)sg->ctrl_chan);
+    dma_channel_abort(sg->tx->dma_chan);
+    dma_channel_set_config(sg->tx->dma_chan, &sg->data_config, false);
+    dma_channel_unclaim((uint)sg->ctrl_chan);
+    sg->ctrl_chan = -1;
+    tx_drain_cancel(sg->tx);
+    sg->tx->busy = false;
+}
+
+// ============================================================================
+// RX Implementation
+// ============================================================================
+
+static dma_channel_config rx_dma_config(const pio_spi_dma_rx_inst_t *inst) {
+    dma_channel_config c = dma_channel_get_default_config(inst->dma_chan);
+    
+    // Transfer 8 or 32 bits at a time
+    channel_config_set_transfer_data_size(&c, (enum dma_channel_transfer_size)inst->width);
+    
+    // Word transfers: swap bytes so memory byte 0 is first on the wire
+    channel_config_set_bswap(&c, inst->width == PIO_SPI_DMA_WIDTH_32);
+    
+    // Don't increment read (PIO FIFO), increment write (dest buffer)
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    
+    // Pace transfers based on PIO RX FIFO
+    channel_config_set_dreq(&c, pio_get_dreq(inst->pio, inst->sm, false));  // false = RX
+    
+    // Timestamp channel fires as each transfer completes
+    if (inst->stamp_chan >= 0) {
+        channel_config_set_chain_to(&c, (uint)inst->stamp_chan);
+    }
+    
+    return c;
+}
+
+static void rx_dma_configure(pio_spi_dma_rx_inst_t *inst) {
+    dma_channel_config c = rx_dma_config(inst);
+    
+    // Configure but don't start
+    dma_channel_configure(
+        inst->dma_chan,
+        &c,
+        NULL,                           // Write address set later
+        &inst->pio->rxf[inst->sm],      // Read from PIO RX FIFO
+        0,                              // Transfer count set later
+        false                           // Don't start yet
+    );
+    
+    // Set up IRQ
+    channel_irq_route(inst->dma_chan, inst->irq_index, true);
+}
+
+static void rx_dma_setup(pio_spi_dma_rx_inst_t *inst) {
+    // Claim DMA channel
+    inst->dma_chan = dma_claim_unused_channel(true);
+    if (inst->dma_chan < 0) {
+        return;  // Failed
+    }
+    
+    rx_dma_configure(inst);
+}
+
+pio_spi_dma_rx_inst_t pio_spi_dma_rx_init(PIO pio, uint sm, uint pin_cs) {
+    pio_spi_dma_rx_inst_t inst = {
+        .pio = pio,
+        .sm = sm,
+        .pio_offset = 0,
+        .dma_chan = -1,
+        .framed = false,
+        .width = PIO_SPI_DMA_WIDTH_8,
+        .lanes = 1,
+        .irq_index = 0,
+        .pin_cs = pin_cs,
+        .busy = false,
+        .callback = NULL,
+        .callback_data = NULL,
+        .ring = NULL,
+        .wd_dma_chan = -1,
+        .stamp_chan = -1
+    };
+    
+    // Load PIO program
+    inst.program = &spi_rx_cs_program;
+    inst.pio_offset = program_acquire(pio, &spi_rx_cs_program, 1, load_spi_rx_cs);
+    pio_abort_enable(pio, sm, true);
+    spi_rx_cs_program_init(pio, sm, inst.pio_offset, pin_cs);
+    
+    rx_dma_setup(&inst);
+    
+    return inst;
+}
+
+pio_spi_dma_rx_inst_t pio_spi_dma_rx_init_framed(PIO pio, uint sm, uint pin_cs,
+                                                  pio_spi_dma_width_t width, uint lanes) {
+    pio_spi_dma_rx_inst_t inst = {
+        .pio = pio,
+        .sm = sm,
+        .pio_offset = 0,
+        .dma_chan = -1,
+        .framed = true,
+        .width = width,
+        .lanes = lanes,
+        .irq_index = 0,
+        .pin_cs = pin_cs,
+        .busy = false,
+        .callback = NULL,
+        .callback_data = NULL,
+        .ring = NULL,
+        .wd_dma_chan = -1,
+        .stamp_chan = -1
+    };
+    
+    // Load PIO program (autopush threshold matches the DMA width)
+    inst.program = &spi_rx_cs_frame_program;
+    inst.pio_offset = program_acquire(pio, &spi_rx_cs_frame_program, lanes,
+                                      spi_rx_cs_frame_add_program);
+    spi_rx_cs_frame_program_init(pio, sm, inst.pio_offset, pin_cs, 8u << width, lanes);
+    
+    rx_dma_setup(&inst);
+    
+    return inst;
+}
+
+pio_spi_dma_rx_inst_t pio_spi_dma_rx_init_fast(PIO pio, uint sm, uint wd_sm, uint pin_cs,
+                                                pio_spi_dma_width_t width, uint lanes) {
+    pio_spi_dma_rx_inst_t inst = {
+        .pio = pio,
+        .sm = sm,
+        .pio_offset = 0,
+        .dma_chan = -1,
+        .framed = true,
+        .width = width,
+        .lanes = lanes,
+        .irq_index = 0,
+        .pin_cs = pin_cs,
+        .busy = false,
+        .callback = NULL,
+        .callback_data = NULL,
+        .ring = NULL,
+        .wd_sm = wd_sm,
+        .wd_dma_chan = -1,
+        .stamp_chan = -1
+    };
+    
+    // Load PIO programs: WAIT-based sampler plus CS watchdog
+    inst.program = &spi_rx_fast_program;
+    inst.pio_offset = program_acquire(pio, &spi_rx_fast_program, lanes, spi_rx_fast_add_program);
+    inst.wd_offset = program_acquire(pio, &spi_rx_fast_watchdog_program, 1,
+                                     load_spi_rx_fast_watchdog);
+    
+    // Forwarding channel: watchdog RX FIFO -> RX SM INSTR register.
+    // Claimed first so the SM never runs without its CS recovery.
+    int wd_chan = dma_claim_unused_channel(false);
+    if (wd_chan < 0) {
+        // Give the program slots back, or every retry would eat more
+        program_release(pio, &spi_rx_fast_watchdog_program, inst.wd_offset);
+        program_release(pio, &spi_rx_fast_program, inst.pio_offset);
+        return inst;  // Failed (dma_chan still -1)
+    }
+    inst.wd_dma_chan = wd_chan;
+    
+    dma_channel_config c = dma_channel_get_default_config(wd_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(pio, wd_sm, false));  // false = RX
+    dma_channel_configure(
+        wd_chan,
+        &c,
+        &pio->sm[sm].instr,             // Force instruction into RX SM
+        &pio->rxf[wd_sm],               // Read from watchdog RX FIFO
+        ring_endless_count(),           // Runs forever
+        true                            // Start now (idles until CS rises)
+    );
+    
+    spi_rx_fast_program_init(pio, sm, inst.pio_offset, pin_cs, 8u << width, lanes);
+    spi_rx_fast_watchdog_program_init(pio, wd_sm, inst.wd_offset, pin_cs, inst.pio_offset);
+    
+    rx_dma_setup(&inst);
+    
+    return inst;
+}
+
+void PIO_SPI_DMA_HOT(pio_spi_dma_rx_start)(pio_spi_dma_rx_inst_t *inst, uint8_t *data, size_t len) {
+    if (len == 0) return;
+    
+    dispatch_bind(inst->dma_chan, DISPATCH_RX, 0, inst);
+    inst->busy = true;
+    inst->pending = (uint32_t)len;
+    
+    // Set destination and count (in DMA beats), then start
+    dma_channel_set_write_addr(inst->dma_chan, data, false);
+    dma_channel_set_trans_count(inst->dma_chan, len >> inst->width, true);  // true = start
+}
+
+void pio_spi_dma_rx_wait(pio_spi_dma_rx_inst_t *inst) {
+    dma_channel_wait_for_finish_blocking(inst->dma_chan);
+    inst->busy = false;
+}
+
+void pio_spi_dma_rx_blocking(pio_spi_dma_rx_inst_t *inst, uint8_t *data, size_t len) {
+    pio_spi_dma_rx_start(inst, data, len);
+    pio_spi_dma_rx_wait(inst);
+}
+
+void pio_spi_dma_rx_set_callback(pio_spi_dma_rx_inst_t *inst,
+                                  pio_spi_dma_callback_t callback,
+                                  void *user_data) {
+    inst->callback = callback;
+    inst->callback_data = user_data;
+}
+
+void pio_spi_dma_rx_set_irq_index(pio_spi_dma_rx_inst_t *inst, uint irq_index) {
+    inst->irq_index = irq_index;
+    channel_irq_route(inst->dma_chan, irq_index, true);
+}
+
+void pio_spi_dma_rx_set_sample_phase(pio_spi_dma_rx_inst_t *inst,
+                                     pio_spi_dma_sample_phase_t phase) {
+    uint base = pio_get_gpio_base(inst->pio);
+    uint32_t clk = 1u << (inst->pin_cs + 1 - base);
+    uint32_t data = ((1u << inst->lanes) - 1) << (inst->pin_cs + 2 - base);
+    
+    hw_clear_bits(&inst->pio->input_sync_bypass, clk | data);
+    if (phase == PIO_SPI_DMA_SAMPLE_EARLY) {
+        hw_set_bits(&inst->pio->input_sync_bypass, clk);
+    } else if (phase == PIO_SPI_DMA_SAMPLE_LATE) {
+        hw_set_bits(&inst->pio->input_sync_bypass, data);
+    }
+}
+
+// FIFO full while the SM had bits to push: sticky in FDEBUG until cleared
+static void PIO_SPI_DMA_HOT(rx_poll_overflow)(pio_spi_dma_rx_inst_t *inst) {
+    uint32_t stall = 1u << (PIO_FDEBUG_RXSTALL_LSB + inst->sm);
+    if (inst->pio->fdebug & stall) {
+        inst->pio->fdebug = stall;              // Write 1 to clear
+        inst->stats.fifo_overflows++;
+    }
+}
+
+void pio_spi_dma_rx_get_stats(pio_spi_dma_rx_inst_t *inst, pio_spi_dma_stats_t *stats) {
+    uint32_t save = save_and_disable_interrupts();
+    rx_poll_overflow(inst);
+    *stats = inst->stats;
+    stats->aborted += pio_aborts[pio_get_index(inst->pio)][inst->sm];
+    restore_interrupts(save);
+}
+
+void pio_spi_dma_rx_abort(pio_spi_dma_rx_inst_t *inst) {
+    dma_channel_abort(inst->dma_chan);
+    inst->busy = false;
+}
+
+void pio_spi_dma_rx_set_dma_chan(pio_spi_dma_rx_inst_t *inst, uint chan) {
+    pio_spi_dma_rx_abort(inst);
+    channel_irq_route(inst->dma_chan, inst->irq_index, false);
+    dispatch_unbind(inst->dma_chan);
+    dma_channel_unclaim(inst->dma_chan);
+    
+    inst->dma_chan = chan;
+    rx_dma_configure(inst);
+    dispatch_bind(chan, DISPATCH_RX, 0, inst);
+}
+
+bool pio_spi_dma_rx_set_timestamps(pio_spi_dma_rx_inst_t *inst, bool enable) {
+    if (enable == (inst->stamp_chan >= 0)) return true;
+    
+    if (enable) {
+        int chan = dma_claim_unused_channel(false);
+        if (chan < 0) return false;
+        
+        // One word, timer -> stamp, unpaced; quiet (its IRQ is never routed)
+        dma_channel_config c = dma_channel_get_default_config((uint)chan);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, false);
+        dma_channel_configure((uint)chan, &c, &inst->stamp, &timer_hw->timerawl, 1, false);
+        inst->stamp_chan = chan;
+    } else {
+        dma_channel_abort((uint)inst->stamp_chan);
+        dma_channel_unclaim((uint)inst->stamp_chan);
+        inst->stamp_chan = -1;
+    }
+    
+    dma_channel_config c = rx_dma_config(inst);
+    dma_channel_set_config(inst->dma_chan, &c, false);
+    return true;
+}
+
+void pio_spi_dma_rx_flush(pio_spi_dma_rx_inst_t *inst) {
+    // Drain FIFO manually
+    while (!pio_sm_is_rx_fifo_empty(inst->pio, inst->sm)) {
+        (void)pio_sm_get(inst->pio, inst->sm);
+    }
+}
+
+// ============================================================================
+// RX Ring Buffer Mode
+// ============================================================================
+
+void pio_spi_dma_rx_ring_start(pio_spi_dma_rx_inst_t *inst, uint8_t *ring, uint ring_bits) {
+    assert(ring_bits >= 2 && ring_bits <= 15);
+    assert(((uintptr_t)ring & ((1u << ring_bits) - 1)) == 0);
+    
+    dma_channel_abort(inst->dma_chan);
+    
+    inst->ring = ring;
+    inst->ring_mask = (1u << ring_bits) - 1;
+    inst->ring_read = 0;
+    inst->busy = true;
+    
+    // Same channel setup as one-shot RX, plus write address wrap
+    dma_channel_config c = rx_dma_config(inst);
+    channel_config_set_ring(&c, true, ring_bits);  // true = wrap write address
+    
+    dma_channel_configure(
+        inst->dma_chan,
+        &c,
+        ring,                           // Write into ring
+        &inst->pio->rxf[inst->sm],      // Read from PIO RX FIFO
+        ring_endless_count(),           // Never completes
+        true                            // Start now
+    );
+}
+
+void pio_spi_dma_rx_ring_stop(pio_spi_dma_rx_inst_t *inst) {
+    dma_channel_abort(inst->dma_chan);
+    
+    // Restore the one-shot configuration used by pio_spi_dma_rx_start()
+    dma_channel_config c = rx_dma_config(inst);
+    dma_channel_configure(inst->dma_chan, &c, NULL, &inst->pio->rxf[inst->sm], 0, false);
+    
+    inst->ring = NULL;
+    inst->busy = false;
+}
+
+size_t PIO_SPI_DMA_HOT(pio_spi_dma_rx_ring_peek)(pio_spi_dma_rx_inst_t *inst, uint8_t *dst, size_t len) {
+    size_t avail = pio_spi_dma_rx_ring_available(inst);
+    if (len > avail) len = avail;
+    
+    // Copy in up to two pieces: read cursor to end of ring, then from start
+    size_t size = (size_t)inst->ring_mask + 1;
+    size_t first = size - inst->ring_read;
+    if (first > len) first = len;
+    memcpy(dst, inst->ring + inst->ring_read, first);
+    memcpy(dst + first, inst->ring, len - first);
+    
+    return len;
+}
+
+void PIO_SPI_DMA_HOT(pio_spi_dma_rx_ring_consume)(pio_spi_dma_rx_inst_t *inst, size_t len) {
+    inst->ring_read = (inst->ring_read + len) & inst->ring_mask;
+}
+
+size_t PIO_SPI_DMA_HOT(pio_spi_dma_rx_ring_read)(pio_spi_dma_rx_inst_t *inst, uint8_t *dst, size_t len) {
+    len = pio_spi_dma_rx_ring_peek(inst, dst, len);
+    pio_spi_dma_rx_ring_consume(inst, len);
+    return len;
+}
+
+void pio_spi_dma_rx_deinit(pio_spi_dma_rx_inst_t *inst) {
+    // Abort any ongoing transfer
+    pio_spi_dma_rx_abort(inst);
+    
+    // Disable IRQ for this channel
+    channel_irq_route(inst->dma_chan, inst->irq_index, false);
+    dispatch_unbind(inst->dma_chan);
+    
+    // Release DMA channel
+    dma_channel_unclaim(inst->dma_chan);
+    
+    // Disable PIO SM
+    pio_sm_set_enabled(inst->pio, inst->sm, false);
+    program_release(inst->pio, inst->program, inst->pio_offset);
+    if (inst->program == &spi_rx_cs_program) {
+        pio_abort_enable(inst->pio, inst->sm, false);
+    }
+    
+    // High-speed RX: stop the CS watchdog and its forwarding channel
+    if (inst->wd_dma_chan >= 0) {
+        dma_channel_abort(inst->wd_dma_chan);
+        dma_channel_unclaim(inst->wd_dma_chan);
+        pio_sm_set_enabled(inst->pio, inst->wd_sm, false);
+        inst->wd_dma_chan = -1;
+    }
+    if (inst->program == &spi_rx_fast_program) {
+        program_release(inst->pio, &spi_rx_fast_watchdog_program, inst->wd_offset);
+    }
+    pio_spi_dma_rx_set_timestamps(inst, false);
+    
+    inst->dma_chan = -1;
+}
+
+// ============================================================================
+// Machine-Wide Snapshot
+// ============================================================================
+
+uint pio_spi_dma_telemetry_snapshot(pio_spi_dma_telemetry_t *out, uint max) {
+    uint n = 0;
+    uint32_t save = save_and_disable_interrupts();
+    
+    for (uint chan = 0; chan < NUM_DMA_CHANNELS && n < max; chan++) {
+        dispatch_entry_t *e = &dispatch[chan];
+        pio_spi_dma_telemetry_t *t = &out[n];
+        
+        if (e->kind == DISPATCH_TX || (e->kind == DISPATCH_TXQ && e->idx == 0)) {
+            pio_spi_dma_tx_inst_t *tx = (e->kind == DISPATCH_TX) ? e->obj
+                                      : ((pio_spi_dma_tx_queue_t *)e->obj)->tx;
+            t->pio = (uint8_t)pio_get_index(tx->pio);
+            t->sm = (uint8_t)tx->sm;
+            t->rx = false;
+            pio_spi_dma_tx_get_stats(tx, &t->stats);
+        } else if (e->kind == DISPATCH_RX) {
+            pio_spi_dma_rx_inst_t *rx = e->obj;
+            t->pio = (uint8_t)pio_get_index(rx->pio);
+            t->sm = (uint8_t)rx->sm;
+            t->rx = true;
+            pio_spi_dma_rx_get_stats(rx, &t->stats);
+        } else {
+            continue;
+        }
+        t->dma_chan = (uint8_t)chan;
+        n++;
+    }
+    
+    restore_interrupts(save);
+    return n;
+}
@@ -0,0 +1,856 @@
+/**
+ * PIO-based SPI-like TX/RX with DMA for RP2350
+ * 
+ * Uses DMA to transfer data to/from PIO FIFOs automatically.
+ * CPU just sets up buffers, DMA handles the rest.
+ *
+ * Features:
+ *   - TX: DMA feeds PIO FIFO from memory buffer
+ *   - RX: DMA drains PIO FIFO to memory buffer
+ *   - TX completes on the wire: the callback fires once the last bit has
+ *     left the pin (PIO IRQ), not when DMA has filled the FIFO
+ *   - RX interrupt on transfer complete
+ *   - Scatter-gather TX: one frame from several buffers, no copy
+ *   - Each PIO program is loaded once per PIO block and shared by every
+ *     SM running it (refcounted, removed with its last user)
+ *   - Per-instance telemetry counters and a machine-wide snapshot
+ *   - No flow control at this level: DMA keeps up with PIO only while
+ *     a transfer is armed, so back-to-back buffers need the receiver
+ *     ready first (pio_spi_link.h adds credits for packet streams)
+ *
+ * Signals (3 wires per direction):
+ *   CS   (TX→RX) - Chip select, active LOW, frames each byte
+ *                  (or each whole buffer in framed mode)
+ *   CLK  (TX→RX) - Clock, data sampled on rising edge
+ *   DATA (TX→RX) - Data, MSB first
+ *
+ * Pin Requirements:
+ *   TX: CLK at base, CS at base+1 (consecutive), DATA anywhere
+ *   RX: CS at base, CLK at base+1, DATA at base+2 (all consecutive)
+ *
+ * Timing: 12 cycles/bit, ~12 MHz max, recommend 10 MHz
+ *         (high-speed mode: 6 cycles/bit, 25 MHz at 150 MHz sys clock)
+ *
+ * Framed mode (*_init_framed):
+ *   Each pio_spi_dma_tx_start() buffer is sent under a single CS assertion,
+ *   so bulk payloads run at the raw bit rate with no per-byte CS overhead.
+ *   RX discards partial bytes when CS rises. Both ends of a link must use
+ *   the same mode.
+ *
+ * Word width (PIO_SPI_DMA_WIDTH_32, framed mode only):
+ *   DMA moves 32 bits per beat and PIO shifts 32 bits per FIFO entry, giving
+ *   4x fewer bus transactions and 32 bytes of FIFO slack instead of 8.
+ *   DMA byte swap keeps the wire order identical to byte width: memory
+ *   byte 0 goes first, each byte MSB first. A uint32_t is therefore sent
+ *   least-significant byte first. Buffers must be 4-byte aligned and a
+ *   multiple of 4 bytes long.
+ *
+ * Wide bus (lanes = 2 or 4, framed mode only):
+ *   Each clock carries 2 or 4 bits on consecutive DATA pins, multiplying
+ *   the link bandwidth at the same clock rate. TX lanes start at pin_data,
+ *   RX lanes start at pin_cs + 2. Both ends must use the same lane count.
+ *
+ * High-speed mode (*_init_fast):
+ *   Framed packets at 6 cycles/bit. RX blocks on CLK edges with WAIT and a
+ *   second "watchdog" SM forces the RX SM back to its start on every CS
+ *   rise (via a dedicated DMA channel), keeping lost-clock recovery with
+ *   no CPU involvement. Costs one extra SM and DMA channel per RX link.
+ */
+
+#ifndef PIO_SPI_CS_DMA_H
+#define PIO_SPI_CS_DMA_H
+
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Hot Path Placement
+// ============================================================================
+
+/** Wrap hot functions so PIO_SPI_DMA_HOT_IN_RAM builds run them from SRAM */
+#if PIO_SPI_DMA_HOT_IN_RAM
+#define PIO_SPI_DMA_HOT(func) __not_in_flash_func(func)
+#else
+#define PIO_SPI_DMA_HOT(func) func
+#endif
+
+// ============================================================================
+// Callback Type
+// ============================================================================
+
+/** Callback function type for transfer complete notifications */
+typedef void (*pio_spi_dma_callback_t)(void *user_data);
+
+// ============================================================================
+// Transfer Width
+// ============================================================================
+
+/** DMA/FIFO transfer width (value is log2 of bytes, matching DMA_SIZE_x) */
+typedef enum {
+    PIO_SPI_DMA_WIDTH_8  = 0,   // One byte per DMA beat / FIFO entry
+    PIO_SPI_DMA_WIDTH_32 = 2    // One word per DMA beat / FIFO entry
+} pio_spi_dma_width_t;
+
+/** RX sampling point relative to the CLK edge the SM reacts to */
+typedef enum {
+    PIO_SPI_DMA_SAMPLE_EARLY   = 0, // CLK synchronizer bypassed: ~2 sys clocks earlier
+    PIO_SPI_DMA_SAMPLE_NOMINAL = 1, // All inputs synchronized (default)
+    PIO_SPI_DMA_SAMPLE_LATE    = 2  // DATA synchronizers bypassed: ~2 sys clocks later
+} pio_spi_dma_sample_phase_t;
+
+/** PIO interrupt line (0 or 1) the driver takes for TX drain and RX abort flags */
+#ifndef PIO_SPI_DMA_PIO_IRQ
+#define PIO_SPI_DMA_PIO_IRQ 1
+#endif
+
+// ============================================================================
+// Telemetry
+// ============================================================================
+
+/**
+ * Per-instance counters
+ * 
+ * Free-running and wrapping: a host polls them and takes differences.
+ * TX counts when a frame is handed to DMA, RX when a transfer completes.
+ */
+typedef struct {
+    uint32_t frames;            // TX: frames sent; RX: packets, good or bad (packet layer)
+    uint32_t bytes;             // Bytes on the wire, framing excluded
+    uint32_t aborted;           // RX: frames cut short by CS or dropped for lost framing
+    uint32_t fifo_overflows;    // RX: SM stalled on a full FIFO; TX: FIFO written while full
+    uint32_t crc_errors;        // RX: packets failing their CRC (packet layer)
+    uint32_t busy_cycles;       // TX: sys clock cycles of bit-times sent
+} pio_spi_dma_stats_t;
+
+// ============================================================================
+// Instance Structures
+// ============================================================================
+
+typedef struct {
+    PIO pio;
+    uint sm;
+    uint pio_offset;
+    uint dma_chan;
+    bool framed;
+    pio_spi_dma_width_t width;
+    uint lanes;                 // DATA pins per direction (1, 2 or 4)
+    uint irq_index;             // DMA_IRQ_0 or DMA_IRQ_1 (0 or 1)
+    volatile bool busy;
+    const pio_program_t *program;   // Loaded program (for removal)
+    pio_spi_dma_callback_t callback;
+    void *callback_data;
+    uint32_t clock_cycles;      // Sys clock cycles per bit clock, in 1/256ths
+    pio_spi_dma_stats_t stats;
+} pio_spi_dma_tx_inst_t;
+
+typedef struct {
+    PIO pio;
+    uint sm;
+    uint pio_offset;
+    uint dma_chan;
+    bool framed;
+    pio_spi_dma_width_t width;
+    uint lanes;                 // DATA pins per direction (1, 2 or 4)
+    uint irq_index;             // DMA_IRQ_0 or DMA_IRQ_1 (0 or 1)
+    uint pin_cs;                // CS input (CLK and DATA follow)
+    volatile bool busy;
+    const pio_program_t *program;   // Loaded program (for removal)
+    pio_spi_dma_callback_t callback;
+    void *callback_data;
+    uint8_t *ring;              // Ring buffer (NULL when not in ring mode)
+    uint32_t ring_mask;         // Ring size - 1
+    uint32_t ring_read;         // Read cursor (offset into ring)
+    uint wd_sm;                 // High-speed mode: CS watchdog SM
+    uint wd_offset;             // High-speed mode: watchdog program offset
+    int wd_dma_chan;            // High-speed mode: forced-jump channel (-1 if unused)
+    int stamp_chan;             // Arrival timestamp channel (-1 if off)
+    volatile uint32_t stamp;    // Timer (us) when the last transfer completed
+    uint32_t pending;           // Bytes in the armed one-shot transfer
+    pio_spi_dma_stats_t stats;  // aborted: PIO-flagged ones are added by get_stats
+} pio_spi_dma_rx_inst_t;
+
+/** Segment slots in a TX queue (power of 2; framed packets use two) */
+#ifndef PIO_SPI_DMA_TXQ_DEPTH
+#define PIO_SPI_DMA_TXQ_DEPTH 16
+#endif
+
+typedef struct {
+    const void *addr;           // Source of DMA reads
+    uint32_t count;             // Transfer count in DMA beats
+    uint32_t header;            // Storage for framed header word
+    uint8_t size;               // pio_spi_dma_width_t of this segment
+    bool bswap;                 // Byte swap (payload words only)
+} pio_spi_dma_tx_seg_t;
+
+/** Back-to-back TX queue on two chained DMA channels (see pio_spi_dma_tx_queue_init) */
+typedef struct {
+    pio_spi_dma_tx_inst_t *tx;
+    uint dma_chan[2];
+    dma_channel_config config[2];
+    bool loaded[2];             // Channel holds a segment not yet completed
+    uint next_chan;             // Channel to load next (alternates)
+    pio_spi_dma_tx_seg_t seg[PIO_SPI_DMA_TXQ_DEPTH];
+    uint32_t head;              // Next slot to fill
+    uint32_t load;              // Next slot to load into a channel
+    uint32_t done;              // Oldest slot not yet completed
+    volatile bool busy;
+    pio_spi_dma_callback_t callback;
+    void *callback_data;
+} pio_spi_dma_tx_queue_t;
+
+/** Segments in one scatter-gather frame */
+#ifndef PIO_SPI_DMA_SG_MAX_SEGS
+#define PIO_SPI_DMA_SG_MAX_SEGS 8
+#endif
+
+/** One piece of a scatter-gather frame */
+typedef struct {
+    const void *base;
+    size_t len;                 // Bytes (multiple of 4 in 32-bit width)
+} pio_spi_dma_iovec_t;
+
+/** DMA control block: the data channel's alias 0 registers, in order */
+typedef struct {
+    const void *read_addr;
+    volatile void *write_addr;
+    uint32_t trans_count;
+    uint32_t ctrl;              // Written to CTRL_TRIG: starts the segment
+} pio_spi_dma_ctrl_block_t;
+
+/** Scatter-gather TX on a control-block chain (see pio_spi_dma_tx_sg_init) */
+typedef struct {
+    pio_spi_dma_tx_inst_t *tx;
+    int ctrl_chan;              // Loads blocks into the data channel (-1 if unclaimed)
+    dma_channel_config data_config;     // Data channel as the driver set it up
+    pio_spi_dma_ctrl_block_t block[PIO_SPI_DMA_SG_MAX_SEGS];
+} pio_spi_dma_tx_sg_t;
+
+// ============================================================================
+// TX Initialization
+// ============================================================================
+
+/**
+ * Initialize SPI TX with DMA
+ * 
+ * @param pio       PIO instance (pio0, pio1, or pio2)
+ * @param sm        State machine index (0-3)
+ * @param pin_clk   GPIO for CLK output (CS is pin_clk + 1)
+ * @param pin_data  GPIO for DATA output (any pin)
+ * @param freq_hz   Bit rate in Hz (max ~12 MHz)
+ * @return          Initialized instance (dma_chan = -1 on failure)
+ */
+pio_spi_dma_tx_inst_t pio_spi_dma_tx_init(PIO pio, uint sm,
+                                           uint pin_clk, uint pin_data,
+                                           float freq_hz);
+
+/**
+ * Initialize framed SPI TX with DMA (one CS assertion per buffer)
+ * 
+ * Same parameters as pio_spi_dma_tx_init(), plus:
+ * @param width     Transfer width (PIO_SPI_DMA_WIDTH_8 or PIO_SPI_DMA_WIDTH_32)
+ * @param lanes     DATA lanes 1, 2 or 4 (pin_data .. pin_data + lanes - 1)
+ * 
+ * Each pio_spi_dma_tx_start() buffer becomes one packet with CS held low
+ * for its full length. Pair with pio_spi_dma_rx_init_framed() on the far end.
+ */
+pio_spi_dma_tx_inst_t pio_spi_dma_tx_init_framed(PIO pio, uint sm,
+                                                  uint pin_clk, uint pin_data,
+                                                  float freq_hz,
+                                                  pio_spi_dma_width_t width, uint lanes);
+
+/**
+ * Initialize high-speed framed SPI TX with DMA (6 cycles/bit)
+ * 
+ * Same parameters as pio_spi_dma_tx_init_framed(), freq_hz up to
+ * sys_clk / 6. Pair with pio_spi_dma_rx_init_fast() on the far end.
+ */
+pio_spi_dma_tx_inst_t pio_spi_dma_tx_init_fast(PIO pio, uint sm,
+                                                uint pin_clk, uint pin_data,
+                                                float freq_hz,
+                                                pio_spi_dma_width_t width, uint lanes);
+
+// ============================================================================
+// RX Initialization
+// ============================================================================
+
+/**
+ * Initialize SPI RX with DMA
+ * 
+ * @param pio       PIO instance (pio0, pio1, or pio2)
+ * @param sm        State machine index (0-3)
+ * @param pin_cs    GPIO for CS input (CLK=pin_cs+1, DATA=pin_cs+2)
+ * @return          Initialized instance (dma_chan = -1 on failure)
+ */
+pio_spi_dma_rx_inst_t pio_spi_dma_rx_init(PIO pio, uint sm, uint pin_cs);
+
+/**
+ * Initialize framed SPI RX with DMA (CS marks end-of-packet only)
+ * 
+ * Same parameters as pio_spi_dma_rx_init(), plus:
+ * @param width     Transfer width (PIO_SPI_DMA_WIDTH_8 or PIO_SPI_DMA_WIDTH_32)
+ * @param lanes     DATA lanes 1, 2 or 4 (pin_cs + 2 .. pin_cs + 1 + lanes)
+ * 
+ * Pair with pio_spi_dma_tx_init_framed() on the far end. Both ends may use
+ * different widths as long as packets are a multiple of 4 bytes.
+ */
+pio_spi_dma_rx_inst_t pio_spi_dma_rx_init_framed(PIO pio, uint sm, uint pin_cs,
+                                                  pio_spi_dma_width_t width, uint lanes);
+
+/**
+ * Initialize high-speed framed SPI RX with DMA
+ * 
+ * @param pio       PIO instance
+ * @param sm        RX state machine index (0-3)
+ * @param wd_sm     CS watchdog state machine index (0-3, same PIO, != sm)
+ * @param pin_cs    GPIO for CS input (CLK=pin_cs+1, DATA=pin_cs+2...)
+ * @param width     Transfer width (PIO_SPI_DMA_WIDTH_8 or PIO_SPI_DMA_WIDTH_32)
+ * @param lanes     DATA lanes 1, 2 or 4
+ * @return          Initialized instance (dma_chan = -1 on failure)
+ * 
+ * Pair with pio_spi_dma_tx_init_fast() on the far end.
+ */
+pio_spi_dma_rx_inst_t pio_spi_dma_rx_init_fast(PIO pio, uint sm, uint wd_sm, uint pin_cs,
+                                                pio_spi_dma_width_t width, uint lanes);
+
+// ============================================================================
+// TX Functions
+// ============================================================================
+
+/**
+ * Start DMA transfer from buffer to TX
+ * 
+ * @param inst      TX instance
+ * @param data      Source buffer (must remain valid until transfer completes)
+ * @param len       Number of bytes to send (multiple of 4 in 32-bit width)
+ * 
+ * Returns immediately. Use pio_spi_dma_tx_busy() or callback to detect completion.
+ */
+void pio_spi_dma_tx_start(pio_spi_dma_tx_inst_t *inst, const uint8_t *data, size_t len);
+
+/**
+ * Open a CS frame whose data another source writes to the TX FIFO
+ * 
+ * @param inst      TX instance
+ * @param frame_len Total bytes in the frame
+ * 
+ * Queues the framed header word; the next frame_len bytes written to the
+ * SM's TX FIFO (by DMA or pio_sm_put) go out under one CS. No-op on
+ * per-byte CS links.
+ */
+void pio_spi_dma_tx_begin_frame(pio_spi_dma_tx_inst_t *inst, size_t frame_len);
+
+/**
+ * Start DMA transfer covering only the first part of a longer CS frame
+ * 
+ * @param inst      TX instance
+ * @param data      Source buffer (must remain valid until transfer completes)
+ * @param len       Number of bytes this DMA transfer sends
+ * @param frame_len Total bytes in the frame (>= len)
+ * 
+ * For layers that feed the rest of the frame from another source (e.g. a
+ * chained channel writing a CRC into the TX FIFO). On per-byte CS links
+ * frame_len is ignored. Such layers give the channel an IRQ-quiet config
+ * and call pio_spi_dma_tx_drain() once the frame is all queued.
+ */
+void pio_spi_dma_tx_start_frame(pio_spi_dma_tx_inst_t *inst,
+                                const uint8_t *data, size_t len,
+                                size_t frame_len);
+
+/**
+ * Start DMA transfer into a frame already opened with pio_spi_dma_tx_begin_frame()
+ * 
+ * @param inst      TX instance
+ * @param data      Source buffer (must remain valid until transfer completes)
+ * @param len       Number of bytes this DMA transfer sends
+ * 
+ * For layers that write the start of the frame themselves (e.g. a header
+ * put straight into the FIFO) and let DMA send the rest.
+ */
+void pio_spi_dma_tx_continue_frame(pio_spi_dma_tx_inst_t *inst, const uint8_t *data, size_t len);
+
+/**
+ * Start DMA transfer of 32-bit words to TX (PIO_SPI_DMA_WIDTH_32 instances)
+ * 
+ * @param inst      TX instance
+ * @param words     Source buffer (must remain valid until transfer completes)
+ * @param count     Number of words to send
+ */
+static inline void pio_spi_dma_tx_start_words(pio_spi_dma_tx_inst_t *inst,
+                                              const uint32_t *words, size_t count) {
+    pio_spi_dma_tx_start(inst, (const uint8_t *)words, count * sizeof(uint32_t));
+}
+
+/**
+ * Check if a TX transfer is still going out (queued or on the wire)
+ */
+static inline bool pio_spi_dma_tx_busy(pio_spi_dma_tx_inst_t *inst) {
+    return inst->busy || dma_channel_is_busy(inst->dma_chan);
+}
+
+/**
+ * Wait until the last bit of the transfer has left the pin
+ * 
+ * Sleeps in WFE between interrupts rather than spinning. Thread context
+ * only: completion comes from the DMA and PIO interrupts.
+ */
+void pio_spi_dma_tx_wait(pio_spi_dma_tx_inst_t *inst);
+
+/**
+ * Send buffer and wait for completion (blocking)
+ */
+void pio_spi_dma_tx_blocking(pio_spi_dma_tx_inst_t *inst, const uint8_t *data, size_t len);
+
+/**
+ * Complete a transfer once everything queued so far is on the wire
+ * 
+ * Called by the driver when a transfer's DMA finishes. Layers whose
+ * frame ends in a channel of their own (chained from the TX channel, or
+ * started alone) call it from that channel's completion, with the whole
+ * frame queued. busy clears and the callback fires, from the PIO IRQ,
+ * when the SM finishes a frame with its FIFO empty.
+ */
+void pio_spi_dma_tx_drain(pio_spi_dma_tx_inst_t *inst);
+
+/**
+ * Set callback for TX transfer complete
+ * 
+ * @param inst      TX instance
+ * @param callback  Function to call once the last bit has left the pin
+ *                  (NULL to disable); the buffer and link are free then
+ * @param user_data Passed to callback
+ */
+void pio_spi_dma_tx_set_callback(pio_spi_dma_tx_inst_t *inst,
+                                  pio_spi_dma_callback_t callback,
+                                  void *user_data);
+
+/**
+ * Route TX completion interrupts to DMA_IRQ_0 (default) or DMA_IRQ_1
+ * 
+ * Spreading links over both lines lets each core (or priority level)
+ * service its own set. Call before pio_spi_dma_tx_queue_init().
+ */
+void pio_spi_dma_tx_set_irq_index(pio_spi_dma_tx_inst_t *inst, uint irq_index);
+
+/**
+ * Change the TX bit clock between transfers (e.g. after link training)
+ * 
+ * @param inst      TX instance
+ * @param div       SM clock divider in 1/256ths (>= 256), fractional
+ *                  values included
+ * 
+ * Takes effect immediately: call with the TX idle and its FIFO drained.
+ */
+void pio_spi_dma_tx_set_clkdiv(pio_spi_dma_tx_inst_t *inst, uint32_t div);
+
+/**
+ * Current TX clock divider in 1/256ths
+ */
+uint32_t pio_spi_dma_tx_get_clkdiv(const pio_spi_dma_tx_inst_t *inst);
+
+/**
+ * Current TX clock rate in Hz (bits per second per lane)
+ */
+float pio_spi_dma_tx_get_freq(const pio_spi_dma_tx_inst_t *inst);
+
+/**
+ * Copy the TX counters
+ * 
+ * Also picks up a FIFO overflow flagged by the PIO since the last call.
+ */
+void pio_spi_dma_tx_get_stats(pio_spi_dma_tx_inst_t *inst, pio_spi_dma_stats_t *stats);
+
+/**
+ * Abort any in-progress TX transfer
+ */
+void pio_spi_dma_tx_abort(pio_spi_dma_tx_inst_t *inst);
+
+/**
+ * Move a TX instance onto a given DMA channel
+ * 
+ * @param inst      TX instance, at the address it will be used from
+ * @param chan      DMA channel, already claimed by the caller
+ *                  (dma_channel_claim); the one the instance had is unclaimed
+ * 
+ * For callers that fix channels at build time (pio_spi_dma.hpp). Call
+ * with no transfer started; completion is bound to inst here, so the
+ * instance must not be copied or moved afterwards.
+ */
+void pio_spi_dma_tx_set_dma_chan(pio_spi_dma_tx_inst_t *inst, uint chan);
+
+/**
+ * Disable TX and release resources
+ */
+void pio_spi_dma_tx_deinit(pio_spi_dma_tx_inst_t *inst);
+
+// ============================================================================
+// TX Queue Functions
+// ============================================================================
+
+/**
+ * Attach a back-to-back TX queue to an initialized TX instance
+ * 
+ * @param q         Queue storage (must stay valid while in use)
+ * @param tx        TX instance (classic or framed, any width)
+ * @return          false if no second DMA channel is available
+ * 
+ * Claims a second DMA channel and takes over the instance's own channel
+ * and completion callback. The two are chained ping-pong, so queued
+ * buffers stream with no idle bit-times between them. Don't use
+ * pio_spi_dma_tx_start() on the instance while the queue is attached.
+ * 
+ * The reload IRQ must run before the in-flight segment finishes plus the
+ * FIFO drain time; at 10 MHz the FIFO alone covers ~6 us.
+ */
+bool pio_spi_dma_tx_queue_init(pio_spi_dma_tx_queue_t *q, pio_spi_dma_tx_inst_t *tx);
+
+/**
+ * Queue a buffer for transmission
+ * 
+ * @param q         TX queue
+ * @param data      Source buffer (must remain valid until the queue drains
+ *                  past it)
+ * @param len       Number of bytes (multiple of 4 in 32-bit width)
+ * @return          false if the queue is full (nothing queued)
+ * 
+ * Each buffer is one CS-framed packet on framed links.
+ */
+bool pio_spi_dma_tx_queue_submit(pio_spi_dma_tx_queue_t *q, const uint8_t *data, size_t len);
+
+/**
+ * Check if the queue still has data queued or on the wire
+ */
+static inline bool pio_spi_dma_tx_queue_busy(pio_spi_dma_tx_queue_t *q) {
+    return q->busy;
+}
+
+/**
+ * Number of free segment slots
+ */
+static inline uint32_t pio_spi_dma_tx_queue_free(pio_spi_dma_tx_queue_t *q) {
+    return PIO_SPI_DMA_TXQ_DEPTH - (q->head - q->done);
+}
+
+/**
+ * Wait until the last queued bit has left the pin
+ * 
+ * Sleeps in WFE between interrupts, like pio_spi_dma_tx_wait().
+ */
+void pio_spi_dma_tx_queue_wait(pio_spi_dma_tx_queue_t *q);
+
+/**
+ * Set callback for queue drained: called from the PIO IRQ once the last
+ * queued bit has left the pin, so every submitted buffer is free again
+ */
+void pio_spi_dma_tx_queue_set_callback(pio_spi_dma_tx_queue_t *q,
+                                        pio_spi_dma_callback_t callback,
+                                        void *user_data);
+
+/**
+ * Detach the queue, abort pending data and release the second channel
+ */
+void pio_spi_dma_tx_queue_deinit(pio_spi_dma_tx_queue_t *q);
+
+// ============================================================================
+// Scatter-Gather TX Functions
+// ============================================================================
+
+/**
+ * Attach scatter-gather sending to an initialized TX instance
+ * 
+ * @param sg        Scatter-gather state (must stay valid while in use)
+ * @param tx        TX instance (classic or framed, any width)
+ * @return          false if no control DMA channel is available
+ * 
+ * Claims a control channel that writes one control block per segment
+ * into the data channel's registers; the data channel chains back to it
+ * after each segment, so a header in one place and a payload in another
+ * go out as one CS frame with no copy and no CPU work in between. The
+ * instance keeps working normally between scatter-gather frames.
+ */
+bool pio_spi_dma_tx_sg_init(pio_spi_dma_tx_sg_t *sg, pio_spi_dma_tx_inst_t *tx);
+
+/**
+ * Send a list of buffers as one frame (non-blocking)
+ * 
+ * @param sg        Scatter-gather state
+ * @param iov       Segments, sent in order (must remain valid until the
+ *                  transfer completes; the list itself is copied)
+ * @param count     Number of segments (empty ones are skipped)
+ * @return          false if there are more than PIO_SPI_DMA_SG_MAX_SEGS
+ *                  non-empty segments, or none (nothing sent)
+ * 
+ * Completion is reported like pio_spi_dma_tx_start(): tx_busy() and the
+ * instance callback, once on the last segment.
+ */
+bool pio_spi_dma_tx_sg_start(pio_spi_dma_tx_sg_t *sg, const pio_spi_dma_iovec_t *iov, uint count);
+
+/**
+ * Send a list of buffers as the first part of a longer frame
+ * 
+ * @param sg        Scatter-gather state
+ * @param iov       Segments, as pio_spi_dma_tx_sg_start()
+ * @param count     Number of segments
+ * @param frame_len Total bytes in the frame (>= sum of segment lengths)
+ * @param config    Data channel config for the segments (e.g. sniffing,
+ *                  chained to a channel that sends the rest), or NULL for
+ *                  the driver's own. The last segment runs with it as-is,
+ *                  so its CHAIN_TO and IRQ settings take effect at the end.
+ * @return          As pio_spi_dma_tx_sg_start()
+ */
+bool pio_spi_dma_tx_sg_start_frame(pio_spi_dma_tx_sg_t *sg, const pio_spi_dma_iovec_t *iov,
+                                   uint count, size_t frame_len,
+                                   const dma_channel_config *config);
+
+/**
+ * Release the control channel
+ */
+void pio_spi_dma_tx_sg_deinit(pio_spi_dma_tx_sg_t *sg);
+
+// ============================================================================
+// RX Functions
+// ============================================================================
+
+/**
+ * Start DMA transfer from RX to buffer
+ * 
+ * @param inst      RX instance
+ * @param data      Destination buffer (must remain valid until transfer completes)
+ * @param len       Number of bytes to receive (multiple of 4 in 32-bit width)
+ * 
+ * Returns immediately. Use pio_spi_dma_rx_busy() or callback to detect completion.
+ */
+void pio_spi_dma_rx_start(pio_spi_dma_rx_inst_t *inst, uint8_t *data, size_t len);
+
+/**
+ * Start DMA transfer of 32-bit words from RX (PIO_SPI_DMA_WIDTH_32 instances)
+ * 
+ * @param inst      RX instance
+ * @param words     Destination buffer (must remain valid until transfer completes)
+ * @param count     Number of words to receive
+ */
+static inline void pio_spi_dma_rx_start_words(pio_spi_dma_rx_inst_t *inst,
+                                              uint32_t *words, size_t count) {
+    pio_spi_dma_rx_start(inst, (uint8_t *)words, count * sizeof(uint32_t));
+}
+
+/**
+ * Check if RX DMA transfer is in progress
+ */
+static inline bool pio_spi_dma_rx_busy(pio_spi_dma_rx_inst_t *inst) {
+    return inst->busy || dma_channel_is_busy(inst->dma_chan);
+}
+
+/**
+ * Wait for RX DMA transfer to complete
+ */
+void pio_spi_dma_rx_wait(pio_spi_dma_rx_inst_t *inst);
+
+/**
+ * Receive into buffer and wait for completion (blocking)
+ */
+void pio_spi_dma_rx_blocking(pio_spi_dma_rx_inst_t *inst, uint8_t *data, size_t len);
+
+/**
+ * Set callback for RX transfer complete
+ * 
+ * @param inst      RX instance
+ * @param callback  Function to call on completion (NULL to disable)
+ * @param user_data Passed to callback
+ */
+void pio_spi_dma_rx_set_callback(pio_spi_dma_rx_inst_t *inst,
+                                  pio_spi_dma_callback_t callback,
+                                  void *user_data);
+
+/**
+ * Timestamp RX transfers in hardware
+ * 
+ * @param inst      RX instance, at the address it will be used from
+ * @param enable    true to claim a DMA channel for it, false to release it
+ * @return          false if no DMA channel was free
+ * 
+ * A channel chained from the RX channel copies the timer (timerawl, us)
+ * into inst->stamp as each transfer's last beat lands, a few cycles
+ * after the bits arrive and with no interrupt latency in it. Layers
+ * that copy the channel config (pio_spi_packet_rx_init()) must be set
+ * up after this; the packet layer keeps the chain on its header
+ * transfer only, so its stamp is the frame's arrival.
+ */
+bool pio_spi_dma_rx_set_timestamps(pio_spi_dma_rx_inst_t *inst, bool enable);
+
+/**
+ * Arrival time of the last completed RX transfer (timer us, low 32 bits)
+ */
+static inline uint32_t pio_spi_dma_rx_stamp(const pio_spi_dma_rx_inst_t *inst) {
+    return inst->stamp;
+}
+
+/**
+ * Get number of bytes remaining in current RX transfer
+ */
+static inline size_t pio_spi_dma_rx_remaining(pio_spi_dma_rx_inst_t *inst) {
+    return (size_t)dma_channel_hw_addr(inst->dma_chan)->transfer_count << inst->width;
+}
+
+/**
+ * Route RX completion interrupts to DMA_IRQ_0 (default) or DMA_IRQ_1
+ */
+void pio_spi_dma_rx_set_irq_index(pio_spi_dma_rx_inst_t *inst, uint irq_index);
+
+/**
+ * Move the RX sampling point (for link training)
+ * 
+ * Bypassing the 2-flop input synchronizer on CLK makes the SM see the
+ * edge sooner and so sample DATA earlier; bypassing it on the DATA lanes
+ * samples later. Either trades a little metastability margin for
+ * timing, so only keep a setting that training has shown to be clean.
+ */
+void pio_spi_dma_rx_set_sample_phase(pio_spi_dma_rx_inst_t *inst,
+                                     pio_spi_dma_sample_phase_t phase);
+
+/**
+ * Copy the RX counters
+ * 
+ * aborted includes the partial frames spi_rx_cs flags through PIO IRQs.
+ * Framed and high-speed RX have no room for that in their programs; the
+ * packet layer counts their lost framing instead. Ring mode bytes are not
+ * counted.
+ */
+void pio_spi_dma_rx_get_stats(pio_spi_dma_rx_inst_t *inst, pio_spi_dma_stats_t *stats);
+
+/**
+ * Abort any in-progress RX transfer
+ */
+void pio_spi_dma_rx_abort(pio_spi_dma_rx_inst_t *inst);
+
+/**
+ * Move an RX instance onto a given DMA channel
+ * 
+ * Same rules as pio_spi_dma_tx_set_dma_chan(); call before any transfer
+ * or ring mode is started.
+ */
+void pio_spi_dma_rx_set_dma_chan(pio_spi_dma_rx_inst_t *inst, uint chan);
+
+/**
+ * Flush RX FIFO (discards any pending data)
+ */
+void pio_spi_dma_rx_flush(pio_spi_dma_rx_inst_t *inst);
+
+/**
+ * Disable RX and release resources
+ */
+void pio_spi_dma_rx_deinit(pio_spi_dma_rx_inst_t *inst);
+
+// ============================================================================
+// Helper Channels
+// ============================================================================
+
+/**
+ * Route a helper DMA channel's completion IRQ through the driver's dispatch
+ * 
+ * @param chan      DMA channel (claimed by the caller)
+ * @param irq_index DMA_IRQ_0 or DMA_IRQ_1 (0 or 1)
+ * @param callback  Called from the IRQ on completion (NULL to disable)
+ * @param user_data Passed to callback
+ * 
+ * For layers built on the driver (packet CRC, forwarding, etc.) that claim
+ * extra channels; the driver owns the DMA IRQ handlers exclusively.
+ */
+void pio_spi_dma_channel_set_irq_callback(uint chan, uint irq_index,
+                                          pio_spi_dma_callback_t callback,
+                                          void *user_data);
+
+// ============================================================================
+// Machine-Wide Snapshot
+// ============================================================================
+
+/** One instance in a snapshot */
+typedef struct {
+    uint8_t pio;                // PIO block index
+    uint8_t sm;
+    bool rx;                    // false: TX
+    uint8_t dma_chan;
+    pio_spi_dma_stats_t stats;
+} pio_spi_dma_telemetry_t;
+
+/**
+ * Counters of every TX and RX instance that has started a transfer
+ * 
+ * @param out       Entries, in DMA channel order
+ * @param max       Room in out
+ * @return          Entries written
+ * 
+ * Taken with interrupts off, so all entries are from the same moment;
+ * costs a copy per instance. Instances are found through the DMA
+ * dispatch table, so they must still be at the address they last
+ * started from.
+ */
+uint pio_spi_dma_telemetry_snapshot(pio_spi_dma_telemetry_t *out, uint max);
+
+// ============================================================================
+// RX Ring Buffer Mode
+// ============================================================================
+
+/**
+ * Start always-on RX into a ring buffer
+ * 
+ * @param inst      RX instance
+ * @param ring      Ring buffer, 1 << ring_bits bytes, aligned to its own size
+ *                  (e.g. __attribute__((aligned(1024))) for ring_bits = 10)
+ * @param ring_bits log2 of ring size in bytes (2-15, i.e. 4 B to 32 KB)
+ * 
+ * The DMA channel wraps its write address inside the ring and never
+ * completes, so there is no re-arm gap between messages. Consume data with
+ * pio_spi_dma_rx_ring_available() / _peek() / _consume().
+ * 
+ * The ring holds at most (size - 1) unread bytes; if the reader falls a
+ * full ring behind, old data is overwritten and the count wraps to zero.
+ */
+void pio_spi_dma_rx_ring_start(pio_spi_dma_rx_inst_t *inst, uint8_t *ring, uint ring_bits);
+
+/**
+ * Stop ring mode and return the channel to one-shot pio_spi_dma_rx_start()
+ */
+void pio_spi_dma_rx_ring_stop(pio_spi_dma_rx_inst_t *inst);
+
+/**
+ * Get number of unread bytes in the ring
+ * 
+ * Write position comes straight from the DMA channel's write address.
+ */
+static inline size_t pio_spi_dma_rx_ring_available(pio_spi_dma_rx_inst_t *inst) {
+    uint32_t write_pos = (uint32_t)(uintptr_t)dma_channel_hw_addr(inst->dma_chan)->write_addr
+                       - (uint32_t)(uintptr_t)inst->ring;
+    return (write_pos - inst->ring_read) & inst->ring_mask;
+}
+
+/**
+ * Copy up to len unread bytes out of the ring without consuming them
+ * 
+ * @return          Number of bytes copied (<= available)
+ */
+size_t pio_spi_dma_rx_ring_peek(pio_spi_dma_rx_inst_t *inst, uint8_t *dst, size_t len);
+
+/**
+ * Advance the read cursor by len bytes (len <= available)
+ */
+void pio_spi_dma_rx_ring_consume(pio_spi_dma_rx_inst_t *inst, size_t len);
+
+/**
+ * Peek and consume in one call
+ * 
+ * @return          Number of bytes read
+ */
+size_t pio_spi_dma_rx_ring_read(pio_spi_dma_rx_inst_t *inst, uint8_t *dst, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIO_SPI_CS_DMA_H
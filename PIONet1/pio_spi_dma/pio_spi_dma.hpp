@@ -0,0 +1,328 @@
+/**
+ * Compile-time link configuration for C++ firmware
+ *
+ * Header-only layer over pio_spi_dma.h for links whose PIO block, state
+ * machines, pins, width and DMA channels are fixed when the firmware is
+ * built. Everything the generic start functions load from the instance
+ * (PIO, SM, channel, width, lanes, mode) is a template argument here, so
+ * a start is the same stores pio_spi_dma_tx_start() does, with the
+ * register addresses and shifts resolved by the compiler:
+ *
+ *   using Port = pio_spi_dma::Link<0, 0,
+ *                                  pio_spi_dma::TxPins<TX_CLK_PIN, TX_DATA_PIN>,
+ *                                  pio_spi_dma::RxPins<RX_CS_PIN>,
+ *                                  PIO_SPI_DMA_WIDTH_32, 11, 10>;
+ *   static Port link;
+ *
+ *   link.init(freq_hz);
+ *   link.rx.start(buf, sizeof(buf));
+ *   link.tx.start(msg, sizeof(msg));
+ *
+ * TX runs on Sm, RX on Sm + 1 and (Mode::Fast) the CS watchdog on Sm + 2,
+ * all in one PIO block, as link_bench lays them out. Links split over
+ * blocks, like the mesh ports, use Tx and Rx on their own. link_pingpong
+ * is a complete firmware built this way.
+ *
+ * Completion still comes from the driver's DMA and PIO interrupts, so
+ * callbacks, wait, telemetry and every C function taking the instance
+ * (inst()) work as usual; the counters are kept the same way.
+ * Framed and high-speed links only: per-byte CS links stay on the C API.
+ *
+ * DMA channels are claimed at init and must be free then. Take them from
+ * the top: dma_claim_unused_channel() hands out the lowest free one, so
+ * other layers stay clear of them. An initialised Tx or Rx is bound to
+ * its address (pio_spi_dma_tx_set_dma_chan()), so objects are not
+ * copyable; make them static or members of something that stays put.
+ */
+
+#ifndef PIO_SPI_DMA_HPP
+#define PIO_SPI_DMA_HPP
+
+#include "pio_spi_dma.h"
+
+namespace pio_spi_dma {
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+/** Link flavour, chosen to match the far end */
+enum class Mode {
+    Framed,     // pio_spi_dma_tx_init_framed() / pio_spi_dma_rx_init_framed()
+    Fast        // pio_spi_dma_tx_init_fast() / pio_spi_dma_rx_init_fast()
+};
+
+/** TX pins: CLK (CS is CLK + 1) and the first of Lanes DATA pins */
+template <uint Clk, uint Data, uint Lanes = 1>
+struct TxPins {
+    static_assert(Lanes == 1 || Lanes == 2 || Lanes == 4, "1, 2 or 4 DATA lanes");
+    static constexpr uint clk = Clk;
+    static constexpr uint data = Data;
+    static constexpr uint lanes = Lanes;
+};
+
+/** RX pins: CS, then CLK and Lanes DATA pins after it */
+template <uint Cs, uint Lanes = 1>
+struct RxPins {
+    static_assert(Lanes == 1 || Lanes == 2 || Lanes == 4, "1, 2 or 4 DATA lanes");
+    static constexpr uint cs = Cs;
+    static constexpr uint lanes = Lanes;
+};
+
+namespace detail {
+
+template <uint Pio>
+inline pio_hw_t *pio_regs() {
+    static_assert(Pio < NUM_PIOS, "no such PIO block");
+#if NUM_PIOS > 2
+    if constexpr (Pio == 2) return pio2_hw;
+#endif
+    if constexpr (Pio == 1) return pio1_hw;
+    return pio0_hw;
+}
+
+template <uint Chan>
+inline dma_channel_hw_t *dma_regs() {
+    static_assert(Chan < NUM_DMA_CHANNELS, "no such DMA channel");
+    return &dma_hw->ch[Chan];
+}
+
+// Claim a fixed channel, or report it taken instead of panicking
+inline bool dma_claim(uint chan) {
+    if (dma_channel_is_claimed(chan)) return false;
+    dma_channel_claim(chan);
+    return true;
+}
+
+// The C init leaves dma_chan at -1 when it fails: give the fixed channel back
+inline bool init_ok(uint inst_chan, uint chan) {
+    if ((int)inst_chan >= 0) return true;
+    dma_channel_unclaim(chan);
+    return false;
+}
+
+} // namespace detail
+
+// ============================================================================
+// TX
+// ============================================================================
+
+template <uint Pio, uint Sm, typename Pins, pio_spi_dma_width_t Width,
+          uint Dma, Mode M = Mode::Framed>
+class Tx {
+    static_assert(Sm < NUM_PIO_STATE_MACHINES, "no such state machine");
+
+public:
+    static constexpr uint dma_chan = Dma;
+    static constexpr uint lanes = Pins::lanes;
+
+    Tx() { inst_.dma_chan = -1; }      // deinit() before init() is a no-op
+    Tx(const Tx &) = delete;
+    Tx &operator=(const Tx &) = delete;
+
+    /**
+     * Load the program, start the SM and take the DMA channel
+     *
+     * @return      false if the channel is already claimed or the driver's
+     *              init failed (the channel is released again)
+     */
+    bool init(float freq_hz) {
+        if (!detail::dma_claim(Dma)) return false;
+        PIO pio = pio_get_instance(Pio);
+        if constexpr (M == Mode::Fast) {
+            inst_ = pio_spi_dma_tx_init_fast(pio, Sm, Pins::clk, Pins::data,
+                                             freq_hz, Width, Pins::lanes);
+        } else {
+            inst_ = pio_spi_dma_tx_init_framed(pio, Sm, Pins::clk, Pins::data,
+                                               freq_hz, Width, Pins::lanes);
+        }
+        if (!detail::init_ok(inst_.dma_chan, Dma)) return false;
+        pio_spi_dma_tx_set_dma_chan(&inst_, Dma);
+        return true;
+    }
+
+    void deinit() {
+        if ((int)inst_.dma_chan < 0) return;
+        pio_spi_dma_tx_deinit(&inst_);
+    }
+
+    /**
+     * Send one frame (as pio_spi_dma_tx_start())
+     *
+     * @param len   Bytes, a multiple of 4 in 32-bit width
+     */
+    void start(const void *data, size_t len) {
+        if (len == 0) return;
+
+        // Counted as tx_count_frame() does, so get_stats and the snapshot agree
+        uint32_t clocks = (uint32_t)(len * 8 / lanes);
+        inst_.stats.frames++;
+        inst_.stats.bytes += (uint32_t)len;
+        inst_.stats.busy_cycles += (uint32_t)(((uint64_t)clocks * inst_.clock_cycles) >> 8);
+
+        // Header word ahead of the payload holds CS for the whole frame
+        pio_hw_t *pio = detail::pio_regs<Pio>();
+        while (pio->fstat & (1u << (PIO_FSTAT_TXFULL_LSB + Sm))) {
+            tight_loop_contents();
+        }
+        pio->txf[Sm] = clocks - 1;
+
+        inst_.busy = true;
+        dma_channel_hw_t *ch = detail::dma_regs<Dma>();
+        ch->read_addr = (uintptr_t)data;
+        ch->al1_transfer_count_trig = (uint32_t)(len >> Width);
+    }
+
+    void start_words(const uint32_t *words, size_t count) {
+        start(words, count * sizeof(uint32_t));
+    }
+
+    /** Still going out (queued or on the wire) */
+    bool busy() const {
+        return inst_.busy || (detail::dma_regs<Dma>()->ctrl_trig & DMA_CH0_CTRL_TRIG_BUSY_BITS);
+    }
+
+    /**
+     * DMA has read the whole buffer (it may still be in the FIFO)
+     *
+     * The source buffer can be refilled from here on, ahead of busy().
+     */
+    bool buffer_free() const {
+        return !(detail::dma_regs<Dma>()->ctrl_trig & DMA_CH0_CTRL_TRIG_BUSY_BITS);
+    }
+
+    void wait() {
+        pio_spi_dma_tx_wait(&inst_);
+    }
+
+    void set_callback(pio_spi_dma_callback_t callback, void *user_data) {
+        pio_spi_dma_tx_set_callback(&inst_, callback, user_data);
+    }
+
+    /** The driver instance, for the rest of the C API */
+    pio_spi_dma_tx_inst_t *inst() { return &inst_; }
+
+private:
+    pio_spi_dma_tx_inst_t inst_{};
+};
+
+// ============================================================================
+// RX
+// ============================================================================
+
+template <uint Pio, uint Sm, typename Pins, pio_spi_dma_width_t Width,
+          uint Dma, Mode M = Mode::Framed, uint WdSm = (Sm + 1) % NUM_PIO_STATE_MACHINES>
+class Rx {
+    static_assert(Sm < NUM_PIO_STATE_MACHINES, "no such state machine");
+    static_assert(M != Mode::Fast || (WdSm < NUM_PIO_STATE_MACHINES && WdSm != Sm),
+                  "the CS watchdog needs another SM");
+
+public:
+    static constexpr uint dma_chan = Dma;
+
+    Rx() { inst_.dma_chan = -1; }
+    Rx(const Rx &) = delete;
+    Rx &operator=(const Rx &) = delete;
+
+    /**
+     * Load the program(s), start the SM(s) and take the DMA channel
+     *
+     * @return      false if the channel is already claimed or the driver's
+     *              init failed (the channel is released again)
+     */
+    bool init() {
+        if (!detail::dma_claim(Dma)) return false;
+        PIO pio = pio_get_instance(Pio);
+        if constexpr (M == Mode::Fast) {
+            inst_ = pio_spi_dma_rx_init_fast(pio, Sm, WdSm, Pins::cs, Width, Pins::lanes);
+        } else {
+            inst_ = pio_spi_dma_rx_init_framed(pio, Sm, Pins::cs, Width, Pins::lanes);
+        }
+        if (!detail::init_ok(inst_.dma_chan, Dma)) return false;
+        pio_spi_dma_rx_set_dma_chan(&inst_, Dma);
+        return true;
+    }
+
+    void deinit() {
+        if ((int)inst_.dma_chan < 0) return;
+        pio_spi_dma_rx_deinit(&inst_);
+    }
+
+    /**
+     * Arm a receive (as pio_spi_dma_rx_start())
+     *
+     * @param len   Bytes, a multiple of 4 in 32-bit width
+     */
+    void start(void *data, size_t len) {
+        if (len == 0) return;
+
+        inst_.busy = true;
+        inst_.pending = (uint32_t)len;
+        dma_channel_hw_t *ch = detail::dma_regs<Dma>();
+        ch->write_addr = (uintptr_t)data;
+        ch->al1_transfer_count_trig = (uint32_t)(len >> Width);
+    }
+
+    void start_words(uint32_t *words, size_t count) {
+        start(words, count * sizeof(uint32_t));
+    }
+
+    bool busy() const {
+        return inst_.busy || (detail::dma_regs<Dma>()->ctrl_trig & DMA_CH0_CTRL_TRIG_BUSY_BITS);
+    }
+
+    /** Bytes still to come in the armed transfer */
+    size_t remaining() const {
+        return (size_t)detail::dma_regs<Dma>()->transfer_count << Width;
+    }
+
+    void wait() {
+        pio_spi_dma_rx_wait(&inst_);
+    }
+
+    void set_callback(pio_spi_dma_callback_t callback, void *user_data) {
+        pio_spi_dma_rx_set_callback(&inst_, callback, user_data);
+    }
+
+    /** The driver instance, for the rest of the C API */
+    pio_spi_dma_rx_inst_t *inst() { return &inst_; }
+
+private:
+    pio_spi_dma_rx_inst_t inst_{};
+};
+
+// ============================================================================
+// Link
+// ============================================================================
+
+/** Both directions of a link in one PIO block: TX on Sm, RX on Sm + 1 */
+template <uint Pio, uint Sm, typename TxP, typename RxP, pio_spi_dma_width_t Width,
+          uint TxDma, uint RxDma, Mode M = Mode::Framed>
+class Link {
+    static_assert(Sm + (M == Mode::Fast ? 2 : 1) < NUM_PIO_STATE_MACHINES,
+                  "not enough state machines above Sm");
+    static_assert(TxDma != RxDma, "each direction needs its own DMA channel");
+
+public:
+    Tx<Pio, Sm, TxP, Width, TxDma, M> tx;
+    Rx<Pio, Sm + 1, RxP, Width, RxDma, M, Sm + 2> rx;
+
+    /** Bring up both directions; false (and neither up) if a channel is taken */
+    bool init(float freq_hz) {
+        if (!tx.init(freq_hz)) return false;
+        if (!rx.init()) {
+            tx.deinit();
+            return false;
+        }
+        return true;
+    }
+
+    void deinit() {
+        rx.deinit();
+        tx.deinit();
+    }
+};
+
+} // namespace pio_spi_dma
+
+#endif // PIO_SPI_DMA_HPP
@@ -0,0 +1,412 @@
+/**
+ * Bidirectional link with credit-based flow control
+ */
+
+#include "pio_spi_link.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
+#include <string.h>
+
+#define SEQ_MASK    (PIO_SPI_LINK_MAX_WINDOW - 1)
+
+// ============================================================================
+// Sending
+// ============================================================================
+
+// Buffers this end can still take from the far end
+static uint PIO_SPI_DMA_HOT(rx_free)(const pio_spi_link_t *link) {
+    uint held = link->rx_received - link->rx_released;
+    return (held < link->window) ? link->window - held : 0;
+}
+
+static void PIO_SPI_DMA_HOT(send_credit)(pio_spi_link_t *link) {
+    pio_spi_link_credit_t credit = {
+        .received = link->rx_received,
+        .free = rx_free(link),
+        .ack = link->rx_expect,
+        .sack = (uint16_t)(link->rx_held >> 1),
+    };
+    memcpy(link->ctrl.payload, &credit, sizeof(credit));
+    link->ctrl.hdr.dst = PIO_SPI_PACKET_BROADCAST;
+    link->ctrl.hdr.src = link->ptx.src;
+    link->ctrl.hdr.type = PIO_SPI_LINK_TYPE_CREDIT;
+    link->ctrl.hdr.seq = 0;
+    link->ctrl.hdr.len = sizeof(credit);
+
+    link->credit_due = false;
+    link->credits_sent++;
+    link->tx_cur = &link->ctrl;
+    pio_spi_packet_forward(&link->ptx, &link->ctrl);
+}
+
+// Reliable: (re)send the packet held for seq under its per-hop header
+static void PIO_SPI_DMA_HOT(send_seq)(pio_spi_link_t *link, uint8_t seq) {
+    uint slot = seq & SEQ_MASK;
+    pio_spi_packet_t *pkt = link->unacked[slot];
+
+    pio_spi_packet_hdr_t hdr = pkt->hdr;
+    hdr.seq = seq;
+    link->unacked_order[slot] = ++link->tx_order;
+    link->tx_cur = pkt;
+    link->tx_cur_acked = false;
+    pio_spi_packet_forward_hdr(&link->ptx, pkt, &hdr);
+}
+
+// Start the next packet if idle (IRQs disabled). Credit updates go first:
+// they are tiny and the far end may be stalled waiting for them. Resends
+// come before new data so the receiver's reorder window drains.
+static void PIO_SPI_DMA_HOT(link_kick)(pio_spi_link_t *link) {
+    if (link->tx_cur || link->tx_reserved) return;
+
+    if (link->credit_due) {
+        send_credit(link);
+        return;
+    }
+
+    while (link->retx) {
+        uint i = (uint)__builtin_ctz(link->retx);
+        link->retx &= (uint16_t)~(1u << i);
+        uint8_t seq = (uint8_t)(link->tx_base + i);
+        if (link->unacked[seq & SEQ_MASK]) {
+            send_seq(link, seq);
+            return;
+        }
+    }
+
+    if (link->tx_sent == link->tx_limit || !link->pull) return;
+    if (link->reliable && (uint8_t)(link->tx_next - link->tx_base) >= PIO_SPI_LINK_MAX_WINDOW) return;
+
+    pio_spi_packet_t *pkt = link->pull(link->user_data);
+    if (!pkt) return;
+
+    link->tx_sent++;
+    if (link->reliable) {
+        if (link->tx_next == link->tx_base) {
+            link->tx_progress_us = time_us_32();
+        }
+        uint8_t seq = link->tx_next++;
+        link->unacked[seq & SEQ_MASK] = pkt;
+        send_seq(link, seq);
+    } else {
+        link->tx_cur = pkt;
+        pio_spi_packet_forward(&link->ptx, pkt);
+    }
+}
+
+static void PIO_SPI_DMA_HOT(link_tx_done)(void *user_data) {
+    pio_spi_link_t *link = user_data;
+    pio_spi_packet_t *pkt = link->tx_cur;
+    link->tx_cur = NULL;
+
+    if (pkt != &link->ctrl) {
+        link->tx_last_us = time_us_32();
+        // Reliable packets stay held until acknowledged
+        if ((!link->reliable || link->tx_cur_acked) && link->sent) {
+            link->sent(pkt, link->user_data);
+        }
+        link->tx_cur_acked = false;
+    }
+    link_kick(link);
+}
+
+void PIO_SPI_DMA_HOT(pio_spi_link_kick)(pio_spi_link_t *link) {
+    uint32_t save = save_and_disable_interrupts();
+    link_kick(link);
+    restore_interrupts(save);
+}
+
+bool PIO_SPI_DMA_HOT(pio_spi_link_tx_reserve)(pio_spi_link_t *link) {
+    uint32_t save = save_and_disable_interrupts();
+    bool ok = !link->reliable && !link->tx_cur && !link->tx_reserved &&
+              !link->credit_due && link->tx_sent != link->tx_limit;
+    if (ok) {
+        link->tx_sent++;
+        link->tx_reserved = true;
+    }
+    restore_interrupts(save);
+    return ok;
+}
+
+void PIO_SPI_DMA_HOT(pio_spi_link_tx_unreserve)(pio_spi_link_t *link) {
+    uint32_t save = save_and_disable_interrupts();
+    link->tx_reserved = false;
+    link->tx_last_us = time_us_32();
+    link_kick(link);
+    restore_interrupts(save);
+}
+
+// ============================================================================
+// Acknowledgements (reliable mode)
+// ============================================================================
+
+// The far end has this one: hand the buffer back (after it leaves the TX)
+static void PIO_SPI_DMA_HOT(ack_slot)(pio_spi_link_t *link, uint slot) {
+    pio_spi_packet_t *pkt = link->unacked[slot];
+    link->unacked[slot] = NULL;
+    if (!pkt) return;
+
+    if (pkt == link->tx_cur) {
+        link->tx_cur_acked = true;
+    } else if (link->sent) {
+        link->sent(pkt, link->user_data);
+    }
+}
+
+// Forget everything in flight, e.g. after the far end restarted
+static void ack_all(pio_spi_link_t *link, uint8_t base) {
+    while (link->tx_base != link->tx_next) {
+        ack_slot(link, link->tx_base++ & SEQ_MASK);
+    }
+    link->tx_base = link->tx_next = base;
+    link->retx = 0;
+}
+
+static void PIO_SPI_DMA_HOT(ack_received)(pio_spi_link_t *link, uint8_t ack, uint16_t sack) {
+    uint8_t outstanding = (uint8_t)(link->tx_next - link->tx_base);
+    if ((uint8_t)(ack - link->tx_base) > outstanding) return;      // Stale
+
+    // Cumulative part
+    if (ack != link->tx_base) {
+        link->tx_progress_us = time_us_32();
+    }
+    while (link->tx_base != ack) {
+        ack_slot(link, link->tx_base++ & SEQ_MASK);
+        link->retx >>= 1;
+    }
+
+    // Selective part: note the latest transmission the far end has seen
+    outstanding = (uint8_t)(link->tx_next - link->tx_base);
+    uint32_t newest = 0;
+    for (uint i = 0; sack && i + 1 < outstanding; i++, sack >>= 1) {
+        if (!(sack & 1)) continue;
+        uint slot = (link->tx_base + 1 + i) & SEQ_MASK;
+        if (link->unacked[slot]) {
+            if ((int32_t)(link->unacked_order[slot] - newest) > 0) {
+                newest = link->unacked_order[slot];
+            }
+            ack_slot(link, slot);
+        }
+    }
+    if (!newest) return;
+
+    // Anything sent before that and still missing was lost: resend it.
+    // Each resend gets a newer order, so repeats of this bitmap don't
+    // trigger it again.
+    for (uint i = 0; i < outstanding; i++) {
+        uint slot = (link->tx_base + i) & SEQ_MASK;
+        if (link->unacked[slot] && (int32_t)(newest - link->unacked_order[slot]) > 0 &&
+            !(link->retx & (1u << i))) {
+            link->retx |= (uint16_t)(1u << i);
+            link->retransmits++;
+        }
+    }
+}
+
+// Nothing acknowledged for a while: resend the oldest packet
+static int64_t link_rto_alarm(alarm_id_t id, void *user_data) {
+    (void)id;
+    pio_spi_link_t *link = user_data;
+
+    uint32_t save = save_and_disable_interrupts();
+    if (link->tx_base != link->tx_next &&
+        time_us_32() - link->tx_progress_us >= PIO_SPI_LINK_RTO_US) {
+        for (uint i = 0; i < (uint8_t)(link->tx_next - link->tx_base); i++) {
+            if (link->unacked[(link->tx_base + i) & SEQ_MASK]) {
+                link->retx |= (uint16_t)(1u << i);
+                link->timeouts++;
+                break;
+            }
+        }
+        link->tx_progress_us = time_us_32();
+        link_kick(link);
+    }
+    restore_interrupts(save);
+
+    return link->prx.running ? PIO_SPI_LINK_RTO_US : 0;
+}
+
+// ============================================================================
+// Receiving
+// ============================================================================
+
+static void PIO_SPI_DMA_HOT(credit_received)(pio_spi_link_t *link, const pio_spi_packet_t *pkt) {
+    pio_spi_link_credit_t credit;
+    memcpy(&credit, pkt->payload, sizeof(credit));
+    link->credits_received++;
+
+    // The limit only grows, so the outstanding count can never go
+    // negative or exceed what is free. If it does, one end restarted.
+    // If all is quiet, nothing is in flight and the counts must agree.
+    uint32_t limit = credit.received + credit.free;
+    int32_t credits = (int32_t)(limit - link->tx_sent);
+    bool quiet = !pio_spi_link_tx_busy(link) && link->tx_base == link->tx_next &&
+                 time_us_32() - link->tx_last_us > PIO_SPI_LINK_SETTLE_US;
+    if (credits < 0 || (uint32_t)credits > credit.free ||
+        (quiet && link->tx_sent != credit.received)) {
+        link->tx_sent = credit.received;
+        link->resyncs++;
+        if (link->reliable) {
+            ack_all(link, credit.ack);
+        }
+    } else if (link->reliable) {
+        ack_received(link, credit.ack, credit.sack);
+    }
+    link->tx_limit = limit;
+
+    link_kick(link);
+}
+
+// Hand a packet to the owner; a buffer it doesn't keep is free at once
+static pio_spi_packet_t *PIO_SPI_DMA_HOT(deliver)(pio_spi_link_t *link, pio_spi_packet_t *pkt) {
+    pio_spi_packet_t *next = link->callback ? link->callback(pkt, link->user_data) : pkt;
+    if (next == pkt) {
+        link->rx_released++;
+    }
+    return next;
+}
+
+// Reliable: in-order packets go straight up, later ones wait for the gap
+static pio_spi_packet_t *PIO_SPI_DMA_HOT(reliable_rx)(pio_spi_link_t *link, pio_spi_packet_t *pkt) {
+    uint8_t d = (uint8_t)(pkt->hdr.seq - link->rx_expect);
+    link->credit_due = true;                    // Acknowledge either way
+
+    if (d == 0) {
+        link->rx_received++;
+        pio_spi_packet_t *next = deliver(link, pkt);
+        link->rx_expect++;
+        link->rx_held >>= 1;
+
+        // Gap filled: release everything it was holding up
+        while (link->rx_held & 1) {
+            pio_spi_packet_t *held = link->reorder[link->rx_expect & SEQ_MASK];
+            link->spare[link->spare_count++] = deliver(link, held);
+            link->rx_expect++;
+            link->rx_held >>= 1;
+        }
+        return next;
+    }
+
+    if (d >= PIO_SPI_LINK_MAX_WINDOW || (link->rx_held & (1u << d))) {
+        link->duplicates++;
+        return pkt;
+    }
+
+    pio_spi_packet_t *next = link->spare_count ? link->spare[--link->spare_count]
+                           : link->alloc ? link->alloc(link->user_data) : NULL;
+    if (!next) {
+        return pkt;                             // Dropped: it will be resent
+    }
+
+    link->rx_received++;
+    link->reordered++;
+    link->reorder[pkt->hdr.seq & SEQ_MASK] = pkt;
+    link->rx_held |= (uint16_t)(1u << d);
+    return next;
+}
+
+static pio_spi_packet_t *PIO_SPI_DMA_HOT(link_rx_packet)(pio_spi_packet_t *pkt, void *user_data) {
+    pio_spi_link_t *link = user_data;
+    pio_spi_packet_t *next;
+
+    if (pkt->hdr.type >= PIO_SPI_LINK_TYPE_RESERVED) {
+        if (pkt->hdr.type == PIO_SPI_LINK_TYPE_CREDIT &&
+            pkt->hdr.len == sizeof(pio_spi_link_credit_t)) {
+            credit_received(link, pkt);
+        }
+        return pkt;
+    }
+
+    if (link->reliable) {
+        next = reliable_rx(link, pkt);
+    } else {
+        link->rx_received++;
+        next = deliver(link, pkt);
+        if (next == pkt) {
+            link->credit_due = true;
+        }
+    }
+
+    link_kick(link);
+    return next;
+}
+
+void PIO_SPI_DMA_HOT(pio_spi_link_rx_release)(pio_spi_link_t *link) {
+    uint32_t save = save_and_disable_interrupts();
+    link->rx_released++;
+    link->credit_due = true;
+    link_kick(link);
+    restore_interrupts(save);
+}
+
+void PIO_SPI_DMA_HOT(pio_spi_link_rx_passed)(pio_spi_link_t *link) {
+    uint32_t save = save_and_disable_interrupts();
+    link->rx_received++;
+    link->rx_released++;
+    link->credit_due = true;
+    link_kick(link);
+    restore_interrupts(save);
+}
+
+// ============================================================================
+// Setup
+// ============================================================================
+
+bool pio_spi_link_init(pio_spi_link_t *link, pio_spi_dma_tx_inst_t *tx,
+                       pio_spi_dma_rx_inst_t *rx, pio_spi_packet_t *rx_buf,
+                       uint16_t src, uint window) {
+    memset(link, 0, sizeof(*link));
+    link->window = window;
+
+    if (!pio_spi_packet_tx_init(&link->ptx, tx, src)) {
+        return false;
+    }
+    pio_spi_packet_tx_set_callback(&link->ptx, link_tx_done, link);
+
+    pio_spi_packet_rx_init(&link->prx, rx, rx_buf);
+    pio_spi_packet_rx_set_callback(&link->prx, link_rx_packet, link);
+    return true;
+}
+
+void pio_spi_link_set_callbacks(pio_spi_link_t *link,
+                                pio_spi_link_pull_callback_t pull,
+                                pio_spi_link_sent_callback_t sent,
+                                pio_spi_packet_rx_callback_t callback,
+                                void *user_data) {
+    link->pull = pull;
+    link->sent = sent;
+    link->callback = callback;
+    link->user_data = user_data;
+}
+
+void pio_spi_link_set_reliable(pio_spi_link_t *link, pio_spi_link_alloc_callback_t alloc) {
+    link->reliable = true;
+    link->alloc = alloc;
+    if (link->window > PIO_SPI_LINK_MAX_WINDOW) {
+        link->window = PIO_SPI_LINK_MAX_WINDOW;
+    }
+}
+
+void pio_spi_link_start(pio_spi_link_t *link) {
+    pio_spi_packet_rx_start(&link->prx);
+    if (link->reliable && !link->rto_alarm) {
+        alarm_id_t id = alarm_pool_add_alarm_in_us(pio_spi_packet_get_alarm_pool(),
+                                                   PIO_SPI_LINK_RTO_US, link_rto_alarm, link, true);
+        link->rto_alarm = id > 0 ? id : 0;
+    }
+    pio_spi_link_poll(link);
+}
+
+void pio_spi_link_stop(pio_spi_link_t *link) {
+    pio_spi_packet_rx_stop(&link->prx);
+    if (link->rto_alarm) {
+        alarm_pool_cancel_alarm(pio_spi_packet_get_alarm_pool(), link->rto_alarm);
+        link->rto_alarm = 0;
+    }
+}
+
+void pio_spi_link_poll(pio_spi_link_t *link) {
+    uint32_t save = save_and_disable_interrupts();
+    link->credit_due = true;
+    link_kick(link);
+    restore_interrupts(save);
+}
@@ -0,0 +1,270 @@
+/**
+ * Bidirectional link with credit-based flow control
+ *
+ * Pairs a packet TX and packet RX to the same neighbour. The RX program
+ * pushes without blocking, so anything that arrives while no buffer is
+ * ready to take it is lost. Credits stop that from happening: a sender
+ * may only have as many packets outstanding as the far end has buffers
+ * set aside for it.
+ *
+ *   Node A                                     Node B
+ *   TX  --- data (1 credit each) ------------>  RX   holds the buffer
+ *   RX  <-- CREDIT {received, free} ---------  TX   once it's released
+ *
+ * Credits travel back as small link-local CREDIT packets in the reverse
+ * packet stream, so no extra pins are needed. Each one carries the
+ * receiver's running count of packets received plus its free buffers,
+ * rather than a delta, so a lost or corrupted update is repaired by the
+ * next one. Updates are coalesced: while one is waiting for the TX, later
+ * releases just make it carry a larger number.
+ *
+ * The FIFO only has to cover interrupt latency between packets, not a
+ * burst of them, so senders can run at the full link rate.
+ *
+ * Data goes out through a pull callback: whenever the link is idle and
+ * holds a credit it asks the owner for the next packet. Types from
+ * PIO_SPI_LINK_TYPE_RESERVED up belong to the link and never reach the
+ * owner.
+ *
+ * Reliable mode (pio_spi_link_set_reliable) adds per-hop sequence numbers
+ * in hdr.seq and keeps every data packet until the far end acknowledges
+ * it. CREDIT packets double as acknowledgements: the next sequence number
+ * expected plus a bitmap of later ones already held (selective ACK). A
+ * packet that fails its CRC shows up as a hole in the bitmap as soon as
+ * the next one lands, and only that packet is sent again, so a bit error
+ * costs one resend rather than an end-to-end timeout. Out-of-order
+ * packets wait in a reorder window so the owner still sees them in order.
+ * A lost final packet is caught by a retransmit timer. Both ends of a
+ * link must agree on the mode. Cut-through is not available on reliable
+ * links, since a streamed packet leaves no copy to resend.
+ */
+
+#ifndef PIO_SPI_LINK_H
+#define PIO_SPI_LINK_H
+
+#include "pio_spi_packet.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Receive buffers offered to the far end by default */
+#ifndef PIO_SPI_LINK_WINDOW
+#define PIO_SPI_LINK_WINDOW 4
+#endif
+
+/**
+ * Quiet time after which a credit update resets the sender's count
+ *
+ * Packets lost on the wire never reach the receiver's count, so each one
+ * would leak a credit. Once nothing can still be in flight, the
+ * receiver's count is the truth and the sender adopts it.
+ */
+#ifndef PIO_SPI_LINK_SETTLE_US
+#define PIO_SPI_LINK_SETTLE_US 1000
+#endif
+
+/** Largest window in reliable mode (sequence numbers in flight) */
+#define PIO_SPI_LINK_MAX_WINDOW 16
+
+/**
+ * Retransmit timer: the oldest unacknowledged packet is resent if nothing
+ * has been acknowledged for this long. Must cover the longest packet time
+ * in both directions.
+ */
+#ifndef PIO_SPI_LINK_RTO_US
+#define PIO_SPI_LINK_RTO_US 2000
+#endif
+
+/** Packet types from here up are link control */
+#define PIO_SPI_LINK_TYPE_RESERVED  0xfc
+#define PIO_SPI_LINK_TYPE_TRAIN     0xfe    // pio_spi_train.h, before the link starts
+#define PIO_SPI_LINK_TYPE_CREDIT    0xff
+
+/** Payload of a CREDIT packet */
+typedef struct {
+    uint32_t received;          // Data packets received so far
+    uint32_t free;              // Buffers free for more
+    uint8_t ack;                // Reliable: next sequence number expected
+    uint8_t reserved;
+    uint16_t sack;              // Reliable: bit i = ack + 1 + i already held
+} pio_spi_link_credit_t;
+
+/**
+ * Next packet to send (IRQ context, IRQs disabled)
+ *
+ * Returns a packet with its header complete, or NULL if nothing is waiting.
+ * Only called when a credit is available.
+ */
+typedef pio_spi_packet_t *(*pio_spi_link_pull_callback_t)(void *user_data);
+
+/**
+ * A pulled packet has been sent (acknowledged, in reliable mode) and its
+ * buffer may be reused (IRQ context)
+ */
+typedef void (*pio_spi_link_sent_callback_t)(pio_spi_packet_t *pkt, void *user_data);
+
+/** Spare receive buffer for the reorder window, or NULL (IRQ context) */
+typedef pio_spi_packet_t *(*pio_spi_link_alloc_callback_t)(void *user_data);
+
+typedef struct {
+    pio_spi_packet_tx_t ptx;
+    pio_spi_packet_rx_t prx;
+
+    // Sending side: credits granted by the far end
+    uint32_t tx_sent;           // Data packets sent
+    uint32_t tx_limit;          // Far end takes packets up to this count
+    uint32_t tx_last_us;        // When the last data packet went out
+    pio_spi_packet_t *tx_cur;   // Packet in flight (NULL if idle)
+    bool tx_reserved;           // Held for a cut-through stream
+
+    // Receiving side: credits granted to the far end
+    uint32_t rx_received;       // Data packets received
+    uint32_t rx_released;       // ... whose buffers are free again
+    uint window;                // Buffers offered in total
+    bool credit_due;            // Update waiting for the TX
+
+    // Reliable mode, sending side
+    bool reliable;
+    uint8_t tx_base;            // Oldest unacknowledged sequence number
+    uint8_t tx_next;            // Next new sequence number
+    uint16_t retx;              // Bit i: tx_base + i needs sending again
+    bool tx_cur_acked;          // Packet in flight was acknowledged meanwhile
+    uint32_t tx_order;          // Transmissions so far
+    uint32_t tx_progress_us;    // Last acknowledgement or timer resend
+    pio_spi_packet_t *unacked[PIO_SPI_LINK_MAX_WINDOW];     // By seq, NULL once acked
+    uint32_t unacked_order[PIO_SPI_LINK_MAX_WINDOW];        // tx_order of last send
+    alarm_id_t rto_alarm;
+
+    // Reliable mode, receiving side
+    uint8_t rx_expect;          // Next sequence number to deliver
+    uint16_t rx_held;           // Bit i: rx_expect + i is in the reorder window
+    pio_spi_packet_t *reorder[PIO_SPI_LINK_MAX_WINDOW];
+    pio_spi_packet_t *spare[PIO_SPI_LINK_MAX_WINDOW];
+    uint spare_count;
+    pio_spi_link_alloc_callback_t alloc;
+
+    uint32_t credits_sent;      // CREDIT packets sent
+    uint32_t credits_received;  // CREDIT packets received
+    uint32_t resyncs;           // Sender counts corrected from an update
+    uint32_t retransmits;       // Reliable: resent after a selective ACK gap
+    uint32_t timeouts;          // Reliable: resent by the timer
+    uint32_t duplicates;        // Reliable: received again and dropped
+    uint32_t reordered;         // Reliable: held until a gap was filled
+
+    pio_spi_packet_t ctrl;      // CREDIT packet buffer
+
+    pio_spi_link_pull_callback_t pull;
+    pio_spi_link_sent_callback_t sent;
+    pio_spi_packet_rx_callback_t callback;
+    void *user_data;
+} pio_spi_link_t;
+
+/**
+ * Set up a link over initialized TX and RX instances
+ *
+ * @param link   Link state
+ * @param tx     TX instance (owned by the link from now on)
+ * @param rx     RX instance (one-shot mode, owned by the link)
+ * @param rx_buf First receive buffer
+ * @param src    This node's address, written into CREDIT headers
+ * @param window Receive buffers this end will hold for the far end
+ * @return       false if no DMA channel was available for the CRC
+ */
+bool pio_spi_link_init(pio_spi_link_t *link, pio_spi_dma_tx_inst_t *tx,
+                       pio_spi_dma_rx_inst_t *rx, pio_spi_packet_t *rx_buf,
+                       uint16_t src, uint window);
+
+/**
+ * Set the owner's callbacks
+ *
+ * @param link      Link state
+ * @param pull      Supplies packets to send
+ * @param sent      Takes them back once sent
+ * @param callback  Receives data packets, as pio_spi_packet_rx_set_callback()
+ * @param user_data Passed to all three
+ *
+ * Every buffer the receive callback keeps (returns a different buffer
+ * for) holds one of the far end's credits until pio_spi_link_rx_release().
+ */
+void pio_spi_link_set_callbacks(pio_spi_link_t *link,
+                                pio_spi_link_pull_callback_t pull,
+                                pio_spi_link_sent_callback_t sent,
+                                pio_spi_packet_rx_callback_t callback,
+                                void *user_data);
+
+/**
+ * Switch to reliable mode (call before pio_spi_link_start)
+ *
+ * @param link  Link state
+ * @param alloc Supplies buffers to hold out-of-order packets. NULL drops
+ *              them instead (the sender resends them too: go-back-N).
+ *
+ * Window is capped at PIO_SPI_LINK_MAX_WINDOW.
+ */
+void pio_spi_link_set_reliable(pio_spi_link_t *link, pio_spi_link_alloc_callback_t alloc);
+
+/**
+ * Start receiving and advertise the window to the far end
+ */
+void pio_spi_link_start(pio_spi_link_t *link);
+
+/**
+ * Stop receiving
+ */
+void pio_spi_link_stop(pio_spi_link_t *link);
+
+/**
+ * Send if idle: call after making a packet available to the pull callback
+ */
+void pio_spi_link_kick(pio_spi_link_t *link);
+
+/**
+ * Re-send the credit state (call regularly; recovers a sender whose
+ * credits leaked through packets lost on the wire)
+ */
+void pio_spi_link_poll(pio_spi_link_t *link);
+
+/**
+ * A buffer kept by the receive callback is free again
+ */
+void pio_spi_link_rx_release(pio_spi_link_t *link);
+
+/**
+ * A data packet passed through without taking a buffer (cut-through),
+ * all of it has left the RX FIFO
+ */
+void pio_spi_link_rx_passed(pio_spi_link_t *link);
+
+/**
+ * Claim the idle TX for a cut-through stream, using one credit
+ *
+ * @return      false if busy, out of credits, an update is waiting or
+ *              the link is reliable
+ */
+bool pio_spi_link_tx_reserve(pio_spi_link_t *link);
+
+/**
+ * Hand back a TX claimed with pio_spi_link_tx_reserve()
+ */
+void pio_spi_link_tx_unreserve(pio_spi_link_t *link);
+
+/**
+ * Credits this end currently holds to send with
+ */
+static inline uint pio_spi_link_tx_credits(const pio_spi_link_t *link) {
+    return link->tx_limit - link->tx_sent;
+}
+
+/**
+ * Whether a packet or cut-through stream is in progress
+ */
+static inline bool pio_spi_link_tx_busy(const pio_spi_link_t *link) {
+    return link->tx_cur || link->tx_reserved;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIO_SPI_LINK_H
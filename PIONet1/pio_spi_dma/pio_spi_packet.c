@@ -0,0 +1,689 @@
+/**
+ * Packet layer for pio_spi_dma links with DMA sniffer CRC-32
+ */
+
+#include "pio_spi_packet.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include <string.h>
+
+// ============================================================================
+// CRC-32
+// ============================================================================
+
+// Reflected IEEE 802.3 polynomial, one nibble at a time (64 byte table)
+static const uint32_t crc32_nibble[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+    0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+    0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+};
+
+uint32_t PIO_SPI_DMA_HOT(pio_spi_packet_crc32)(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *p = data;
+
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0xf];
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0xf];
+    }
+    return ~crc;
+}
+
+// ============================================================================
+// Timers
+// ============================================================================
+
+static alarm_pool_t *timer_pool;
+
+void pio_spi_packet_set_alarm_pool(alarm_pool_t *pool) {
+    timer_pool = pool;
+}
+
+alarm_pool_t *pio_spi_packet_get_alarm_pool(void) {
+    return timer_pool ? timer_pool : alarm_pool_get_default();
+}
+
+// ============================================================================
+// Sniffer Ownership
+// ============================================================================
+
+// One sniffer per chip: whichever channel takes it first keeps it until
+// its packet (or CRC) is complete
+static volatile int sniffer_owner = -1;
+
+static bool PIO_SPI_DMA_HOT(sniffer_acquire)(uint chan) {
+    uint32_t save = save_and_disable_interrupts();
+    if (sniffer_owner < 0) {
+        sniffer_owner = (int)chan;
+    }
+    bool ok = sniffer_owner == (int)chan;
+    restore_interrupts(save);
+    return ok;
+}
+
+static void PIO_SPI_DMA_HOT(sniffer_release)(uint chan) {
+    if (sniffer_owner == (int)chan) {
+        dma_sniffer_disable();
+        sniffer_owner = -1;
+    }
+}
+
+static void PIO_SPI_DMA_HOT(sniffer_start)(uint chan, bool bswap) {
+    // CRC32R + reversed, inverted output = zlib CRC-32 over the byte stream.
+    // dma_sniffer_enable() rewrites the whole control register, so it goes first.
+    dma_sniffer_enable(chan, DMA_SNIFF_CTRL_CALC_VALUE_CRC32R, false);
+    dma_sniffer_set_byte_swap_enabled(bswap);
+    dma_sniffer_set_output_reverse_enabled(true);
+    dma_sniffer_set_output_invert_enabled(true);
+    dma_sniffer_set_data_accumulator(0xffffffff);
+}
+
+static inline uint32_t bit_reverse32(uint32_t v) {
+    v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+    v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+    v = ((v >> 4) & 0x0f0f0f0fu) | ((v & 0x0f0f0f0fu) << 4);
+    return __builtin_bswap32(v);
+}
+
+// Carry on from bytes already covered in software. Output reverse and
+// invert only apply on read, so the register holds the running CRC
+// reversed and uninverted (0xffffffff above is the empty-input case).
+static void PIO_SPI_DMA_HOT(sniffer_continue)(uint32_t crc) {
+    dma_sniffer_set_data_accumulator(bit_reverse32(~crc));
+}
+
+bool pio_spi_packet_crc32_dma(uint chan, const void *data, size_t len, uint32_t *crc) {
+    if (!sniffer_acquire(chan)) return false;
+
+    static uint32_t sink;
+    size_t words = len / 4;
+
+    // Word reads with byte swap give the same CRC as the byte stream
+    sniffer_start(chan, true);
+    if (words) {
+        dma_channel_config c = dma_channel_get_default_config(chan);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_sniff_enable(&c, true);
+        dma_channel_configure(chan, &c, &sink, data, words, true);
+        dma_channel_wait_for_finish_blocking(chan);
+    }
+    uint32_t v = dma_sniffer_get_data_accumulator();
+    sniffer_release(chan);
+
+    *crc = pio_spi_packet_crc32(v, (const uint8_t *)data + words * 4, len & 3u);
+    return true;
+}
+
+static inline void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Header words straight into a TX FIFO, in the order DMA would send them
+static void PIO_SPI_DMA_HOT(put_header)(pio_spi_dma_tx_inst_t *tx, const pio_spi_packet_hdr_t *hdr) {
+    if (tx->width == PIO_SPI_DMA_WIDTH_32) {
+        const uint32_t *w = (const uint32_t *)hdr;
+        pio_sm_put_blocking(tx->pio, tx->sm, __builtin_bswap32(w[0]));
+        pio_sm_put_blocking(tx->pio, tx->sm, __builtin_bswap32(w[1]));
+    } else {
+        const uint8_t *b = (const uint8_t *)hdr;
+        for (uint i = 0; i < sizeof(*hdr); i++) {
+            pio_sm_put_blocking(tx->pio, tx->sm, (uint32_t)b[i] << 24);
+        }
+    }
+}
+
+// ============================================================================
+// Packet TX
+// ============================================================================
+
+static void PIO_SPI_DMA_HOT(packet_tx_done)(pio_spi_packet_tx_t *ptx) {
+    ptx->busy = false;
+    if (ptx->callback) {
+        ptx->callback(ptx->callback_data);
+    }
+}
+
+// CRC channel finished: sniffer result is in the TX FIFO, so the whole
+// packet is queued
+static void PIO_SPI_DMA_HOT(packet_tx_crc_irq)(void *user_data) {
+    pio_spi_packet_tx_t *ptx = user_data;
+
+    // Back to the driver's own config (no sniff, no chain)
+    dma_channel_set_config(ptx->tx->dma_chan, &ptx->data_config, false);
+    sniffer_release(ptx->tx->dma_chan);
+    pio_spi_dma_tx_drain(ptx->tx);
+}
+
+// Driver TX callback: the packet's last bit has left the pin (every
+// packet ends here, chained CRC or not)
+static void PIO_SPI_DMA_HOT(packet_tx_wire_done)(void *user_data) {
+    packet_tx_done(user_data);
+}
+
+bool pio_spi_packet_tx_init(pio_spi_packet_tx_t *ptx, pio_spi_dma_tx_inst_t *tx,
+                            uint16_t src) {
+    memset(ptx, 0, sizeof(*ptx));
+    ptx->tx = tx;
+    ptx->src = src;
+    ptx->sg.ctrl_chan = -1;
+
+    ptx->crc_chan = dma_claim_unused_channel(false);
+    if (ptx->crc_chan < 0) {
+        return false;
+    }
+
+    // Data channel: remember the driver's config and a sniffing variant
+    // that hands over to the CRC channel when the payload is done
+    ptx->data_config = dma_get_channel_config(tx->dma_chan);
+    ptx->chain_config = ptx->data_config;
+    channel_config_set_chain_to(&ptx->chain_config, ptx->crc_chan);
+    channel_config_set_irq_quiet(&ptx->chain_config, true);     // CRC channel ends the frame
+    ptx->sniff_config = ptx->chain_config;
+    channel_config_set_sniff_enable(&ptx->sniff_config, true);
+
+    // CRC channel: sniffer result (or crc_word) -> TX FIFO, LSB first on
+    // the wire. Word links send it as one swapped word like any payload
+    // word; byte links read it a byte lane at a time, so the read address
+    // is set again for every packet.
+    dma_channel_config c = dma_channel_get_default_config(ptx->crc_chan);
+    channel_config_set_transfer_data_size(&c, (enum dma_channel_transfer_size)tx->width);
+    channel_config_set_bswap(&c, tx->width == PIO_SPI_DMA_WIDTH_32);
+    channel_config_set_read_increment(&c, tx->width == PIO_SPI_DMA_WIDTH_8);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(tx->pio, tx->sm, true));  // true = TX
+
+    dma_channel_configure(
+        ptx->crc_chan,
+        &c,
+        &tx->pio->txf[tx->sm],          // Write to PIO TX FIFO
+        &dma_hw->sniff_data,            // Read sniffer result
+        4 >> tx->width,                 // One word or four bytes
+        false                           // Triggered by chain
+    );
+
+    pio_spi_dma_channel_set_irq_callback(ptx->crc_chan, tx->irq_index, packet_tx_crc_irq, ptx);
+    pio_spi_dma_tx_set_callback(tx, packet_tx_wire_done, ptx);
+    return true;
+}
+
+bool PIO_SPI_DMA_HOT(pio_spi_packet_send)(pio_spi_packet_tx_t *ptx, pio_spi_packet_t *pkt,
+                                          uint16_t dst, uint8_t type, size_t len) {
+    if (ptx->busy || len > PIO_SPI_PACKET_MAX_PAYLOAD) {
+        return false;
+    }
+
+    pkt->hdr.dst = dst;
+    pkt->hdr.src = ptx->src;
+    pkt->hdr.type = type;
+    pkt->hdr.seq = ptx->seq++;
+    pkt->hdr.len = (uint16_t)len;
+
+    return pio_spi_packet_forward(ptx, pkt);
+}
+
+bool PIO_SPI_DMA_HOT(pio_spi_packet_forward)(pio_spi_packet_tx_t *ptx, pio_spi_packet_t *pkt) {
+    size_t len = pkt->hdr.len;
+    if (ptx->busy || len > PIO_SPI_PACKET_MAX_PAYLOAD) {
+        return false;
+    }
+
+    // Zero the pad so the CRC doesn't depend on stale bytes
+    size_t padded = pio_spi_packet_padded_len(len);
+    for (size_t i = len; i < padded; i++) {
+        pkt->payload[i] = 0;
+    }
+
+    size_t body = sizeof(pkt->hdr) + padded;
+    uint chan = ptx->tx->dma_chan;
+    ptx->busy = true;
+    ptx->hw_crc = sniffer_acquire(chan);
+
+    if (ptx->hw_crc) {
+        // Sniffer sees words after the channel's byte swap; undo it so the
+        // CRC runs over bytes in wire order
+        dma_channel_set_read_addr(ptx->crc_chan, &dma_hw->sniff_data, false);
+        dma_channel_set_config(chan, &ptx->sniff_config, false);
+        sniffer_start(chan, ptx->tx->width == PIO_SPI_DMA_WIDTH_32);
+        ptx->hw_packets++;
+        pio_spi_dma_tx_start_frame(ptx->tx, (const uint8_t *)pkt, body, body + 4);
+    } else {
+        put_le32(&pkt->payload[padded], pio_spi_packet_crc32(0, pkt, body));
+        ptx->sw_packets++;
+        pio_spi_dma_tx_start(ptx->tx, (const uint8_t *)pkt, body + 4);
+    }
+    return true;
+}
+
+bool PIO_SPI_DMA_HOT(pio_spi_packet_forward_hdr)(pio_spi_packet_tx_t *ptx, pio_spi_packet_t *pkt,
+                                                 const pio_spi_packet_hdr_t *hdr) {
+    size_t len = hdr->len;
+    if (ptx->busy || len > PIO_SPI_PACKET_MAX_PAYLOAD) {
+        return false;
+    }
+
+    // The buffer may be going out of other links at the same time: only
+    // the pad is written (to the same zeros), header and CRC stay private
+    size_t padded = pio_spi_packet_padded_len(len);
+    for (size_t i = len; i < padded; i++) {
+        pkt->payload[i] = 0;
+    }
+
+    pio_spi_dma_tx_inst_t *tx = ptx->tx;
+    uint chan = tx->dma_chan;
+    uint32_t crc = pio_spi_packet_crc32(0, hdr, sizeof(*hdr));
+    ptx->busy = true;
+    ptx->hw_crc = padded && sniffer_acquire(chan);
+
+    if (ptx->hw_crc) {
+        dma_channel_set_read_addr(ptx->crc_chan, &dma_hw->sniff_data, false);
+        dma_channel_set_config(chan, &ptx->sniff_config, false);
+        sniffer_start(chan, tx->width == PIO_SPI_DMA_WIDTH_32);
+        sniffer_continue(crc);
+        ptx->hw_packets++;
+    } else {
+        ptx->crc_word = pio_spi_packet_crc32(crc, pkt->payload, padded);
+        dma_channel_set_read_addr(ptx->crc_chan, &ptx->crc_word, false);
+        dma_channel_set_config(chan, &ptx->chain_config, false);
+        ptx->sw_packets++;
+    }
+
+    // Frame and header go in by hand (a few FIFO entries; waits only for
+    // the tail of the previous packet), then DMA takes over
+    pio_spi_dma_tx_begin_frame(tx, pio_spi_packet_wire_len(len));
+    put_header(tx, hdr);
+    if (padded) {
+        pio_spi_dma_tx_continue_frame(tx, pkt->payload, padded);
+    } else {
+        dma_channel_start(ptx->crc_chan);
+    }
+    return true;
+}
+
+bool pio_spi_packet_tx_sg_init(pio_spi_packet_tx_t *ptx) {
+    return pio_spi_dma_tx_sg_init(&ptx->sg, ptx->tx);
+}
+
+// Zeros for the pad after an odd-length payload on byte links (SRAM, not XIP)
+static uint8_t sg_pad[4];
+
+bool PIO_SPI_DMA_HOT(pio_spi_packet_send_sg)(pio_spi_packet_tx_t *ptx, uint16_t dst, uint8_t type,
+                                             const pio_spi_dma_iovec_t *iov, uint count) {
+    pio_spi_dma_tx_inst_t *tx = ptx->tx;
+    if (ptx->busy || ptx->sg.ctrl_chan < 0 || count > PIO_SPI_PACKET_SG_MAX_SEGS) {
+        return false;
+    }
+
+    size_t len = 0;
+    for (uint i = 0; i < count; i++) {
+        if (tx->width == PIO_SPI_DMA_WIDTH_32 && (iov[i].len & 3u)) {
+            return false;
+        }
+        len += iov[i].len;
+    }
+    if (len > PIO_SPI_PACKET_MAX_PAYLOAD) {
+        return false;
+    }
+
+    pio_spi_packet_hdr_t *hdr = &ptx->sg_hdr;
+    hdr->dst = dst;
+    hdr->src = ptx->src;
+    hdr->type = type;
+    hdr->seq = ptx->seq++;
+    hdr->len = (uint16_t)len;
+
+    // Header, payload, pad: the CRC channel follows the last of them
+    pio_spi_dma_iovec_t seg[PIO_SPI_DMA_SG_MAX_SEGS];
+    uint n = 0;
+    seg[n].base = hdr;
+    seg[n++].len = sizeof(*hdr);
+    for (uint i = 0; i < count; i++) {
+        seg[n++] = iov[i];
+    }
+    seg[n].base = sg_pad;
+    seg[n++].len = pio_spi_packet_padded_len(len) - len;
+
+    uint chan = tx->dma_chan;
+    const dma_channel_config *config;
+    ptx->busy = true;
+    ptx->hw_crc = sniffer_acquire(chan);
+
+    if (ptx->hw_crc) {
+        dma_channel_set_read_addr(ptx->crc_chan, &dma_hw->sniff_data, false);
+        sniffer_start(chan, tx->width == PIO_SPI_DMA_WIDTH_32);
+        config = &ptx->sniff_config;
+        ptx->hw_packets++;
+    } else {
+        uint32_t crc = 0;
+        for (uint i = 0; i < n; i++) {
+            crc = pio_spi_packet_crc32(crc, seg[i].base, seg[i].len);
+        }
+        ptx->crc_word = crc;
+        dma_channel_set_read_addr(ptx->crc_chan, &ptx->crc_word, false);
+        config = &ptx->chain_config;
+        ptx->sw_packets++;
+    }
+
+    pio_spi_dma_tx_sg_start_frame(&ptx->sg, seg, n, pio_spi_packet_wire_len(len), config);
+    return true;
+}
+
+void pio_spi_packet_tx_wait(pio_spi_packet_tx_t *ptx) {
+    // Cleared by the on-wire completion; sleep until an interrupt sets it
+    while (ptx->busy) {
+        __wfe();
+    }
+}
+
+void pio_spi_packet_tx_set_callback(pio_spi_packet_tx_t *ptx,
+                                    pio_spi_dma_callback_t callback,
+                                    void *user_data) {
+    ptx->callback = callback;
+    ptx->callback_data = user_data;
+}
+
+void pio_spi_packet_tx_deinit(pio_spi_packet_tx_t *ptx) {
+    pio_spi_dma_tx_set_callback(ptx->tx, NULL, NULL);
+
+    pio_spi_dma_tx_sg_deinit(&ptx->sg);
+
+    if (ptx->crc_chan >= 0) {
+        pio_spi_dma_channel_set_irq_callback(ptx->crc_chan, ptx->tx->irq_index, NULL, NULL);
+        dma_channel_abort(ptx->crc_chan);
+        dma_channel_unclaim(ptx->crc_chan);
+        ptx->crc_chan = -1;
+    }
+
+    dma_channel_set_config(ptx->tx->dma_chan, &ptx->data_config, false);
+    sniffer_release(ptx->tx->dma_chan);
+    ptx->busy = false;
+}
+
+// ============================================================================
+// Packet RX
+// ============================================================================
+
+enum {
+    RX_IDLE,
+    RX_HEADER,
+    RX_PAYLOAD,
+    RX_CRC,
+    RX_CUT_THROUGH
+};
+
+static void PIO_SPI_DMA_HOT(packet_rx_arm)(pio_spi_packet_rx_t *prx) {
+    uint chan = prx->rx->dma_chan;
+
+    prx->state = RX_HEADER;
+    prx->hw_crc = sniffer_acquire(chan);
+    if (prx->hw_crc) {
+        // RX words are already swapped into memory order, sniff as-is
+        dma_channel_set_config(chan, &prx->hdr_sniff_config, false);
+        sniffer_start(chan, false);
+    } else {
+        dma_channel_set_config(chan, &prx->hdr_config, false);
+    }
+
+    pio_spi_dma_rx_start(prx->rx, (uint8_t *)prx->pkt, sizeof(pio_spi_packet_hdr_t));
+}
+
+static int64_t packet_rx_resync_alarm(alarm_id_t id, void *user_data) {
+    (void)id;
+    pio_spi_packet_rx_t *prx = user_data;
+
+    // Still receiving the rest of the bad frame: wait for a quiet line
+    if (!pio_sm_is_rx_fifo_empty(prx->rx->pio, prx->rx->sm)) {
+        pio_spi_dma_rx_flush(prx->rx);
+        return PIO_SPI_PACKET_RESYNC_US;
+    }
+
+    prx->resync_alarm = 0;
+    if (prx->running) {
+        packet_rx_arm(prx);
+    }
+    return 0;
+}
+
+// Framing lost: drop everything until the line goes idle, then re-arm
+static void packet_rx_resync(pio_spi_packet_rx_t *prx) {
+    uint chan = prx->rx->dma_chan;
+
+    prx->state = RX_IDLE;
+    if (prx->hw_crc) {
+        dma_channel_set_config(chan, &prx->data_config, false);
+        sniffer_release(chan);
+    }
+
+    pio_spi_dma_rx_abort(prx->rx);
+    pio_spi_dma_rx_flush(prx->rx);
+
+    alarm_id_t id = alarm_pool_add_alarm_in_us(pio_spi_packet_get_alarm_pool(),
+                                               PIO_SPI_PACKET_RESYNC_US,
+                                               packet_rx_resync_alarm, prx, true);
+    prx->resync_alarm = id > 0 ? id : 0;
+}
+
+// Header and payload are in: take the CRC and fetch the wire CRC word
+static void PIO_SPI_DMA_HOT(packet_rx_fetch_crc)(pio_spi_packet_rx_t *prx, size_t padded) {
+    uint chan = prx->rx->dma_chan;
+
+    if (prx->hw_crc) {
+        prx->crc = dma_sniffer_get_data_accumulator();
+        dma_channel_set_config(chan, &prx->data_config, false);
+        sniffer_release(chan);
+    }
+
+    prx->state = RX_CRC;
+    pio_spi_dma_rx_start(prx->rx, &prx->pkt->payload[padded], 4);
+}
+
+bool PIO_SPI_DMA_HOT(pio_spi_packet_can_cut_through)(const pio_spi_packet_rx_t *prx,
+                                                     const pio_spi_dma_tx_inst_t *tx) {
+    // FIFO words are copied raw, so both ends must agree on their layout,
+    // and the rebuilt header has to fit in the TX FIFO without blocking.
+    // Nothing paces the copy to the TX, so it must drain bytes at least as
+    // fast as they arrive (cycles per byte: clock_cycles * 8 / lanes).
+    uint hdr_entries = sizeof(pio_spi_packet_hdr_t) >> tx->width;
+    return tx->width == prx->rx->width &&
+           tx->framed == prx->rx->framed &&
+           (prx->in_clock_cycles == 0 ||
+            tx->clock_cycles * prx->rx->lanes <= prx->in_clock_cycles * tx->lanes) &&
+           pio_sm_get_tx_fifo_level(tx->pio, tx->sm) + hdr_entries + tx->framed <= 8;
+}
+
+// Header is in and the route says forward: rebuild it in the outgoing TX
+// FIFO, then point the RX channel at that FIFO for the rest of the packet
+static void PIO_SPI_DMA_HOT(packet_rx_cut_through)(pio_spi_packet_rx_t *prx,
+                                                   pio_spi_dma_tx_inst_t *tx) {
+    uint chan = prx->rx->dma_chan;
+    pio_spi_packet_t *pkt = prx->pkt;
+    size_t len = pio_spi_packet_wire_len(pkt->hdr.len);
+
+    // Transit packets are checked end to end, not per hop
+    if (prx->hw_crc) {
+        sniffer_release(chan);
+        prx->hw_crc = false;
+    }
+
+    pio_spi_dma_tx_begin_frame(tx, len);
+    put_header(tx, &pkt->hdr);          // Room checked by can_cut_through
+
+    // RX FIFO -> TX FIFO, paced by RX. The TX side drains at least as fast
+    // (can_cut_through); if it gets ahead it just stalls the outgoing clock.
+    prx->state = RX_CUT_THROUGH;
+    prx->cut_tx = tx;
+    prx->cut_through++;
+    dma_channel_set_config(chan, &prx->cut_config, false);
+    pio_spi_dma_rx_start(prx->rx, (uint8_t *)&tx->pio->txf[tx->sm], len - sizeof(pkt->hdr));
+}
+
+static void PIO_SPI_DMA_HOT(packet_rx_irq)(void *user_data) {
+    pio_spi_packet_rx_t *prx = user_data;
+    pio_spi_packet_t *pkt = prx->pkt;
+    size_t padded = pio_spi_packet_padded_len(pkt->hdr.len);
+
+    switch (prx->state) {
+    case RX_HEADER:
+        // Arrival is the header's stamp: the rest of the packet runs unchained
+        prx->stamp = prx->rx->stamp_chan >= 0 ? prx->rx->stamp : timer_hw->timerawl;
+        dma_channel_set_config(prx->rx->dma_chan,
+                               prx->hw_crc ? &prx->sniff_config : &prx->data_config, false);
+        if (pkt->hdr.len > PIO_SPI_PACKET_MAX_PAYLOAD) {
+            prx->length_errors++;
+            prx->rx->stats.aborted++;
+            packet_rx_resync(prx);
+            break;
+        }
+        if (prx->route) {
+            pio_spi_dma_tx_inst_t *tx = prx->route(&pkt->hdr, prx->route_data);
+            if (tx) {
+                packet_rx_cut_through(prx, tx);
+                break;
+            }
+        }
+        if (padded) {
+            prx->state = RX_PAYLOAD;
+            pio_spi_dma_rx_start(prx->rx, pkt->payload, padded);
+        } else {
+            packet_rx_fetch_crc(prx, 0);
+        }
+        break;
+
+    case RX_PAYLOAD:
+        packet_rx_fetch_crc(prx, padded);
+        break;
+
+    case RX_CRC:
+        if (!prx->hw_crc) {
+            prx->crc = pio_spi_packet_crc32(0, pkt, sizeof(pkt->hdr) + padded);
+        }
+
+        // A bad CRC with a sane length usually means bit errors, not lost
+        // framing, so carry straight on with the next packet
+        prx->rx->stats.frames++;
+        if (get_le32(&pkt->payload[padded]) == prx->crc) {
+            prx->packets++;
+            prx->hw_packets += prx->hw_crc;
+            *(uint32_t *)&pkt->payload[padded] = prx->stamp;
+            if (prx->callback) {
+                prx->pkt = prx->callback(pkt, prx->callback_data);
+            }
+        } else {
+            prx->crc_errors++;
+            prx->rx->stats.crc_errors++;
+        }
+
+        if (prx->running) {
+            packet_rx_arm(prx);
+        } else {
+            prx->state = RX_IDLE;
+        }
+        break;
+
+    case RX_CUT_THROUGH: {
+        // Whole packet is in the TX FIFO (not necessarily on the wire yet)
+        pio_spi_dma_tx_inst_t *tx = prx->cut_tx;
+        prx->cut_tx = NULL;
+        prx->rx->stats.frames++;
+        if (prx->cut_done) {
+            prx->cut_done(tx, prx->route_data);
+        }
+
+        if (prx->running) {
+            packet_rx_arm(prx);
+        } else {
+            dma_channel_set_config(prx->rx->dma_chan, &prx->hdr_config, false);
+            prx->state = RX_IDLE;
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+void pio_spi_packet_rx_init(pio_spi_packet_rx_t *prx, pio_spi_dma_rx_inst_t *rx,
+                            pio_spi_packet_t *pkt) {
+    memset(prx, 0, sizeof(*prx));
+    prx->rx = rx;
+    prx->pkt = pkt;
+    prx->state = RX_IDLE;
+
+    // Only the header transfer triggers the timestamp channel
+    // (pio_spi_dma_rx_set_timestamps()); chaining to itself is no chain
+    prx->hdr_config = dma_get_channel_config(rx->dma_chan);
+    prx->hdr_sniff_config = prx->hdr_config;
+    channel_config_set_sniff_enable(&prx->hdr_sniff_config, true);
+    prx->data_config = prx->hdr_config;
+    channel_config_set_chain_to(&prx->data_config, rx->dma_chan);
+    prx->sniff_config = prx->data_config;
+    channel_config_set_sniff_enable(&prx->sniff_config, true);
+
+    // FIFO to FIFO: fixed destination and no swap (both FIFOs hold wire order)
+    prx->cut_config = prx->data_config;
+    channel_config_set_write_increment(&prx->cut_config, false);
+    channel_config_set_bswap(&prx->cut_config, false);
+
+    pio_spi_dma_rx_set_callback(rx, packet_rx_irq, prx);
+}
+
+void pio_spi_packet_rx_set_callback(pio_spi_packet_rx_t *prx,
+                                    pio_spi_packet_rx_callback_t callback,
+                                    void *user_data) {
+    prx->callback = callback;
+    prx->callback_data = user_data;
+}
+
+void pio_spi_packet_rx_set_cut_through(pio_spi_packet_rx_t *prx,
+                                       pio_spi_packet_route_callback_t route,
+                                       pio_spi_packet_cut_done_callback_t done,
+                                       void *user_data) {
+    prx->route = route;
+    prx->cut_done = done;
+    prx->route_data = user_data;
+}
+
+void pio_spi_packet_rx_set_rate(pio_spi_packet_rx_t *prx, float freq_hz) {
+    prx->in_clock_cycles = freq_hz > 0 ? (uint32_t)((float)clock_get_hz(clk_sys) * 256.0f / freq_hz) : 0;
+}
+
+void pio_spi_packet_rx_start(pio_spi_packet_rx_t *prx) {
+    if (prx->running) return;
+
+    prx->running = true;
+    pio_spi_dma_rx_flush(prx->rx);
+    packet_rx_arm(prx);
+}
+
+void pio_spi_packet_rx_stop(pio_spi_packet_rx_t *prx) {
+    prx->running = false;
+
+    if (prx->resync_alarm) {
+        alarm_pool_cancel_alarm(pio_spi_packet_get_alarm_pool(), prx->resync_alarm);
+        prx->resync_alarm = 0;
+    }
+
+    uint chan = prx->rx->dma_chan;
+    pio_spi_dma_rx_abort(prx->rx);
+    dma_channel_set_config(chan, &prx->hdr_config, false);
+    sniffer_release(chan);
+
+    // Hand back a link we were streaming into (its frame is cut short)
+    if (prx->state == RX_CUT_THROUGH && prx->cut_done) {
+        prx->cut_done(prx->cut_tx, prx->route_data);
+    }
+    prx->cut_tx = NULL;
+    prx->state = RX_IDLE;
+}
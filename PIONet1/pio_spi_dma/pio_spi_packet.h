@@ -0,0 +1,390 @@
+/**
+ * Packet layer for pio_spi_dma links with DMA sniffer CRC-32
+ *
+ * Adds addressing, typing, sequencing and integrity checking on top of the
+ * raw byte stream. While a packet is in flight the RP2350 DMA sniffer
+ * watches the link's own data channel and accumulates a CRC-32, so
+ * checking costs no CPU cycles:
+ *
+ *   TX: the data channel chains to a small CRC channel that copies the
+ *       sniffer result straight into the PIO TX FIFO behind the payload.
+ *   RX: header and payload land with the sniffer running; the CRC word
+ *       that follows is compared against the sniffer result in the IRQ.
+ *
+ * Wire format (one CS frame in framed modes):
+ *
+ *   +--------+--------+------+-----+--------+-----------------+--------+
+ *   | dst:16 | src:16 | type | seq | len:16 | payload + pad   | CRC-32 |
+ *   +--------+--------+------+-----+--------+-----------------+--------+
+ *    <------------ 8-byte header ----------> <- len rounded -> <- 4 -->
+ *                                                up to 4
+ *
+ * Multi-byte fields are little-endian. The CRC is the zlib/IEEE 802.3
+ * CRC-32 over header and padded payload, sent least-significant byte first.
+ * Padding keeps every part a whole number of words for 32-bit links.
+ *
+ * The chip has a single sniffer. Each transfer takes it if free and
+ * falls back to pio_spi_packet_crc32() in software otherwise, so any
+ * number of links work and the first one active gets the hardware.
+ */
+
+#ifndef PIO_SPI_PACKET_H
+#define PIO_SPI_PACKET_H
+
+#include "pio_spi_dma.h"
+#include "pico/time.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Packet Format
+// ============================================================================
+
+/** Largest payload in bytes (multiple of 4) */
+#ifndef PIO_SPI_PACKET_MAX_PAYLOAD
+#define PIO_SPI_PACKET_MAX_PAYLOAD 1024
+#endif
+
+/** Idle time on the line before RX re-arms after a bad header */
+#ifndef PIO_SPI_PACKET_RESYNC_US
+#define PIO_SPI_PACKET_RESYNC_US 200
+#endif
+
+/** Destination address that every node accepts */
+#define PIO_SPI_PACKET_BROADCAST 0xffff
+
+typedef struct {
+    uint16_t dst;               // Destination node address
+    uint16_t src;               // Source node address
+    uint8_t type;               // Application-defined packet type
+    uint8_t seq;                // Per-sender sequence number (per hop on reliable links)
+    uint16_t len;               // Payload length in bytes (before padding)
+} pio_spi_packet_hdr_t;
+
+/** Packet buffer: wire image of header, payload and CRC */
+typedef struct __attribute__((aligned(4))) {
+    pio_spi_packet_hdr_t hdr;
+    uint8_t payload[PIO_SPI_PACKET_MAX_PAYLOAD + 4];   // + room for the CRC
+} pio_spi_packet_t;
+
+/** Payload length rounded up to whole words */
+static inline size_t pio_spi_packet_padded_len(size_t len) {
+    return (len + 3u) & ~(size_t)3u;
+}
+
+/** Bytes on the wire for a packet with len payload bytes */
+static inline size_t pio_spi_packet_wire_len(size_t len) {
+    return sizeof(pio_spi_packet_hdr_t) + pio_spi_packet_padded_len(len) + 4;
+}
+
+/**
+ * Software CRC-32 (zlib compatible, same result as the sniffer)
+ *
+ * @param crc   Previous CRC (0 to start)
+ * @param data  Bytes to add
+ * @param len   Number of bytes
+ * @return      Updated CRC
+ */
+uint32_t pio_spi_packet_crc32(uint32_t crc, const void *data, size_t len);
+
+/**
+ * CRC-32 of a memory block on a DMA channel with the sniffer
+ *
+ * @param chan  Claimed idle DMA channel (left IRQ-quiet)
+ * @param data  Block (word aligned)
+ * @param len   Number of bytes (a tail under one word is done in software)
+ * @param crc   Receives the CRC (same as pio_spi_packet_crc32(0, data, len))
+ * @return      false if a link holds the sniffer; try again later
+ *
+ * Blocks for one DMA read of the block, about a word per system clock.
+ */
+bool pio_spi_packet_crc32_dma(uint chan, const void *data, size_t len, uint32_t *crc);
+
+/**
+ * Alarm pool for packet and link timers (resync, retransmit)
+ *
+ * @param pool  Pool to use, or NULL for the SDK default pool
+ *
+ * Timer callbacks run on the core that created their pool. Set this
+ * before bringing links up when they are driven from another core.
+ */
+void pio_spi_packet_set_alarm_pool(alarm_pool_t *pool);
+
+/** Alarm pool for packet and link timers (never NULL) */
+alarm_pool_t *pio_spi_packet_get_alarm_pool(void);
+
+// ============================================================================
+// Packet TX
+// ============================================================================
+
+typedef struct {
+    pio_spi_dma_tx_inst_t *tx;
+    uint16_t src;               // This node's address
+    uint8_t seq;                // Next sequence number
+    int crc_chan;               // Sniffer-to-FIFO channel (-1 if unclaimed)
+    dma_channel_config data_config;     // Data channel as the driver set it up
+    dma_channel_config chain_config;    // Same, chained to crc_chan
+    dma_channel_config sniff_config;    // Same, also sniffed
+    uint32_t crc_word;          // Software CRC for crc_chan to send
+    pio_spi_dma_tx_sg_t sg;     // Scatter-gather sending (sg.ctrl_chan -1 if off)
+    pio_spi_packet_hdr_t sg_hdr;        // Header of the scatter-gather packet in flight
+    bool hw_crc;                // Current packet's CRC comes from the sniffer
+    volatile bool busy;
+    uint32_t hw_packets;        // Packets sent with sniffer CRC
+    uint32_t sw_packets;        // Packets sent with software CRC
+    pio_spi_dma_callback_t callback;
+    void *callback_data;
+} pio_spi_packet_tx_t;
+
+/**
+ * Attach a packet sender to an initialized TX link
+ *
+ * @param ptx   Packet TX state
+ * @param tx    TX instance (owned by the packet layer from now on)
+ * @param src   This node's address, written into every header
+ * @return      false if no DMA channel was available for the CRC
+ */
+bool pio_spi_packet_tx_init(pio_spi_packet_tx_t *ptx, pio_spi_dma_tx_inst_t *tx,
+                            uint16_t src);
+
+/**
+ * Send a packet (non-blocking)
+ *
+ * @param ptx   Packet TX state
+ * @param pkt   Packet with payload filled in (must remain valid until done)
+ * @param dst   Destination address
+ * @param type  Packet type
+ * @param len   Payload length (<= PIO_SPI_PACKET_MAX_PAYLOAD)
+ * @return      false if a packet is still in flight or len is too large
+ *
+ * Fills in the header and pads the payload. The CRC goes out of the
+ * sniffer with no CPU work when it is free.
+ */
+bool pio_spi_packet_send(pio_spi_packet_tx_t *ptx, pio_spi_packet_t *pkt,
+                         uint16_t dst, uint8_t type, size_t len);
+
+/**
+ * Send a packet with its header as-is (non-blocking)
+ *
+ * @param ptx   Packet TX state
+ * @param pkt   Packet with header and payload filled in
+ * @return      false if a packet is still in flight or the length is too large
+ *
+ * For forwarding: src and seq are left as the originating node set them.
+ */
+bool pio_spi_packet_forward(pio_spi_packet_tx_t *ptx, pio_spi_packet_t *pkt);
+
+/**
+ * Send a packet's payload under a different header (non-blocking)
+ *
+ * @param ptx   Packet TX state
+ * @param pkt   Packet with payload filled in; pkt->hdr is not read or written
+ * @param hdr   Header to send in its place (copied before returning)
+ * @return      false if a packet is still in flight or the length is too large
+ *
+ * For link layers that rewrite per-hop fields. Header and CRC never touch
+ * the buffer, so one buffer can go out of several links at once with a
+ * different header on each.
+ */
+bool pio_spi_packet_forward_hdr(pio_spi_packet_tx_t *ptx, pio_spi_packet_t *pkt,
+                                const pio_spi_packet_hdr_t *hdr);
+
+/** Payload segments in one pio_spi_packet_send_sg() (header and pad use two) */
+#define PIO_SPI_PACKET_SG_MAX_SEGS (PIO_SPI_DMA_SG_MAX_SEGS - 2)
+
+/**
+ * Enable pio_spi_packet_send_sg() on this sender
+ *
+ * @return      false if no DMA channel was available for the control blocks
+ *
+ * Costs one more DMA channel per link, so it is opt-in.
+ */
+bool pio_spi_packet_tx_sg_init(pio_spi_packet_tx_t *ptx);
+
+/**
+ * Send a packet whose payload is spread over several buffers (non-blocking)
+ *
+ * @param ptx   Packet TX state, with pio_spi_packet_tx_sg_init() done
+ * @param dst   Destination address
+ * @param type  Packet type
+ * @param iov   Payload segments in order (must remain valid until done;
+ *              each a multiple of 4 bytes on 32-bit links)
+ * @param count Number of segments (<= PIO_SPI_PACKET_SG_MAX_SEGS)
+ * @return      false if busy, not enabled, or the segments don't fit
+ *
+ * The header is built in ptx and DMA walks header, segments, padding and
+ * CRC as one frame, so nothing is copied into a packet buffer. The
+ * sniffer covers all of it when free; otherwise the CRC is computed in
+ * software over the segments.
+ */
+bool pio_spi_packet_send_sg(pio_spi_packet_tx_t *ptx, uint16_t dst, uint8_t type,
+                            const pio_spi_dma_iovec_t *iov, uint count);
+
+/**
+ * Check if a packet is in flight
+ */
+static inline bool pio_spi_packet_tx_busy(const pio_spi_packet_tx_t *ptx) {
+    return ptx->busy;
+}
+
+/**
+ * Wait until the packet in flight is on the wire (blocking)
+ *
+ * Sleeps in WFE between interrupts, like pio_spi_dma_tx_wait().
+ */
+void pio_spi_packet_tx_wait(pio_spi_packet_tx_t *ptx);
+
+/**
+ * Set callback for packet sent, once its last bit is on the wire (IRQ context)
+ */
+void pio_spi_packet_tx_set_callback(pio_spi_packet_tx_t *ptx,
+                                    pio_spi_dma_callback_t callback,
+                                    void *user_data);
+
+/**
+ * Detach from the TX link and release the CRC (and control) channel
+ */
+void pio_spi_packet_tx_deinit(pio_spi_packet_tx_t *ptx);
+
+// ============================================================================
+// Packet RX
+// ============================================================================
+
+/**
+ * Called from IRQ context for every packet that passes its CRC check
+ *
+ * Returns the buffer to receive the next packet into: pkt itself to reuse
+ * it, or a fresh buffer to keep pkt (e.g. queued for forwarding).
+ */
+typedef pio_spi_packet_t *(*pio_spi_packet_rx_callback_t)(pio_spi_packet_t *pkt, void *user_data);
+
+/**
+ * Called from IRQ context as soon as a header lands (cut-through routing)
+ *
+ * Returns an idle TX link to stream the rest of the packet straight into,
+ * or NULL to receive it here as normal. Only return links that pass
+ * pio_spi_packet_can_cut_through().
+ */
+typedef pio_spi_dma_tx_inst_t *(*pio_spi_packet_route_callback_t)(const pio_spi_packet_hdr_t *hdr,
+                                                                 void *user_data);
+
+/** Called from IRQ context once a cut-through packet is all in tx's FIFO */
+typedef void (*pio_spi_packet_cut_done_callback_t)(pio_spi_dma_tx_inst_t *tx, void *user_data);
+
+typedef struct {
+    pio_spi_dma_rx_inst_t *rx;
+    pio_spi_packet_t *pkt;      // Receive buffer
+    uint8_t state;              // Part of the packet being received
+    bool hw_crc;                // Current packet's CRC comes from the sniffer
+    volatile bool running;
+    uint32_t crc;               // CRC of header + payload as received
+    dma_channel_config hdr_config;      // Data channel as the driver set it up
+    dma_channel_config hdr_sniff_config;    // Same, sniffed
+    dma_channel_config data_config;     // Payload/CRC: same, without the stamp chain
+    dma_channel_config sniff_config;    // Same, sniffed
+    dma_channel_config cut_config;      // Same, writing to a TX FIFO
+    pio_spi_dma_tx_inst_t *cut_tx;      // Link being streamed into
+    uint32_t in_clock_cycles;   // Far end's bit clock in sys cycles x256 (0: not set)
+    alarm_id_t resync_alarm;    // Pending re-arm after a bad header (0 if none)
+    uint32_t stamp;             // Timer (us) when the current header landed
+    uint32_t packets;           // Packets delivered
+    uint32_t crc_errors;        // Packets dropped on CRC mismatch
+    uint32_t length_errors;     // Headers rejected (lost framing)
+    uint32_t hw_packets;        // Packets checked by the sniffer
+    uint32_t cut_through;       // Packets streamed straight to another link
+    pio_spi_packet_rx_callback_t callback;
+    void *callback_data;
+    pio_spi_packet_route_callback_t route;
+    pio_spi_packet_cut_done_callback_t cut_done;
+    void *route_data;
+} pio_spi_packet_rx_t;
+
+/**
+ * Attach a packet receiver to an initialized RX link
+ *
+ * @param prx   Packet RX state
+ * @param rx    RX instance (one-shot mode, owned by the packet layer)
+ * @param pkt   Receive buffer
+ */
+void pio_spi_packet_rx_init(pio_spi_packet_rx_t *prx, pio_spi_dma_rx_inst_t *rx,
+                            pio_spi_packet_t *pkt);
+
+/**
+ * Set callback for good packets (called from IRQ context)
+ *
+ * The next packet lands in the buffer the callback returns, which may be
+ * pkt again. Keep it short: the link is not draining while it runs.
+ */
+void pio_spi_packet_rx_set_callback(pio_spi_packet_rx_t *prx,
+                                    pio_spi_packet_rx_callback_t callback,
+                                    void *user_data);
+
+/**
+ * Enable cut-through forwarding
+ *
+ * @param prx       Packet RX state
+ * @param route     Picks an outgoing link per header (NULL to disable)
+ * @param done      Called when the outgoing link is free to reuse
+ * @param user_data Passed to both
+ *
+ * Once route() returns a link, the header is rebuilt in that link's TX
+ * FIFO and the RX DMA channel is pointed at the same FIFO, so payload and
+ * CRC flow PIO to PIO with a few words of latency instead of a whole
+ * packet. The CRC is not checked at transit nodes; the destination drops
+ * corrupt packets. Both links must have the same width and framing, and
+ * the outgoing one must carry bytes at least as fast as the incoming one:
+ * the copy is paced by RX alone, and words written to a full TX FIFO are
+ * lost. Links whose rates differ say so with pio_spi_packet_rx_set_rate().
+ */
+void pio_spi_packet_rx_set_cut_through(pio_spi_packet_rx_t *prx,
+                                       pio_spi_packet_route_callback_t route,
+                                       pio_spi_packet_cut_done_callback_t done,
+                                       void *user_data);
+
+/**
+ * Set the bit rate per lane the far end sends at (e.g. after training)
+ *
+ * pio_spi_packet_can_cut_through() then refuses outgoing links slower
+ * than that. Until it is set, every link is taken to run at one rate.
+ */
+void pio_spi_packet_rx_set_rate(pio_spi_packet_rx_t *prx, float freq_hz);
+
+/**
+ * Check that a TX link can take a cut-through packet from this RX now
+ *
+ * Same width and framing, room for the header in its FIFO, and at least
+ * this RX's byte rate (pio_spi_packet_rx_set_rate()).
+ */
+bool pio_spi_packet_can_cut_through(const pio_spi_packet_rx_t *prx,
+                                    const pio_spi_dma_tx_inst_t *tx);
+
+/**
+ * When a delivered packet's header landed here (timer us, low 32 bits)
+ * 
+ * The checked CRC word is replaced by the stamp before the callback, so
+ * it stays with the buffer through queues and reorder windows until the
+ * packet is sent on (software-CRC sending writes a CRC there again).
+ * Taken by DMA with pio_spi_dma_rx_set_timestamps() on, else at the
+ * header IRQ.
+ */
+static inline uint32_t pio_spi_packet_rx_stamp(const pio_spi_packet_t *pkt) {
+    return *(const uint32_t *)&pkt->payload[pio_spi_packet_padded_len(pkt->hdr.len)];
+}
+
+/**
+ * Start receiving packets continuously
+ */
+void pio_spi_packet_rx_start(pio_spi_packet_rx_t *prx);
+
+/**
+ * Stop receiving (drops any packet in progress)
+ */
+void pio_spi_packet_rx_stop(pio_spi_packet_rx_t *prx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIO_SPI_PACKET_H
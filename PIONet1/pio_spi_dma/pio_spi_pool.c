@@ -0,0 +1,73 @@
+/**
+ * Fixed-size, refcounted buffer pool
+ */
+
+#include "pio_spi_pool.h"
+#include "pio_spi_dma.h"
+#include "hardware/sync.h"
+
+void pio_spi_pool_init(pio_spi_pool_t *pool, void *storage, size_t storage_size,
+                       pio_spi_pool_slot_t *slots, uint count) {
+    pool->base = storage;
+    pool->stride = (uint32_t)(storage_size / count);
+    pool->count = count;
+    pool->slots = slots;
+    pool->release = NULL;
+    pool->user_data = NULL;
+    pool->allocs = 0;
+    pool->empty = 0;
+
+    // Lowest index on top, so buffers come out in address order at first
+    for (uint i = 0; i < count; i++) {
+        slots[i].stack = (uint16_t)(count - 1 - i);
+        slots[i].refs = 0;
+        slots[i].tag = 0;
+    }
+    pool->free_count = count;
+    pool->low_water = count;
+}
+
+void pio_spi_pool_set_release_callback(pio_spi_pool_t *pool,
+                                       pio_spi_pool_release_callback_t callback,
+                                       void *user_data) {
+    pool->release = callback;
+    pool->user_data = user_data;
+}
+
+void *PIO_SPI_DMA_HOT(pio_spi_pool_alloc)(pio_spi_pool_t *pool) {
+    void *buf = NULL;
+    uint32_t save = save_and_disable_interrupts();
+    if (pool->free_count) {
+        uint i = pool->slots[--pool->free_count].stack;
+        pool->slots[i].refs = 1;
+        pool->slots[i].tag = 0;
+        buf = pool->base + i * pool->stride;
+        pool->allocs++;
+        if (pool->free_count < pool->low_water) {
+            pool->low_water = pool->free_count;
+        }
+    } else {
+        pool->empty++;
+    }
+    restore_interrupts(save);
+    return buf;
+}
+
+void PIO_SPI_DMA_HOT(pio_spi_pool_ref)(pio_spi_pool_t *pool, void *buf) {
+    uint32_t save = save_and_disable_interrupts();
+    pool->slots[pio_spi_pool_index(pool, buf)].refs++;
+    restore_interrupts(save);
+}
+
+void PIO_SPI_DMA_HOT(pio_spi_pool_free)(pio_spi_pool_t *pool, void *buf) {
+    uint32_t save = save_and_disable_interrupts();
+    uint i = pio_spi_pool_index(pool, buf);
+    if (--pool->slots[i].refs == 0) {
+        // Back first, so the callback may allocate again
+        pool->slots[pool->free_count++].stack = (uint16_t)i;
+        if (pool->release) {
+            pool->release(buf, pool->slots[i].tag, pool->user_data);
+        }
+    }
+    restore_interrupts(save);
+}
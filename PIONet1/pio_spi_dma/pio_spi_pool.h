@@ -0,0 +1,185 @@
+/**
+ * Fixed-size, refcounted buffer pool for zero-copy packet handling
+ *
+ * The transfer functions take raw pointers that must stay valid until the
+ * DMA finishes. A pool hands out such buffers so one buffer can be
+ * received into, passed to the router, sent on one or more links and then
+ * returned, with no copy in between:
+ *
+ *   buf = pio_spi_pool_alloc(&pool);     // refs = 1
+ *   ... RX DMA lands a packet in buf ...
+ *   pio_spi_pool_ref(&pool, buf);        // refs = 2: queued on two links
+ *   pio_spi_pool_free(&pool, buf);       // each TX completion drops one
+ *   pio_spi_pool_free(&pool, buf);       // refs = 0: back in the pool
+ *
+ * Each buffer also carries a one-byte tag for the owner (e.g. which link
+ * it was received on), handed to the release callback when the last
+ * reference goes, so the owner can return a link credit there.
+ *
+ * Storage is declared with PIO_SPI_POOL_DEFINE, which sets stride and
+ * alignment at compile time and chooses the SRAM it lives in. RP2350
+ * main SRAM is word-striped: the lower 256 KB across banks 0-3, the upper
+ * across banks 4-7, so a pool there spreads every DMA burst over four
+ * banks and concurrent links rarely meet on one. SCRATCH_X and SCRATCH_Y
+ * are separate 4 KB banks: a small pool there (e.g. for one core's
+ * control packets) never competes with the main pools at all.
+ *
+ * Alloc, ref and free are safe from IRQ context and mask interrupts only
+ * briefly. They are not safe to call from both cores on one pool.
+ */
+
+#ifndef PIO_SPI_POOL_H
+#define PIO_SPI_POOL_H
+
+#include "pico.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Placement
+// ============================================================================
+
+/** Striped main SRAM (default .bss placement) */
+#define PIO_SPI_POOL_SRAM
+
+/** SRAM8, 4 KB, not striped; core1's stack grows down from its top */
+#define PIO_SPI_POOL_SCRATCH_X  __scratch_x("pio_spi_pool")
+
+/** SRAM9, 4 KB, not striped; core0's stack grows down from its top */
+#define PIO_SPI_POOL_SCRATCH_Y  __scratch_y("pio_spi_pool")
+
+/** Distance between buffers for a given size and alignment (power of 2) */
+#define PIO_SPI_POOL_STRIDE(size, align) (((size) + (align) - 1u) & ~((size_t)(align) - 1u))
+
+/**
+ * Declare a pool and its storage
+ *
+ * @param name      Pool variable (pio_spi_pool_t)
+ * @param count     Number of buffers (up to 65535)
+ * @param size      Bytes per buffer
+ * @param align     Buffer alignment, a power of 2 and at least 4 for
+ *                  32-bit DMA
+ * @param placement PIO_SPI_POOL_SRAM, _SCRATCH_X, _SCRATCH_Y or any
+ *                  section attribute from the linker script
+ *
+ * Initialize with PIO_SPI_POOL_INIT(name) before use.
+ */
+#define PIO_SPI_POOL_DEFINE(name, count, size, align, placement)                  \
+    static uint8_t placement __attribute__((aligned(align)))                      \
+        name##_storage[(count) * PIO_SPI_POOL_STRIDE(size, align)];               \
+    static pio_spi_pool_slot_t name##_slots[count];                               \
+    static pio_spi_pool_t name
+
+#define PIO_SPI_POOL_INIT(name)                                                   \
+    pio_spi_pool_init(&name, name##_storage, sizeof(name##_storage),              \
+                      name##_slots, sizeof(name##_slots) / sizeof(name##_slots[0]))
+
+// ============================================================================
+// Types
+// ============================================================================
+
+/** Last reference to a buffer dropped (IRQs disabled; buf is already free) */
+typedef void (*pio_spi_pool_release_callback_t)(void *buf, uint8_t tag, void *user_data);
+
+/** Per-buffer bookkeeping */
+typedef struct {
+    uint16_t stack;             // Free stack entry: index of a free buffer
+    uint8_t refs;               // References to this buffer, 0 if free
+    uint8_t tag;                // Owner's byte, reset to 0 by alloc
+} pio_spi_pool_slot_t;
+
+typedef struct {
+    uint8_t *base;
+    uint32_t stride;
+    uint count;
+    pio_spi_pool_slot_t *slots;
+    uint free_count;            // Entries on the free stack
+
+    pio_spi_pool_release_callback_t release;
+    void *user_data;
+
+    uint low_water;             // Fewest buffers ever free
+    uint32_t allocs;            // Successful allocations
+    uint32_t empty;             // Allocations refused
+} pio_spi_pool_t;
+
+// ============================================================================
+// API
+// ============================================================================
+
+/**
+ * Set up a pool over caller storage (normally via PIO_SPI_POOL_INIT)
+ *
+ * @param pool          Pool state
+ * @param storage       Buffer memory
+ * @param storage_size  Bytes of it
+ * @param slots         Bookkeeping, one per buffer
+ * @param count         Number of buffers
+ */
+void pio_spi_pool_init(pio_spi_pool_t *pool, void *storage, size_t storage_size,
+                       pio_spi_pool_slot_t *slots, uint count);
+
+/**
+ * Called whenever a buffer's last reference goes, with its tag
+ */
+void pio_spi_pool_set_release_callback(pio_spi_pool_t *pool,
+                                       pio_spi_pool_release_callback_t callback,
+                                       void *user_data);
+
+/**
+ * Take a buffer
+ *
+ * @return      Buffer with one reference and tag 0, or NULL if none is free
+ */
+void *pio_spi_pool_alloc(pio_spi_pool_t *pool);
+
+/**
+ * Take an extra reference to an allocated buffer
+ */
+void pio_spi_pool_ref(pio_spi_pool_t *pool, void *buf);
+
+/**
+ * Drop one reference (the buffer returns to the pool at zero)
+ */
+void pio_spi_pool_free(pio_spi_pool_t *pool, void *buf);
+
+/**
+ * Index of a buffer in the pool (0..count-1)
+ */
+static inline uint pio_spi_pool_index(const pio_spi_pool_t *pool, const void *buf) {
+    return (uint)(((const uint8_t *)buf - pool->base) / pool->stride);
+}
+
+/**
+ * Whether a pointer is a buffer from this pool
+ */
+static inline bool pio_spi_pool_owns(const pio_spi_pool_t *pool, const void *buf) {
+    const uint8_t *p = buf;
+    return p >= pool->base && p < pool->base + pool->count * pool->stride &&
+           (uint32_t)(p - pool->base) % pool->stride == 0;
+}
+
+/**
+ * Set the owner's tag of an allocated buffer
+ */
+static inline void pio_spi_pool_set_tag(pio_spi_pool_t *pool, void *buf, uint8_t tag) {
+    pool->slots[pio_spi_pool_index(pool, buf)].tag = tag;
+}
+
+/**
+ * Buffers currently free (a snapshot)
+ */
+static inline uint pio_spi_pool_available(const pio_spi_pool_t *pool) {
+    return pool->free_count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIO_SPI_POOL_H
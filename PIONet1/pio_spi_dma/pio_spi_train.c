@@ -0,0 +1,338 @@
+/**
+ * Per-link clock-rate training
+ */
+
+#include "pio_spi_train.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
+#include <string.h>
+
+// Gap between TEST packets so the far RX has re-armed for the next one
+#define TEST_GAP_US     20
+
+// Keep answering after DONE in case our READY was lost
+#define LINGER_US       (4 * PIO_SPI_TRAIN_RETRY_US)
+
+// Messages (start of every TRAIN payload)
+enum {
+    OP_PHASE = 1,               // Trainer: use this sampling phase for a trial
+    OP_READY,                   // Responder: phase set (or DONE taken)
+    OP_TEST,                    // Trainer: test pattern at the trial rate
+    OP_QUERY,                   // Trainer: how many TEST packets arrived?
+    OP_RESULT,                  // Responder: this many
+    OP_DONE                     // Trainer: keep this phase, training over
+};
+
+typedef struct {
+    uint8_t op;
+    uint8_t phase;
+    uint16_t trial;
+    uint32_t good;              // RESULT: TEST packets received. DONE: chosen rate (Hz)
+} train_msg_t;
+
+enum {
+    STATE_PHASE,                // Request the next trial's phase
+    STATE_TEST,                 // Send TEST packets at the trial divider
+    STATE_QUERY,                // Ask for the trial's result
+    STATE_DONE,                 // Tell the far end the chosen phase
+    STATE_WAIT_PEER,            // Trained; still answering the far end
+    STATE_FINISHED
+};
+
+static inline bool time_reached_us(uint32_t now, uint32_t t) {
+    return (int32_t)(now - t) >= 0;
+}
+
+// ============================================================================
+// Sending
+// ============================================================================
+
+// Switch the TX divider (only called with the TX idle: packets complete
+// once their last bit is on the wire)
+static void set_div(pio_spi_train_t *t, uint32_t div) {
+    pio_spi_dma_tx_inst_t *tx = t->ptx->tx;
+    if (pio_spi_dma_tx_get_clkdiv(tx) != div) {
+        pio_spi_dma_tx_set_clkdiv(tx, div);
+    }
+}
+
+static void send_msg(pio_spi_train_t *t, uint32_t div, uint8_t op, uint8_t phase,
+                     uint16_t trial, uint32_t good, size_t len) {
+    train_msg_t msg = { .op = op, .phase = phase, .trial = trial, .good = good };
+    memcpy(t->buf->payload, &msg, sizeof(msg));
+    set_div(t, div);
+    pio_spi_packet_send(t->ptx, t->buf, PIO_SPI_PACKET_BROADCAST, PIO_SPI_LINK_TYPE_TRAIN, len);
+}
+
+static void send_test(pio_spi_train_t *t) {
+    // Pseudo-random payload (xorshift32), different for every packet
+    uint32_t x = ((uint32_t)t->trial << 16) ^ t->sent ^ 0x9e3779b9u;
+    for (size_t i = sizeof(train_msg_t); i < PIO_SPI_TRAIN_PAYLOAD; i += 4) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        memcpy(&t->buf->payload[i], &x, 4);
+    }
+    send_msg(t, t->step_div, OP_TEST, t->phase, t->trial, 0, PIO_SPI_TRAIN_PAYLOAD);
+}
+
+// ============================================================================
+// Receiving (IRQ context)
+// ============================================================================
+
+static pio_spi_packet_t *PIO_SPI_DMA_HOT(train_rx_packet)(pio_spi_packet_t *pkt, void *user_data) {
+    pio_spi_train_t *t = user_data;
+    if (pkt->hdr.type != PIO_SPI_LINK_TYPE_TRAIN || pkt->hdr.len < sizeof(train_msg_t)) {
+        return pkt;
+    }
+
+    train_msg_t msg;
+    memcpy(&msg, pkt->payload, sizeof(msg));
+
+    switch (msg.op) {
+    // Far end's trainer: we are its responder
+    case OP_PHASE:
+    case OP_DONE:
+        pio_spi_dma_rx_set_sample_phase(t->prx->rx, (pio_spi_dma_sample_phase_t)msg.phase);
+        t->peer_trial = msg.trial;
+        t->peer_good = 0;
+        t->peer_reply = OP_READY;
+        t->peer_done = msg.op == OP_DONE;
+        if (t->peer_done) {
+            t->peer_freq_hz = msg.good;
+        }
+        t->peer_seen_us = time_us_32();
+        break;
+    case OP_TEST:
+        if (msg.trial == t->peer_trial) {
+            t->peer_good++;
+        }
+        break;
+    case OP_QUERY:
+        if (msg.trial == t->peer_trial) {
+            t->peer_reply = OP_RESULT;
+            t->peer_seen_us = time_us_32();
+        }
+        break;
+
+    // Far end's responder answering our trainer
+    case OP_READY:
+        if (msg.trial == t->trial && (t->state == STATE_PHASE || t->state == STATE_DONE)) {
+            t->reply = true;
+        }
+        break;
+    case OP_RESULT:
+        if (msg.trial == t->trial && t->state == STATE_QUERY) {
+            t->reply_good = msg.good;
+            t->reply = true;
+        }
+        break;
+    }
+    return pkt;
+}
+
+// ============================================================================
+// Trainer
+// ============================================================================
+
+static uint32_t div_of_step(const pio_spi_train_t *t, uint step) {
+    return t->safe_div - step * PIO_SPI_TRAIN_DIV_STEP;
+}
+
+static float freq_at(const pio_spi_train_t *t, uint32_t div) {
+    pio_spi_dma_tx_inst_t *tx = t->ptx->tx;
+    return pio_spi_dma_tx_get_freq(tx) * (float)pio_spi_dma_tx_get_clkdiv(tx) / (float)div;
+}
+
+static void request(pio_spi_train_t *t, uint8_t state) {
+    t->state = state;
+    t->reply = false;
+    t->deadline_us = time_us_32();
+}
+
+static void next_trial(pio_spi_train_t *t) {
+    t->trial++;
+    t->step_div = div_of_step(t, t->step);
+    request(t, STATE_PHASE);
+}
+
+// Settle GUARD steps below the fastest clean divider, in the middle of
+// the phases that were clean there
+static void choose(pio_spi_train_t *t, uint steps) {
+    pio_spi_train_result_t *r = &t->result;
+
+    uint fastest = 0;
+    while (fastest + 1 < steps && t->pass[fastest + 1]) {
+        fastest++;
+    }
+    uint chosen = fastest > PIO_SPI_TRAIN_GUARD ? fastest - PIO_SPI_TRAIN_GUARD : 0;
+    uint8_t mask = t->pass[chosen];
+
+    r->trained = mask != 0;
+    r->phase_mask = mask;
+    if (!r->trained || (mask & (1u << PIO_SPI_DMA_SAMPLE_NOMINAL))) {
+        r->phase = PIO_SPI_DMA_SAMPLE_NOMINAL;
+    } else {
+        r->phase = (mask & (1u << PIO_SPI_DMA_SAMPLE_EARLY)) ? PIO_SPI_DMA_SAMPLE_EARLY
+                                                             : PIO_SPI_DMA_SAMPLE_LATE;
+    }
+    if (!r->trained) {
+        chosen = fastest = 0;
+    }
+
+    t->final_div = div_of_step(t, chosen);
+    r->div_int = (uint16_t)(t->final_div >> 8);
+    r->div_frac = (uint8_t)t->final_div;
+    r->freq_hz = freq_at(t, t->final_div);
+    r->max_freq_hz = freq_at(t, div_of_step(t, fastest));
+    r->margin_pct = (r->max_freq_hz / r->freq_hz - 1.0f) * 100.0f;
+}
+
+// No answer for too long: keep the safe rate
+static void give_up(pio_spi_train_t *t) {
+    pio_spi_train_result_t *r = &t->result;
+    memset(r, 0, sizeof(*r));
+    t->final_div = t->safe_div;
+    r->div_int = (uint16_t)(t->safe_div >> 8);
+    r->div_frac = (uint8_t)t->safe_div;
+    r->phase = PIO_SPI_DMA_SAMPLE_NOMINAL;
+    r->freq_hz = r->max_freq_hz = freq_at(t, t->safe_div);
+    t->state = STATE_WAIT_PEER;
+}
+
+// Waiting on a reply: resend on every retry interval until the timeout
+static bool await_reply(pio_spi_train_t *t, uint32_t now) {
+    if (t->reply) {
+        t->progress_us = now;
+        return true;
+    }
+    if (time_reached_us(now, t->deadline_us)) {
+        if (time_reached_us(now, t->progress_us + PIO_SPI_TRAIN_TIMEOUT_US)) {
+            give_up(t);
+            return false;
+        }
+        t->deadline_us = now + PIO_SPI_TRAIN_RETRY_US;
+        uint8_t op = t->state == STATE_PHASE ? OP_PHASE :
+                     t->state == STATE_QUERY ? OP_QUERY : OP_DONE;
+        uint32_t rate = op == OP_DONE ? (uint32_t)t->result.freq_hz : 0;
+        send_msg(t, t->safe_div, op, t->phase, t->trial, rate, sizeof(train_msg_t));
+    }
+    return false;
+}
+
+static void trainer_step(pio_spi_train_t *t, uint32_t now) {
+    switch (t->state) {
+    case STATE_PHASE:
+        if (await_reply(t, now)) {
+            t->sent = 0;
+            t->state = STATE_TEST;
+            t->deadline_us = now;
+        }
+        break;
+
+    case STATE_TEST:
+        if (!time_reached_us(now, t->deadline_us)) break;
+        if (t->sent < PIO_SPI_TRAIN_PACKETS) {
+            send_test(t);
+            t->sent++;
+            t->deadline_us = time_us_32() + TEST_GAP_US;
+        } else {
+            request(t, STATE_QUERY);
+        }
+        break;
+
+    case STATE_QUERY:
+        if (!await_reply(t, now)) break;
+        if (t->reply_good == PIO_SPI_TRAIN_PACKETS) {
+            t->pass[t->step] |= (uint8_t)(1u << t->phase);
+        }
+
+        if (++t->phase <= PIO_SPI_DMA_SAMPLE_LATE) {
+            next_trial(t);
+            break;
+        }
+
+        // All phases tried at this divider: faster while something passed
+        t->phase = 0;
+        if (t->pass[t->step] && t->step + 1 < PIO_SPI_TRAIN_MAX_STEPS &&
+            div_of_step(t, t->step + 1) >= 256) {
+            t->step++;
+            next_trial(t);
+        } else {
+            choose(t, t->step + 1);
+            t->phase = t->result.phase;
+            t->trial++;
+            request(t, STATE_DONE);
+        }
+        break;
+
+    case STATE_DONE:
+        if (await_reply(t, now)) {
+            t->state = STATE_WAIT_PEER;
+        }
+        break;
+
+    case STATE_WAIT_PEER: {
+        // Done once the far end has its answer (or has gone quiet)
+        uint32_t quiet = t->peer_done ? LINGER_US : PIO_SPI_TRAIN_TIMEOUT_US;
+        if (time_reached_us(now, t->peer_seen_us + quiet)) {
+            // Replies went out at the safe rate; data runs at the chosen one
+            set_div(t, t->final_div);
+            pio_spi_packet_rx_stop(t->prx);
+            t->result.rx_freq_hz = t->peer_freq_hz ? (float)t->peer_freq_hz
+                                                   : freq_at(t, t->safe_div);
+            pio_spi_packet_rx_set_callback(t->prx, t->saved_rx_callback, t->saved_rx_data);
+            pio_spi_packet_tx_set_callback(t->ptx, t->saved_tx_callback, t->saved_tx_data);
+            t->state = STATE_FINISHED;
+        }
+        break;
+    }
+    }
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+void pio_spi_train_start(pio_spi_train_t *t, pio_spi_packet_tx_t *ptx, pio_spi_packet_rx_t *prx,
+                         pio_spi_packet_t *buf) {
+    memset(t, 0, sizeof(*t));
+    t->ptx = ptx;
+    t->prx = prx;
+    t->buf = buf;
+    t->safe_div = pio_spi_dma_tx_get_clkdiv(ptx->tx);
+    t->progress_us = t->peer_seen_us = time_us_32();
+    t->peer_trial = 0xffff;
+
+    t->saved_tx_callback = ptx->callback;
+    t->saved_tx_data = ptx->callback_data;
+    t->saved_rx_callback = prx->callback;
+    t->saved_rx_data = prx->callback_data;
+    pio_spi_packet_tx_set_callback(ptx, NULL, NULL);
+    pio_spi_packet_rx_set_callback(prx, train_rx_packet, t);
+
+    pio_spi_dma_rx_set_sample_phase(prx->rx, PIO_SPI_DMA_SAMPLE_NOMINAL);
+    pio_spi_packet_rx_start(prx);
+    next_trial(t);
+}
+
+bool pio_spi_train_poll(pio_spi_train_t *t) {
+    if (t->state == STATE_FINISHED) return true;
+    if (pio_spi_packet_tx_busy(t->ptx)) return false;
+
+    // Replies first: the far end is waiting on them
+    uint32_t save = save_and_disable_interrupts();
+    uint8_t op = t->peer_reply;
+    uint16_t trial = t->peer_trial;
+    uint32_t good = t->peer_good;
+    t->peer_reply = 0;
+    restore_interrupts(save);
+
+    if (op) {
+        send_msg(t, t->safe_div, op, 0, trial, good, sizeof(train_msg_t));
+        return false;
+    }
+
+    trainer_step(t, time_us_32());
+    return t->state == STATE_FINISHED;
+}
@@ -0,0 +1,160 @@
+/**
+ * Per-link clock-rate training
+ *
+ * Every link starts at a safe compile-time rate. Training finds the
+ * fastest rate each direction of each cable actually carries, so good
+ * links are no longer held to the worst one's speed.
+ *
+ * Each end trains its own TX direction while answering the far end's
+ * training of the other. RX is clocked by the incoming CLK and takes any
+ * rate, so the two directions never need to agree on a schedule:
+ *
+ *   Trainer (this TX)                         Responder (far RX)
+ *   PHASE {trial, phase}   -- safe rate -->   set RX sampling phase
+ *                          <-- READY -------
+ *   TEST x N               -- trial rate ->   count good packets
+ *   QUERY {trial}          -- safe rate -->
+ *                          <-- RESULT {good}
+ *   ... next phase, then the next faster divider ...
+ *   DONE {phase, rate}     -- safe rate -->   keep the chosen phase
+ *                          <-- READY -------
+ *
+ * The sweep starts at the safe divider and steps down by
+ * PIO_SPI_TRAIN_DIV_STEP (fractional dividers included) until no phase
+ * gets every TEST packet through its CRC. The link then settles
+ * PIO_SPI_TRAIN_GUARD steps below the fastest clean divider, at the
+ * sampling phase in the middle of the clean ones there. A far end that
+ * never answers leaves the link at the safe rate.
+ *
+ * The RX sampling phase moves the sample point relative to the CLK edge
+ * by bypassing the PIO input synchronizers on CLK or DATA (see
+ * pio_spi_dma_rx_set_sample_phase()).
+ *
+ * Run it on a link's packet layer before the link starts: it borrows the
+ * TX and RX callbacks and gives them back when done.
+ */
+
+#ifndef PIO_SPI_TRAIN_H
+#define PIO_SPI_TRAIN_H
+
+#include "pio_spi_link.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** TEST packets per trial; all must pass their CRC */
+#ifndef PIO_SPI_TRAIN_PACKETS
+#define PIO_SPI_TRAIN_PACKETS 16
+#endif
+
+/** TEST payload bytes (multiple of 4) */
+#ifndef PIO_SPI_TRAIN_PAYLOAD
+#define PIO_SPI_TRAIN_PAYLOAD 256
+#endif
+
+/** Divider step of the sweep in 1/256ths */
+#ifndef PIO_SPI_TRAIN_DIV_STEP
+#define PIO_SPI_TRAIN_DIV_STEP 16
+#endif
+
+/** Steps backed off from the fastest clean divider */
+#ifndef PIO_SPI_TRAIN_GUARD
+#define PIO_SPI_TRAIN_GUARD 1
+#endif
+
+/** Wait for a responder reply before asking again */
+#ifndef PIO_SPI_TRAIN_RETRY_US
+#define PIO_SPI_TRAIN_RETRY_US 5000
+#endif
+
+/** Give up on a silent far end after this long */
+#ifndef PIO_SPI_TRAIN_TIMEOUT_US
+#define PIO_SPI_TRAIN_TIMEOUT_US 2000000
+#endif
+
+/** Sweep steps recorded (faster ones beyond this aren't tried) */
+#define PIO_SPI_TRAIN_MAX_STEPS 32
+
+/** Outcome for one TX direction */
+typedef struct {
+    bool trained;               // false: far end never answered, safe rate kept
+    uint16_t div_int;           // Chosen TX clock divider
+    uint8_t div_frac;
+    uint8_t phase;              // Chosen far-end sampling phase (pio_spi_dma_sample_phase_t)
+    uint8_t phase_mask;         // Bit p: phase p was clean at the chosen divider
+    float freq_hz;              // Chosen bit rate per lane
+    float max_freq_hz;          // Fastest clean rate seen
+    float margin_pct;           // How far max_freq_hz is above freq_hz
+    float rx_freq_hz;           // Rate the far end chose for its TX into this RX
+                                // (the safe rate if it never said)
+} pio_spi_train_result_t;
+
+typedef struct {
+    pio_spi_packet_tx_t *ptx;
+    pio_spi_packet_rx_t *prx;
+
+    // Borrowed callbacks, restored at the end
+    pio_spi_dma_callback_t saved_tx_callback;
+    void *saved_tx_data;
+    pio_spi_packet_rx_callback_t saved_rx_callback;
+    void *saved_rx_data;
+
+    // Trainer: this end's TX
+    uint8_t state;
+    uint8_t step;               // Sweep step (0 = safe divider)
+    uint8_t phase;              // Phase being tried
+    uint16_t trial;             // Trial id (matches replies to requests)
+    uint16_t sent;              // TEST packets sent this trial
+    uint32_t safe_div;          // Safe divider in 1/256ths
+    uint32_t step_div;          // Divider of the step being tried
+    uint32_t final_div;         // Divider to run at once finished
+    uint8_t pass[PIO_SPI_TRAIN_MAX_STEPS];  // Bit p: phase p clean at each step
+    uint32_t deadline_us;       // When to (re)send the pending request or TEST
+    uint32_t progress_us;       // Last reply from the far end's responder
+    volatile bool reply;        // Matching reply received
+    volatile uint32_t reply_good;
+
+    // Responder: the far end's TX into this RX
+    volatile uint16_t peer_trial;
+    volatile uint32_t peer_good;
+    volatile uint8_t peer_reply;        // Reply op waiting for the TX, or 0
+    volatile bool peer_done;            // Far end sent DONE
+    volatile uint32_t peer_freq_hz;     // Rate it chose (from DONE)
+    volatile uint32_t peer_seen_us;     // Last message from the far end's trainer
+
+    pio_spi_train_result_t result;
+    pio_spi_packet_t *buf;      // Requests, TEST packets and replies
+} pio_spi_train_t;
+
+/**
+ * Start training a link (call before pio_spi_link_start)
+ *
+ * @param t     Training state (must stay valid until done)
+ * @param ptx   Link's packet TX, running at its safe rate
+ * @param prx   Link's packet RX (started here, stopped at the end)
+ * @param buf   TX buffer for the training packets (free again when done)
+ */
+void pio_spi_train_start(pio_spi_train_t *t, pio_spi_packet_tx_t *ptx, pio_spi_packet_rx_t *prx,
+                         pio_spi_packet_t *buf);
+
+/**
+ * Advance training; call in a loop (from several links' state at once)
+ *
+ * @return      true once this end is trained and has answered the far end
+ *              (or either side gave up)
+ */
+bool pio_spi_train_poll(pio_spi_train_t *t);
+
+/**
+ * Result (valid once pio_spi_train_poll() returned true)
+ */
+static inline const pio_spi_train_result_t *pio_spi_train_result(const pio_spi_train_t *t) {
+    return &t->result;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIO_SPI_TRAIN_H
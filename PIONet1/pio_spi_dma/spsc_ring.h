@@ -0,0 +1,100 @@
+/**
+ * Lock-free single-producer / single-consumer pointer ring
+ *
+ * One side only ever pushes and the other only ever pops, so the two
+ * indices are each written by exactly one core and no lock or interrupt
+ * masking is needed. Memory fences order the slot write before the index
+ * that publishes it.
+ *
+ * Usage:
+ *   static void *slots[16];
+ *   static spsc_ring_t ring;
+ *   spsc_ring_init(&ring, slots, 16);
+ *   spsc_ring_push(&ring, item);        // producer core
+ *   item = spsc_ring_pop(&ring);        // consumer core
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include "pico.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    void **slots;
+    uint32_t mask;              // Capacity - 1 (capacity is a power of 2)
+    volatile uint32_t head;     // Written by the producer only
+    volatile uint32_t tail;     // Written by the consumer only
+} spsc_ring_t;
+
+/**
+ * Set up an empty ring over caller storage
+ *
+ * @param r         Ring
+ * @param slots     Storage for capacity pointers
+ * @param capacity  Number of slots (power of 2)
+ */
+static inline void spsc_ring_init(spsc_ring_t *r, void **slots, uint32_t capacity) {
+    r->slots = slots;
+    r->mask = capacity - 1;
+    r->head = 0;
+    r->tail = 0;
+}
+
+/**
+ * Add an item (producer side)
+ *
+ * @return      false if the ring is full
+ */
+static inline bool spsc_ring_push(spsc_ring_t *r, void *item) {
+    uint32_t head = r->head;
+    if (head - r->tail > r->mask) {
+        return false;
+    }
+    r->slots[head & r->mask] = item;
+    __mem_fence_release();
+    r->head = head + 1;
+    return true;
+}
+
+/**
+ * Take the oldest item (consumer side)
+ *
+ * @return      Item, or NULL if the ring is empty
+ */
+static inline void *spsc_ring_pop(spsc_ring_t *r) {
+    uint32_t tail = r->tail;
+    if (tail == r->head) {
+        return NULL;
+    }
+    __mem_fence_acquire();
+    void *item = r->slots[tail & r->mask];
+    __mem_fence_release();
+    r->tail = tail + 1;
+    return item;
+}
+
+/**
+ * Items waiting (either side; a snapshot)
+ */
+static inline uint32_t spsc_ring_count(const spsc_ring_t *r) {
+    return r->head - r->tail;
+}
+
+/**
+ * Free slots (either side; a snapshot)
+ */
+static inline uint32_t spsc_ring_space(const spsc_ring_t *r) {
+    return r->mask + 1 - (r->head - r->tail);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SPSC_RING_H